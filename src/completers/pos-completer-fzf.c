@@ -12,16 +12,13 @@
 
 #include "pos-completer-priv.h"
 #include "pos-completer-fzf.h"
+#include "pos-fuzzy-matcher.h"
 
 #include <gio/gio.h>
-#include <gio/gunixinputstream.h>
-
-#include <sys/types.h>
-#include <signal.h>
 
 #define MAX_COMPLETIONS 3
+#define MAX_CANDIDATES  512
 #define WORD_LIST       "/usr/share/dict/words"
-#define PROG_FZF        "fzf"
 
 enum {
   PROP_0,
@@ -37,12 +34,14 @@ static GParamSpec *props[PROP_LAST_PROP];
 /**
  * PosCompleterFzf:
  *
- * A completer using fzf.
- *
- * Uses [fzf](https://github.com/junegunn/fzf) and the systems
- * word list to suggest completions.
+ * A completer using fzf style fuzzy matching.
  *
- * This is mostly to demo a simple completer.
+ * Matches the preedit against the system's word list like
+ * [fzf](https://github.com/junegunn/fzf) would. The word list is
+ * mapped once and matched in process so no helper processes are
+ * spawned per keystroke. The full match runs in a worker thread. When
+ * characters get appended to the preedit only the candidates of the
+ * previous lookup are rescored.
  */
 struct _PosCompleterFzf {
   GObject               parent;
@@ -52,10 +51,21 @@ struct _PosCompleterFzf {
   GStrv                 completions;
   guint                 max_completions;
 
-  GPid                  last_fzf_pid;
+  PosFuzzyMatcher      *matcher;
+  PosCompleterRefiner  *refiner;
+  GCancellable         *match_cancel;
+  char                 *match_query;  /* query of the running full match */
 };
 
 
+typedef struct {
+  char    *query;
+  GStrv    candidates;
+  guint   *indices;
+  guint    n_total;
+} PosFzfMatchData;
+
+
 static void pos_completer_fzf_interface_init (PosCompleterInterface *iface);
 static void pos_completer_fzf_initable_interface_init (GInitableIface *iface);
 
@@ -65,41 +75,13 @@ G_DEFINE_TYPE_WITH_CODE (PosCompleterFzf, pos_completer_fzf, G_TYPE_OBJECT,
                          G_IMPLEMENT_INTERFACE (G_TYPE_INITABLE,
                                                 pos_completer_fzf_initable_interface_init))
 
-typedef struct {
-  GPid                  fzf_pid;
-  char                  fzf_read_buf[256];
-  gint                  fzf_child_watch_id;
-  GString              *fzf_response;
-  GInputStream         *fzf_stdout;
-  GCancellable         *fzf_cancellable;
-  gulong                fzf_cancellable_id;
-  PosCompleterFzf      *completer;
-} FzfData;
-
-
-static void
-fzf_data_free (FzfData *data)
-{
-  if (data->completer->last_fzf_pid == data->fzf_pid)
-    data->completer->last_fzf_pid = 0;
-  g_object_unref (data->completer);
-  g_clear_signal_handler (&data->fzf_cancellable_id, data->fzf_cancellable);
-  g_clear_object (&data->fzf_cancellable);
-  g_clear_handle_id (&data->fzf_child_watch_id, g_source_remove);
-  g_spawn_close_pid (data->fzf_pid);
-  g_string_free (data->fzf_response, TRUE);
-  g_clear_object (&data->fzf_stdout);
-  g_free (data);
-}
-
-
 static void
-pos_completer_fzf_set_completions (PosCompleter *iface, GStrv completions)
+pos_completer_fzf_take_completions (PosCompleter *iface, GStrv completions)
 {
   PosCompleterFzf *self = POS_COMPLETER_FZF (iface);
 
   g_strfreev (self->completions);
-  self->completions = g_strdupv (completions);
+  self->completions = completions;
 
   g_object_notify_by_pspec (G_OBJECT (self), props[PROP_COMPLETIONS]);
 }
@@ -114,6 +96,25 @@ pos_completer_fzf_get_preedit (PosCompleter *iface)
 }
 
 
+static void
+pos_fzf_match_data_free (PosFzfMatchData *data)
+{
+  g_free (data->query);
+  g_strfreev (data->candidates);
+  g_free (data->indices);
+  g_free (data);
+}
+
+
+static void
+cancel_match (PosCompleterFzf *self)
+{
+  g_cancellable_cancel (self->match_cancel);
+  g_clear_object (&self->match_cancel);
+  g_clear_pointer (&self->match_query, g_free);
+}
+
+
 static void
 pos_completer_fzf_set_preedit (PosCompleter *iface, const char *preedit)
 {
@@ -122,11 +123,13 @@ pos_completer_fzf_set_preedit (PosCompleter *iface, const char *preedit)
   if (g_strcmp0 (self->preedit->str, preedit) == 0)
     return;
 
+  cancel_match (self);
+  pos_completer_refiner_reset (self->refiner);
   g_string_truncate (self->preedit, 0);
   if (preedit)
     g_string_append (self->preedit, preedit);
   else {
-    pos_completer_fzf_set_completions (POS_COMPLETER (self), NULL);
+    pos_completer_fzf_take_completions (POS_COMPLETER (self), NULL);
   }
 
   g_object_notify_by_pspec (G_OBJECT (self), props[PROP_PREEDIT]);
@@ -188,6 +191,9 @@ pos_completer_fzf_finalize (GObject *object)
 {
   PosCompleterFzf *self = POS_COMPLETER_FZF(object);
 
+  cancel_match (self);
+  g_clear_pointer (&self->matcher, pos_fuzzy_matcher_free);
+  g_clear_pointer (&self->refiner, pos_completer_refiner_free);
   g_clear_pointer (&self->completions, g_strfreev);
   g_string_free (self->preedit, TRUE);
 
@@ -221,109 +227,154 @@ pos_completer_fzf_class_init (PosCompleterFzfClass *klass)
 }
 
 
-static void
-on_fzf_exited (GPid pid, int status, gpointer user_data)
+static gboolean
+pos_completer_fzf_initable_init (GInitable    *initable,
+                                 GCancellable *cancelable,
+                                 GError      **error)
 {
-  FzfData *data = user_data;
+  PosCompleterFzf *self = POS_COMPLETER_FZF (initable);
 
-  if (status != 0 && status != SIGTERM) {
-    g_warning ("fzf exited with %d", status);
-    return;
+  if (g_file_test (WORD_LIST, G_FILE_TEST_EXISTS) == FALSE) {
+    g_set_error_literal (error,
+                         G_IO_ERROR,
+                         G_IO_ERROR_NOT_FOUND,
+                         "Wordlist " WORD_LIST " does not exist");
+    return FALSE;
   }
 
-  if (data->fzf_response->len) {
-    g_auto (GStrv) completions = g_strsplit (data->fzf_response->str, "\n", -1);
-    pos_completer_fzf_set_completions (POS_COMPLETER (data->completer), completions);
-  } else {
-    pos_completer_fzf_set_completions (POS_COMPLETER (data->completer), NULL);
-  }
-  fzf_data_free (data);
+  self->matcher = pos_fuzzy_matcher_new (WORD_LIST, error);
+  if (self->matcher == NULL)
+    return FALSE;
+
+  return TRUE;
 }
 
 
 static void
-on_fzf_cancelled (GObject *object, gpointer user_data)
+pos_completer_fzf_initable_interface_init (GInitableIface *iface)
 {
-  fzf_data_free (user_data);
+  iface->init = pos_completer_fzf_initable_init;
+}
+
+static const char *
+pos_completer_fzf_get_name (PosCompleter *iface)
+{
+  PosCompleterFzf *self = POS_COMPLETER_FZF (iface);
+
+  return self->name;
+}
+
+static int
+fuzzy_match (const char *query, const char *candidate, gpointer user_data)
+{
+  return pos_fuzzy_matcher_score (query, candidate, -1);
 }
 
 
 static void
-on_fzf_read_done (GObject *source_object, GAsyncResult *res, gpointer user_data)
+match_thread (GTask        *task,
+              gpointer      source_object,
+              gpointer      task_data,
+              GCancellable *cancellable)
 {
-  GInputStream *fzf_out = G_INPUT_STREAM (source_object);
-  FzfData *data = user_data;
-  gssize read_size;
-  g_autoptr (GError) error = NULL;
-
-  read_size = g_input_stream_read_finish (fzf_out, res, &error);
-  switch (read_size) {
-  case -1:
-    if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-      g_warning ("Failed to read from fzf: %s", error->message);
-    break;
-  case 0:
-    data->fzf_child_watch_id = g_child_watch_add (data->fzf_pid, on_fzf_exited, data);
-    break;
-  default:
-    g_string_append_len (data->fzf_response, data->fzf_read_buf, read_size);
-    g_input_stream_read_async (fzf_out,
-                               data->fzf_read_buf,
-                               sizeof(data->fzf_read_buf),
-                               G_PRIORITY_DEFAULT,
-                               data->fzf_cancellable,
-                               on_fzf_read_done,
-                               data);
+  PosCompleterFzf *self = POS_COMPLETER_FZF (source_object);
+  PosFzfMatchData *data = task_data;
+
+  /* A newer match superseded us while we were queued */
+  if (g_task_return_error_if_cancelled (task))
     return;
-  }
 
-  g_input_stream_close (fzf_out, NULL, NULL);
+  /* The matcher is read only after init so it can be shared with the main thread */
+  data->candidates = pos_fuzzy_matcher_match_full (self->matcher,
+                                                   data->query,
+                                                   MAX_CANDIDATES,
+                                                   &data->indices,
+                                                   &data->n_total);
+  g_task_return_boolean (task, TRUE);
 }
 
 
-static gboolean
-pos_completer_fzf_initable_init (GInitable    *initable,
-                                 GCancellable *cancelable,
-                                 GError      **error)
+static void
+pos_completer_fzf_update_completions (PosCompleterFzf *self)
 {
-  if (g_file_test (WORD_LIST, G_FILE_TEST_EXISTS) == FALSE) {
-    g_set_error_literal (error,
-                         G_IO_ERROR,
-                         G_IO_ERROR_NOT_FOUND,
-                         "Wordlist " WORD_LIST " does not exist");
-    return FALSE;
-  }
+  GStrv completions;
 
-  return TRUE;
+  completions = pos_completer_refiner_get_completions (self->refiner, self->max_completions);
+  pos_completer_cache_completions (POS_COMPLETER (self), self->preedit->str, completions);
+  pos_completer_fzf_take_completions (POS_COMPLETER (self), completions);
 }
 
 
+static void pos_completer_fzf_lookup_preedit (PosCompleterFzf *self);
+
 static void
-pos_completer_fzf_initable_interface_init (GInitableIface *iface)
+on_match_ready (GObject *source, GAsyncResult *res, gpointer user_data)
 {
-  iface->init = pos_completer_fzf_initable_init;
+  PosCompleterFzf *self = POS_COMPLETER_FZF (source);
+  PosFzfMatchData *data = g_task_get_task_data (G_TASK (res));
+  g_autoptr (GError) err = NULL;
+
+  if (!g_task_propagate_boolean (G_TASK (res), &err)) {
+    if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      g_warning ("Failed to match '%s': %s", data->query, err->message);
+    return;
+  }
+
+  g_clear_object (&self->match_cancel);
+  g_clear_pointer (&self->match_query, g_free);
+
+  pos_completer_refiner_set_candidates_full (self->refiner,
+                                             data->query,
+                                             g_steal_pointer (&data->candidates),
+                                             data->indices,
+                                             data->n_total <= MAX_CANDIDATES);
+
+  /* The preedit might have grown while we were matching */
+  if (g_strcmp0 (self->preedit->str, data->query) == 0)
+    pos_completer_fzf_update_completions (self);
+  else
+    pos_completer_fzf_lookup_preedit (self);
 }
 
-static const char *
-pos_completer_fzf_get_name (PosCompleter *iface)
+
+static void
+pos_completer_fzf_lookup_preedit (PosCompleterFzf *self)
 {
-  PosCompleterFzf *self = POS_COMPLETER_FZF (iface);
+  g_autoptr (GTask) task = NULL;
+  PosFzfMatchData *data;
 
-  return self->name;
+  /* Subsequence matches of a longer pattern are a subset of the shorter one's */
+  if (pos_completer_refiner_refine (self->refiner, self->preedit->str, fuzzy_match, NULL)) {
+    pos_completer_fzf_update_completions (self);
+    return;
+  }
+
+  /* The running match's result can be refined once it's there */
+  if (self->match_query && g_str_has_prefix (self->preedit->str, self->match_query))
+    return;
+
+  cancel_match (self);
+
+  g_debug ("Looking up string '%s'", self->preedit->str);
+  data = g_new0 (PosFzfMatchData, 1);
+  data->query = g_strdup (self->preedit->str);
+
+  self->match_query = g_strdup (data->query);
+  self->match_cancel = g_cancellable_new ();
+  task = g_task_new (self, self->match_cancel, on_match_ready, NULL);
+  g_task_set_source_tag (task, pos_completer_fzf_lookup_preedit);
+  g_task_set_name (task, "pos-fzf-match");
+  g_task_set_task_data (task, data, (GDestroyNotify)pos_fzf_match_data_free);
+  g_task_run_in_thread (task, match_thread);
 }
 
+
 static gboolean
 pos_completer_fzf_feed_symbol (PosCompleter *iface, const char *symbol)
 {
   PosCompleterFzf *self = POS_COMPLETER_FZF (iface);
-  g_autoptr (GPtrArray) fzf_argv = g_ptr_array_new ();
-  g_autofree char *cmd = NULL;
   g_autofree char *preedit = g_strdup (self->preedit->str);
-  g_autoptr (GError) err = NULL;
-  FzfData *data;
-  GInputStream *fzf_stdout;
-  GPid fzf_pid;
-  int fzf_stdout_fd;
+  GStrv completions = NULL;
 
   if (pos_completer_add_preedit (POS_COMPLETER (self), self->preedit, symbol)) {
     g_signal_emit_by_name (self, "commit-string", self->preedit->str);
@@ -342,59 +393,13 @@ pos_completer_fzf_feed_symbol (PosCompleter *iface, const char *symbol)
 
   g_object_notify_by_pspec (G_OBJECT (self), props[PROP_PREEDIT]);
 
-  if (self->last_fzf_pid) {
-    g_debug ("Killing slow %d", self->last_fzf_pid);
-    kill (self->last_fzf_pid, SIGTERM);
-    self->last_fzf_pid = 0;
+  if (pos_completer_lookup_cached (POS_COMPLETER (self), self->preedit->str, &completions)) {
+    pos_completer_fzf_take_completions (POS_COMPLETER (self), completions);
+    return TRUE;
   }
 
-  g_debug ("Looking up string '%s'", self->preedit->str);
-  /* TODO: This is obviously just an experiment. wordlists can be changed
-   * via select-default-wordlist
-   */
-  cmd = g_strdup_printf ("cat " WORD_LIST " | " PROG_FZF " -f '%s' -0 | head -%d",
-                         self->preedit->str, MAX_COMPLETIONS);
-
-  g_ptr_array_add (fzf_argv, "/bin/sh");
-  g_ptr_array_add (fzf_argv, "-c");
-  g_ptr_array_add (fzf_argv, cmd);
-  g_ptr_array_add (fzf_argv, NULL);
-
-  if (!g_spawn_async_with_pipes (NULL,
-                                 (char **) fzf_argv->pdata,
-                                 NULL, /* envp */
-                                 G_SPAWN_DO_NOT_REAP_CHILD,
-                                 NULL, /* setup-func */
-                                 NULL, /* user_data */
-                                 &fzf_pid,
-                                 NULL,
-                                 &fzf_stdout_fd,
-                                 NULL,
-                                 &err)) {
-    g_warning ("Failed to spawn fzf: %s", err->message);
-    return FALSE;
-  }
+  pos_completer_fzf_lookup_preedit (self);
 
-  self->last_fzf_pid = fzf_pid;
-  fzf_stdout = g_unix_input_stream_new (fzf_stdout_fd, TRUE);
-  data  = g_new0 (FzfData, 1);
-  *data = (FzfData){
-    .fzf_pid = fzf_pid,
-    .fzf_stdout = fzf_stdout,
-    .fzf_response = g_string_new (NULL),
-    .fzf_cancellable = g_cancellable_new (),
-    .completer = g_object_ref (self),
-  };
-
-  data->fzf_cancellable_id = g_cancellable_connect (data->fzf_cancellable,
-                                                    G_CALLBACK (on_fzf_cancelled), data, NULL);
-  g_input_stream_read_async (data->fzf_stdout,
-                             data->fzf_read_buf,
-                             sizeof(data->fzf_read_buf),
-                             G_PRIORITY_DEFAULT,
-                             data->fzf_cancellable,
-                             on_fzf_read_done,
-                             data);
   return TRUE;
 }
 
@@ -414,6 +419,8 @@ pos_completer_fzf_init (PosCompleterFzf *self)
 {
   self->max_completions = MAX_COMPLETIONS;
   self->preedit = g_string_new (NULL);
+  self->refiner = pos_completer_refiner_new ();
+  pos_completer_refiner_set_compare_func (self->refiner, pos_fuzzy_matcher_compare_candidates);
   self->name = "fzf";
 }
 
@@ -14,10 +14,13 @@
 #include "pos-completer-hunspell.h"
 
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 
 #include <hunspell.h>
 
 #define MAX_COMPLETIONS 3
+/* Approximated by the size of the dictionary files */
+#define DICT_CACHE_BUDGET (16 * 1024 * 1024)
 
 enum {
   PROP_0,
@@ -37,7 +40,25 @@ static GParamSpec *props[PROP_LAST_PROP];
  *
  * Uses [hunspell](http://hunspell.github.io/) to suggest completions
  * based on typo corrections.
+ *
+ * Dictionaries are loaded in a worker thread. Recently used ones are
+ * kept loaded (within a memory budget) so switching between layouts
+ * of different languages doesn't reload them.
+ */
+/*
+ * Dictionaries are reference counted so lookups can keep using one
+ * while the main thread switches to another or evicts it.
  */
+typedef struct {
+  char      *lang;
+  char      *aff_path;
+  char      *dict_path;
+  Hunhandle *handle;
+  GMutex     lock;     /* serializes lookups, hunspell handles aren't thread safe */
+  gsize      size;
+} PosHunspellDict;
+
+
 struct _PosCompleterHunspell {
   GObject               parent;
 
@@ -46,7 +67,15 @@ struct _PosCompleterHunspell {
   GStrv                 completions;
   guint                 max_completions;
 
-  Hunhandle            *handle;
+  GMutex                dict_mutex;   /* protects dict from the lookup thread */
+  PosHunspellDict      *dict;         /* the dictionary in use */
+  GCancellable         *lookup_cancel;
+
+  char                 *lang;         /* the wanted language */
+  gboolean              loading;      /* whether we wait for lang's dictionary */
+  GQueue                dicts;        /* of PosHunspellDict, most recently used first */
+  gsize                 dicts_size;
+  GHashTable           *pending;      /* languages currently being loaded */
 };
 
 
@@ -71,6 +100,120 @@ pos_completer_hunspell_take_completions (PosCompleter *iface, GStrv completions)
 }
 
 
+static void
+pos_hunspell_dict_clear (PosHunspellDict *dict)
+{
+  g_free (dict->lang);
+  g_free (dict->aff_path);
+  g_free (dict->dict_path);
+  g_clear_pointer (&dict->handle, Hunspell_destroy);
+  g_mutex_clear (&dict->lock);
+}
+
+
+static PosHunspellDict *
+pos_hunspell_dict_new (void)
+{
+  PosHunspellDict *dict = g_atomic_rc_box_new0 (PosHunspellDict);
+
+  g_mutex_init (&dict->lock);
+
+  return dict;
+}
+
+
+static PosHunspellDict *
+pos_hunspell_dict_ref (PosHunspellDict *dict)
+{
+  return g_atomic_rc_box_acquire (dict);
+}
+
+
+static void
+pos_hunspell_dict_unref (PosHunspellDict *dict)
+{
+  g_atomic_rc_box_release_full (dict, (GDestroyNotify)pos_hunspell_dict_clear);
+}
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PosHunspellDict, pos_hunspell_dict_unref)
+
+
+static gsize
+get_file_size (const char *path)
+{
+  GStatBuf st;
+
+  if (g_stat (path, &st) < 0)
+    return 0;
+
+  return st.st_size;
+}
+
+
+static PosHunspellDict *
+find_cached_dict (PosCompleterHunspell *self, const char *lang)
+{
+  for (GList *l = self->dicts.head; l; l = l->next) {
+    PosHunspellDict *dict = l->data;
+
+    if (g_strcmp0 (dict->lang, lang) == 0) {
+      /* Mark as most recently used */
+      g_queue_unlink (&self->dicts, l);
+      g_queue_push_head_link (&self->dicts, l);
+      return dict;
+    }
+  }
+
+  return NULL;
+}
+
+
+/* Lookups still using the old dictionary keep it alive so this never waits for them */
+static void
+set_dict (PosCompleterHunspell *self, PosHunspellDict *dict)
+{
+  g_autoptr (PosHunspellDict) old = NULL;
+
+  g_mutex_lock (&self->dict_mutex);
+  old = g_steal_pointer (&self->dict);
+  if (dict)
+    self->dict = pos_hunspell_dict_ref (dict);
+  g_mutex_unlock (&self->dict_mutex);
+}
+
+
+static void
+evict_dicts (PosCompleterHunspell *self)
+{
+  GList *l = self->dicts.tail;
+
+  while (l && self->dicts_size > DICT_CACHE_BUDGET) {
+    GList *prev = l->prev;
+    PosHunspellDict *dict = l->data;
+
+    /* Never drop the dictionary in use */
+    if (dict != self->dict) {
+      g_debug ("Unloading dictionary for '%s'", dict->lang);
+      self->dicts_size -= dict->size;
+      g_queue_delete_link (&self->dicts, l);
+      pos_hunspell_dict_unref (dict);
+    }
+
+    l = prev;
+  }
+}
+
+
+static void
+set_loading (PosCompleterHunspell *self, gboolean loading)
+{
+  if (self->loading == loading)
+    return;
+
+  self->loading = loading;
+  g_signal_emit_by_name (self, "loading-changed");
+}
+
+
 static const char *
 pos_completer_hunspell_get_preedit (PosCompleter *iface)
 {
@@ -154,7 +297,13 @@ pos_completer_hunspell_finalize (GObject *object)
 {
   PosCompleterHunspell *self = POS_COMPLETER_HUNSPELL(object);
 
-  g_clear_pointer (&self->handle, Hunspell_destroy);
+  g_cancellable_cancel (self->lookup_cancel);
+  g_clear_object (&self->lookup_cancel);
+  g_clear_pointer (&self->dict, pos_hunspell_dict_unref);
+  g_queue_clear_full (&self->dicts, (GDestroyNotify)pos_hunspell_dict_unref);
+  g_clear_pointer (&self->pending, g_hash_table_destroy);
+  g_clear_pointer (&self->lang, g_free);
+  g_mutex_clear (&self->dict_mutex);
   g_clear_pointer (&self->completions, g_strfreev);
   g_string_free (self->preedit, TRUE);
 
@@ -211,6 +360,64 @@ find_dict (const char *lang, const char *region, char **aff_path, char **dict_pa
 }
 
 
+static void
+load_dict_thread (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+  PosHunspellDict *dict = task_data;
+  Hunhandle *handle;
+
+  g_debug ("Loading affix '%s' and dict '%s'", dict->aff_path, dict->dict_path);
+  handle = Hunspell_create (dict->aff_path, dict->dict_path);
+  if (handle == NULL) {
+    g_task_return_new_error (task,
+                             POS_COMPLETER_ERROR,
+                             POS_COMPLETER_ERROR_LANG_INIT,
+                             "Failed to init hunspell for '%s'", dict->lang);
+    return;
+  }
+
+  dict->handle = handle;
+  g_task_return_boolean (task, TRUE);
+}
+
+
+static void pos_completer_hunspell_lookup_preedit (PosCompleterHunspell *self);
+
+static void
+on_dict_loaded (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  PosCompleterHunspell *self = POS_COMPLETER_HUNSPELL (source);
+  PosHunspellDict *dict = g_task_get_task_data (G_TASK (res));
+  g_autoptr (GError) err = NULL;
+
+  g_hash_table_remove (self->pending, dict->lang);
+
+  if (!g_task_propagate_boolean (G_TASK (res), &err)) {
+    g_warning ("%s", err->message);
+    if (g_strcmp0 (dict->lang, self->lang) == 0)
+      set_loading (self, FALSE);
+    return;
+  }
+
+  /* Keep it around even when the language changed in the meantime */
+  g_debug ("Loaded dictionary for '%s'", dict->lang);
+  g_queue_push_head (&self->dicts, pos_hunspell_dict_ref (dict));
+  self->dicts_size += dict->size;
+
+  if (g_strcmp0 (dict->lang, self->lang) == 0) {
+    set_dict (self, dict);
+    set_loading (self, FALSE);
+    if (self->preedit->len)
+      pos_completer_hunspell_lookup_preedit (self);
+  }
+
+  evict_dicts (self);
+}
+
+
 static gboolean
 pos_completer_hunspell_set_language (PosCompleter *completer,
                                      const char   *lang,
@@ -218,9 +425,24 @@ pos_completer_hunspell_set_language (PosCompleter *completer,
                                      GError      **error)
 {
   PosCompleterHunspell *self = POS_COMPLETER_HUNSPELL (completer);
+  g_autofree char *lang_region = g_strdup_printf ("%s-%s", lang, region ?: "");
   g_autofree char *dict_path = NULL;
   g_autofree char *aff_path = NULL;
-  Hunhandle *handle = NULL;
+  g_autoptr (GTask) task = NULL;
+  PosHunspellDict *dict;
+
+  if (g_strcmp0 (self->lang, lang_region) == 0)
+    return TRUE;
+
+  dict = find_cached_dict (self, lang_region);
+  if (dict) {
+    g_debug ("Using loaded dictionary for '%s'", lang_region);
+    g_free (self->lang);
+    self->lang = g_steal_pointer (&lang_region);
+    set_dict (self, dict);
+    set_loading (self, FALSE);
+    return TRUE;
+  }
 
   if (find_dict (lang, region, &aff_path, &dict_path) == FALSE) {
     g_set_error (error,
@@ -230,18 +452,28 @@ pos_completer_hunspell_set_language (PosCompleter *completer,
     return FALSE;
   }
 
-  g_debug ("Using affix '%s' and dict '%s'", aff_path, dict_path);
-  handle = Hunspell_create (aff_path, dict_path);
-  if (handle == NULL) {
-    g_set_error_literal (error,
-                         POS_COMPLETER_ERROR,
-                         POS_COMPLETER_ERROR_ENGINE_INIT,
-                         "Failed to init hunspell");
-    return FALSE;
-  }
+  g_free (self->lang);
+  self->lang = g_strdup (lang_region);
+  set_dict (self, NULL);
+  set_loading (self, TRUE);
 
-  g_clear_pointer (&self->handle, Hunspell_destroy);
-  self->handle = g_steal_pointer (&handle);
+  /* Already on its way */
+  if (g_hash_table_contains (self->pending, lang_region))
+    return TRUE;
+
+  dict = pos_hunspell_dict_new ();
+  dict->lang = g_strdup (lang_region);
+  dict->size = get_file_size (aff_path) + get_file_size (dict_path);
+  dict->aff_path = g_steal_pointer (&aff_path);
+  dict->dict_path = g_steal_pointer (&dict_path);
+
+  g_hash_table_add (self->pending, g_steal_pointer (&lang_region));
+
+  task = g_task_new (self, NULL, on_dict_loaded, NULL);
+  g_task_set_source_tag (task, pos_completer_hunspell_set_language);
+  g_task_set_name (task, "pos-hunspell-load-dict");
+  g_task_set_task_data (task, dict, (GDestroyNotify)pos_hunspell_dict_unref);
+  g_task_run_in_thread (task, load_dict_thread);
 
   return TRUE;
 }
@@ -283,15 +515,92 @@ pos_completer_hunspell_get_name (PosCompleter *iface)
 }
 
 
-static gboolean
-pos_completer_hunspell_feed_symbol (PosCompleter *iface, const char *symbol)
+static GStrv
+pos_completer_hunspell_lookup (PosCompleter  *iface,
+                               const char    *before_text,
+                               const char    *preedit,
+                               GCancellable  *cancellable,
+                               GError       **error)
 {
   PosCompleterHunspell *self = POS_COMPLETER_HUNSPELL (iface);
-  g_autofree char *preedit = g_strdup (self->preedit->str);
+  g_autoptr (PosHunspellDict) dict = NULL;
+  g_autoptr (GMutexLocker) locker = NULL;
   g_autoptr (GPtrArray) completions = g_ptr_array_new ();
   char **suggestions;
   int ret;
 
+  /* Only hold the lock while taking a reference so switching dictionaries never blocks */
+  g_mutex_lock (&self->dict_mutex);
+  if (self->dict)
+    dict = pos_hunspell_dict_ref (self->dict);
+  g_mutex_unlock (&self->dict_mutex);
+
+  /* Switched to a language that isn't loaded yet */
+  if (dict == NULL) {
+    g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_INITIALIZED, "Dictionary not loaded");
+    return NULL;
+  }
+
+  g_debug ("Looking up string '%s'", preedit);
+
+  locker = g_mutex_locker_new (&dict->lock);
+  if (Hunspell_spell (dict->handle, preedit))
+    g_ptr_array_add (completions, g_strdup (preedit));
+
+  ret = Hunspell_suggest (dict->handle, &suggestions, preedit);
+  if (ret > 0) {
+    for (int i = 0; i < ret && i < self->max_completions; i++)
+      g_ptr_array_add (completions, g_strdup (suggestions[i]));
+    Hunspell_free_list (dict->handle, &suggestions, ret);
+  }
+  g_ptr_array_add (completions, NULL);
+
+  return (GStrv)g_ptr_array_steal (completions, NULL);
+}
+
+
+static void
+on_lookup_ready (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  g_autoptr (GError) err = NULL;
+  GStrv completions;
+
+  completions = pos_completer_lookup_finish (POS_COMPLETER (source), res, &err);
+  if (err) {
+    if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED) &&
+        !g_error_matches (err, G_IO_ERROR, G_IO_ERROR_NOT_INITIALIZED))
+      g_warning ("Failed to lookup completions: %s", err->message);
+    return;
+  }
+
+  pos_completer_hunspell_take_completions (POS_COMPLETER (source), completions);
+}
+
+
+static void
+pos_completer_hunspell_lookup_preedit (PosCompleterHunspell *self)
+{
+  g_cancellable_cancel (self->lookup_cancel);
+  g_clear_object (&self->lookup_cancel);
+
+  /* Looked up once the dictionary is loaded */
+  if (self->loading)
+    return;
+
+  self->lookup_cancel = g_cancellable_new ();
+  pos_completer_lookup_async (POS_COMPLETER (self),
+                              self->lookup_cancel,
+                              on_lookup_ready,
+                              NULL);
+}
+
+
+static gboolean
+pos_completer_hunspell_feed_symbol (PosCompleter *iface, const char *symbol)
+{
+  PosCompleterHunspell *self = POS_COMPLETER_HUNSPELL (iface);
+  g_autofree char *preedit = g_strdup (self->preedit->str);
+
   if (pos_completer_add_preedit (POS_COMPLETER (self), self->preedit, symbol)) {
     g_signal_emit_by_name (self, "commit-string", self->preedit->str);
     pos_completer_hunspell_set_preedit (POS_COMPLETER (self), NULL);
@@ -309,21 +618,17 @@ pos_completer_hunspell_feed_symbol (PosCompleter *iface, const char *symbol)
 
   g_object_notify_by_pspec (G_OBJECT (self), props[PROP_PREEDIT]);
 
-  g_debug ("Looking up string '%s'", self->preedit->str);
+  pos_completer_hunspell_lookup_preedit (self);
+  return TRUE;
+}
 
-  if (Hunspell_spell (self->handle, self->preedit->str))
-    g_ptr_array_add (completions, g_strdup (self->preedit->str));
 
-  ret = Hunspell_suggest (self->handle, &suggestions, self->preedit->str);
-  if (ret > 0) {
-    for (int i = 0; i < ret && i < self->max_completions; i++)
-      g_ptr_array_add (completions, g_strdup (suggestions[i]));
-  }
-  g_ptr_array_add (completions, NULL);
+static gboolean
+pos_completer_hunspell_is_loading (PosCompleter *iface)
+{
+  PosCompleterHunspell *self = POS_COMPLETER_HUNSPELL (iface);
 
-  pos_completer_hunspell_take_completions (POS_COMPLETER (self),
-                                           (char **)g_ptr_array_steal (completions, NULL));
-  return TRUE;
+  return self->loading;
 }
 
 
@@ -335,6 +640,8 @@ pos_completer_hunspell_interface_init (PosCompleterInterface *iface)
   iface->get_preedit = pos_completer_hunspell_get_preedit;
   iface->set_preedit = pos_completer_hunspell_set_preedit;
   iface->set_language = pos_completer_hunspell_set_language;
+  iface->lookup = pos_completer_hunspell_lookup;
+  iface->is_loading = pos_completer_hunspell_is_loading;
 }
 
 
@@ -344,6 +651,9 @@ pos_completer_hunspell_init (PosCompleterHunspell *self)
   self->max_completions = MAX_COMPLETIONS;
   self->preedit = g_string_new (NULL);
   self->name = "hunspell";
+  self->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  g_queue_init (&self->dicts);
+  g_mutex_init (&self->dict_mutex);
 }
 
 /**
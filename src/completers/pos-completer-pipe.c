@@ -16,9 +16,15 @@
 #include <gio/gio.h>
 #include <gio/gunixinputstream.h>
 
+#include <errno.h>
+#include <sys/socket.h>
 #include <sys/types.h>
-#include <signal.h>
+#include <unistd.h>
 
+/* Give up respawning a crashing co-process after that many attempts without a reply */
+#define MAX_RESTARTS 3
+/* Consider a co-process hung if it didn't reply to a request within that time */
+#define REPLY_TIMEOUT_MS 2000
 
 enum {
   PROP_0,
@@ -39,6 +45,13 @@ static GParamSpec *props[PROP_LAST_PROP];
  * This completer feeds the preedit to standard input
  * of the given executable and reads the possible completioins
  * from standard output.
+ *
+ * By default the executable is spawned for each preedit change. In
+ * persistent mode it is spawned once and kept running. Each request
+ * is then a single line `<id>\t<preedit>\n` on standard input and the
+ * executable answers with a single line `<id>\t<completion>\t…\n` on
+ * standard output. Answers with an outdated id are dropped. Should the
+ * executable exit it is restarted.
  */
 struct _PosCompleterPipe {
   GObject       parent;
@@ -51,8 +64,25 @@ struct _PosCompleterPipe {
   GStrv         command;
   GSubprocess  *proc;
   GCancellable *cancel;
+
+  /* persistent mode */
+  gboolean          persistent;
+  GCancellable     *proc_cancel;
+  GIOStream        *proc_conn;
+  GOutputStream    *proc_stdin;
+  GDataInputStream *proc_stdout;
+  guint64           request_id;
+  guint             reply_timeout_id;
+  gboolean          writing;
+  char             *queued_request;
+  guint             restarts;
 };
 
+typedef struct {
+  PosCompleterPipe *self;
+  char             *request;
+} PosPipeRequest;
+
 
 static void pos_completer_pipe_interface_init (PosCompleterInterface *iface);
 static void pos_completer_pipe_initable_interface_init (GInitableIface *iface);
@@ -85,6 +115,15 @@ pos_completer_pipe_get_preedit (PosCompleter *iface)
 }
 
 
+/* Make sure replies to in flight requests get dropped */
+static void
+pos_completer_pipe_drop_pending (PosCompleterPipe *self)
+{
+  self->request_id++;
+  g_clear_handle_id (&self->reply_timeout_id, g_source_remove);
+}
+
+
 static void
 pos_completer_pipe_set_preedit (PosCompleter *iface, const char *preedit)
 {
@@ -93,6 +132,7 @@ pos_completer_pipe_set_preedit (PosCompleter *iface, const char *preedit)
   if (g_strcmp0 (self->preedit->str, preedit) == 0)
     return;
 
+  pos_completer_pipe_drop_pending (self);
   g_string_truncate (self->preedit, 0);
   if (preedit)
     g_string_append (self->preedit, preedit);
@@ -104,6 +144,25 @@ pos_completer_pipe_set_preedit (PosCompleter *iface, const char *preedit)
 }
 
 
+static void
+pos_completer_pipe_stop_coproc (PosCompleterPipe *self)
+{
+  g_cancellable_cancel (self->proc_cancel);
+  g_clear_object (&self->proc_cancel);
+  g_clear_handle_id (&self->reply_timeout_id, g_source_remove);
+
+  /* No-op if the process already exited */
+  if (self->persistent && self->proc)
+    g_subprocess_force_exit (self->proc);
+
+  g_clear_object (&self->proc_stdin);
+  g_clear_object (&self->proc_conn);
+  g_clear_object (&self->proc_stdout);
+  g_clear_pointer (&self->queued_request, g_free);
+  self->writing = FALSE;
+}
+
+
 static void
 pos_completer_pipe_set_property (GObject      *object,
                                  guint         property_id,
@@ -159,6 +218,7 @@ pos_completer_pipe_finalize (GObject *object)
 {
   PosCompleterPipe *self = POS_COMPLETER_PIPE (object);
 
+  pos_completer_pipe_stop_coproc (self);
   g_clear_object (&self->settings);
 
   g_cancellable_cancel (self->cancel);
@@ -246,7 +306,9 @@ pos_completer_pipe_initable_init (GInitable    *initable,
     return FALSE;
   }
 
-  g_debug ("Using command '%s'", self->command[0]);
+  self->persistent = g_settings_get_boolean (self->settings, "persistent");
+
+  g_debug ("Using command '%s'%s", self->command[0], self->persistent ? " (persistent)" : "");
   return TRUE;
 }
 
@@ -312,6 +374,266 @@ out:
 }
 
 
+static void pos_completer_pipe_send_request (PosCompleterPipe *self);
+static gboolean pos_completer_pipe_spawn_coproc (PosCompleterPipe *self, GError **err);
+static void on_request_written (GObject *source, GAsyncResult *res, gpointer user_data);
+
+
+static void
+pos_pipe_request_free (PosPipeRequest *request)
+{
+  g_free (request->request);
+  g_free (request);
+}
+
+
+static void
+pos_completer_pipe_write_request (PosCompleterPipe *self, char *request_str)
+{
+  PosPipeRequest *request = g_new0 (PosPipeRequest, 1);
+
+  request->self = self;
+  request->request = request_str;
+  self->writing = TRUE;
+
+  g_output_stream_write_all_async (self->proc_stdin,
+                                   request->request,
+                                   strlen (request->request),
+                                   G_PRIORITY_DEFAULT,
+                                   self->proc_cancel,
+                                   on_request_written,
+                                   request);
+}
+
+
+static void
+on_request_written (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  PosPipeRequest *request = user_data;
+  PosCompleterPipe *self;
+  g_autoptr (GError) err = NULL;
+  gboolean success;
+
+  success = g_output_stream_write_all_finish (G_OUTPUT_STREAM (source), res, NULL, &err);
+  if (!success && g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    /* Co-process got stopped, self might be gone */
+    pos_pipe_request_free (request);
+    return;
+  }
+
+  self = POS_COMPLETER_PIPE (request->self);
+  pos_pipe_request_free (request);
+  self->writing = FALSE;
+
+  if (!success) {
+    /* The request is lost, respawn and resend in on_coproc_exited */
+    g_warning ("Failed to send request to %s: %s", self->command[0], err->message);
+    if (G_OUTPUT_STREAM (source) == self->proc_stdin)
+      g_subprocess_force_exit (self->proc);
+    return;
+  }
+
+  /* Only the most recent preedit got queued while we were writing */
+  if (self->queued_request)
+    pos_completer_pipe_write_request (self, g_steal_pointer (&self->queued_request));
+}
+
+
+static void
+on_reply_timeout (gpointer data)
+{
+  PosCompleterPipe *self = POS_COMPLETER_PIPE (data);
+
+  self->reply_timeout_id = 0;
+
+  /* The respawn and resend is handled in on_coproc_exited */
+  g_warning ("%s didn't reply within %d ms, restarting", self->command[0], REPLY_TIMEOUT_MS);
+  g_subprocess_force_exit (self->proc);
+}
+
+
+static void
+pos_completer_pipe_arm_reply_timeout (PosCompleterPipe *self)
+{
+  g_clear_handle_id (&self->reply_timeout_id, g_source_remove);
+  self->reply_timeout_id = g_timeout_add_once (REPLY_TIMEOUT_MS, on_reply_timeout, self);
+  g_source_set_name_by_id (self->reply_timeout_id, "[pos-completer-pipe] reply timeout");
+}
+
+
+static void
+on_coproc_line_read (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  PosCompleterPipe *self;
+  g_autoptr (GError) err = NULL;
+  g_autofree char *line = NULL;
+  g_auto (GStrv) completions = NULL;
+  guint64 id;
+  char *sep;
+
+  line = g_data_input_stream_read_line_finish_utf8 (G_DATA_INPUT_STREAM (source), res, NULL, &err);
+  if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  self = POS_COMPLETER_PIPE (user_data);
+  if (err) {
+    g_warning ("Failed to read from %s: %s", self->command[0], err->message);
+    if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_INVALID_DATA))
+      goto next;
+  }
+
+  if (line == NULL) {
+    /* We can't get replies anymore. Make sure the co-process is gone,
+     * the respawn is handled in on_coproc_exited */
+    if (G_DATA_INPUT_STREAM (source) == self->proc_stdout)
+      g_subprocess_force_exit (self->proc);
+    return;
+  }
+
+  sep = strchr (line, '\t');
+  if (sep)
+    *sep = '\0';
+
+  if (!g_ascii_string_to_unsigned (line, 10, 0, G_MAXUINT64, &id, NULL)) {
+    g_warning ("Malformed response from %s: '%s'", self->command[0], line);
+    goto next;
+  }
+
+  if (id != self->request_id) {
+    g_debug ("Dropping stale response %" G_GUINT64_FORMAT ", current is %" G_GUINT64_FORMAT,
+             id, self->request_id);
+    /* Still alive, give the current request its full time */
+    if (self->reply_timeout_id)
+      pos_completer_pipe_arm_reply_timeout (self);
+    goto next;
+  }
+
+  self->restarts = 0;
+  g_clear_handle_id (&self->reply_timeout_id, g_source_remove);
+  if (sep && sep[1] != '\0')
+    completions = g_strsplit (sep + 1, "\t", -1);
+  pos_completer_cache_completions (POS_COMPLETER (self), self->preedit->str, completions);
+  pos_completer_pipe_set_completions (POS_COMPLETER (self), completions);
+
+ next:
+  g_data_input_stream_read_line_async (self->proc_stdout,
+                                       G_PRIORITY_DEFAULT,
+                                       self->proc_cancel,
+                                       on_coproc_line_read,
+                                       self);
+}
+
+
+static void
+on_coproc_exited (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  PosCompleterPipe *self;
+  g_autoptr (GError) err = NULL;
+  g_autoptr (GError) spawn_err = NULL;
+
+  if (!g_subprocess_wait_finish (G_SUBPROCESS (source), res, &err) &&
+      g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    return;
+  }
+
+  self = POS_COMPLETER_PIPE (user_data);
+  if (G_SUBPROCESS (source) != self->proc)
+    return;
+
+  g_warning ("%s exited unexpectedly", self->command[0]);
+  pos_completer_pipe_stop_coproc (self);
+  g_clear_object (&self->proc);
+
+  if (self->restarts >= MAX_RESTARTS) {
+    g_warning ("%s keeps exiting, will respawn on next input", self->command[0]);
+    return;
+  }
+
+  self->restarts++;
+  if (!pos_completer_pipe_spawn_coproc (self, &spawn_err)) {
+    g_warning ("Failed to respawn %s: %s", self->command[0], spawn_err->message);
+    return;
+  }
+
+  /* Resend what got lost */
+  if (self->preedit->len)
+    pos_completer_pipe_send_request (self);
+}
+
+
+static gboolean
+pos_completer_pipe_spawn_coproc (PosCompleterPipe *self, GError **err)
+{
+  g_autoptr (GSubprocessLauncher) launcher = NULL;
+  g_autoptr (GSocket) socket = NULL;
+  int fds[2];
+
+  g_assert (self->proc == NULL);
+
+  /* Feed the co-process via a socket rather than a pipe: GSocket sends with
+   * MSG_NOSIGNAL so a dying co-process gives EPIPE rather than SIGPIPE */
+  if (socketpair (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+    int saved_errno = errno;
+
+    g_set_error (err, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                 "Failed to create socket pair: %s", g_strerror (saved_errno));
+    return FALSE;
+  }
+
+  socket = g_socket_new_from_fd (fds[0], err);
+  if (socket == NULL) {
+    close (fds[0]);
+    close (fds[1]);
+    return FALSE;
+  }
+
+  launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_STDOUT_PIPE);
+  /* The launcher closes our copy of the co-process' end */
+  g_subprocess_launcher_take_stdin_fd (launcher, fds[1]);
+  self->proc = g_subprocess_launcher_spawnv (launcher, (const char * const *)self->command, err);
+  if (self->proc == NULL)
+    return FALSE;
+
+  g_debug ("Spawned %s as %s", self->command[0], g_subprocess_get_identifier (self->proc));
+
+  self->proc_cancel = g_cancellable_new ();
+  self->proc_conn = G_IO_STREAM (g_socket_connection_factory_create_connection (socket));
+  self->proc_stdin = g_object_ref (g_io_stream_get_output_stream (self->proc_conn));
+  self->proc_stdout = g_data_input_stream_new (g_subprocess_get_stdout_pipe (self->proc));
+  g_data_input_stream_set_newline_type (self->proc_stdout, G_DATA_STREAM_NEWLINE_TYPE_LF);
+
+  g_data_input_stream_read_line_async (self->proc_stdout,
+                                       G_PRIORITY_DEFAULT,
+                                       self->proc_cancel,
+                                       on_coproc_line_read,
+                                       self);
+  g_subprocess_wait_async (self->proc, self->proc_cancel, on_coproc_exited, self);
+
+  return TRUE;
+}
+
+
+static void
+pos_completer_pipe_send_request (PosCompleterPipe *self)
+{
+  char *request;
+
+  request = g_strdup_printf ("%" G_GUINT64_FORMAT "\t%s\n", ++self->request_id, self->preedit->str);
+
+  /* Keep the deadline of older requests so constant typing can't starve it */
+  if (self->reply_timeout_id == 0)
+    pos_completer_pipe_arm_reply_timeout (self);
+
+  if (self->writing) {
+    g_free (self->queued_request);
+    self->queued_request = request;
+    return;
+  }
+
+  pos_completer_pipe_write_request (self, request);
+}
+
+
 static gboolean
 pos_completer_pipe_feed_symbol (PosCompleter *iface, const char *symbol)
 {
@@ -337,6 +659,26 @@ pos_completer_pipe_feed_symbol (PosCompleter *iface, const char *symbol)
   g_object_notify_by_pspec (G_OBJECT (self), props[PROP_PREEDIT]);
   g_debug ("Looking up string '%s'", self->preedit->str);
 
+  if (self->persistent) {
+    GStrv completions = NULL;
+
+    /* Only the co-process' replies can be matched to their preedit */
+    if (pos_completer_lookup_cached (POS_COMPLETER (self), self->preedit->str, &completions)) {
+      pos_completer_pipe_drop_pending (self);
+      pos_completer_pipe_set_completions (POS_COMPLETER (self), completions);
+      g_strfreev (completions);
+      return TRUE;
+    }
+
+    if (self->proc == NULL && !pos_completer_pipe_spawn_coproc (self, &err)) {
+      g_warning ("Failed to spawn pipe: %s", err->message);
+      return FALSE;
+    }
+
+    pos_completer_pipe_send_request (self);
+    return TRUE;
+  }
+
   if (self->proc && g_subprocess_get_if_exited (self->proc) == FALSE) {
     g_debug ("Killing slow %s", g_subprocess_get_identifier (self->proc));
     g_subprocess_force_exit (self->proc);
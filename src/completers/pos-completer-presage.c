@@ -62,6 +62,7 @@ struct _PosCompleterPresage {
   GStrv                 completions;
   guint                 max_completions;
 
+  GMutex                presage_mutex; /* protects presage from the lookup thread */
   presage_t             presage;
   char                 *presage_past;
   char                 *presage_future;
@@ -69,6 +70,7 @@ struct _PosCompleterPresage {
   char                 *lang;
 
   gboolean              updating_preedit;
+  GCancellable         *lookup_cancel;
 };
 
 
@@ -96,18 +98,35 @@ pos_completer_presage_set_completions (PosCompleter *iface, GStrv completions)
 
 
 static void
-pos_completer_presage_predict (PosCompleterPresage *self)
+on_lookup_ready (GObject *source, GAsyncResult *res, gpointer user_data)
 {
-  presage_error_code_t result;
+  PosCompleterPresage *self;
+  g_autoptr (GError) err = NULL;
   g_auto (GStrv) completions = NULL;
 
-  result = presage_predict (self->presage, &completions);
-  if (result == PRESAGE_OK) {
-    pos_completer_presage_set_completions (POS_COMPLETER (self), completions);
-  } else {
-    g_warning ("Failed to complete %s", self->preedit->str);
-    pos_completer_presage_set_completions (POS_COMPLETER (self), NULL);
+  completions = pos_completer_lookup_finish (POS_COMPLETER (source), res, &err);
+  if (err) {
+    if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      return;
+
+    g_warning ("%s", err->message);
   }
+
+  self = POS_COMPLETER_PRESAGE (source);
+  pos_completer_presage_set_completions (POS_COMPLETER (self), completions);
+}
+
+
+static void
+pos_completer_presage_predict (PosCompleterPresage *self)
+{
+  g_cancellable_cancel (self->lookup_cancel);
+  g_clear_object (&self->lookup_cancel);
+  self->lookup_cancel = g_cancellable_new ();
+  pos_completer_lookup_async (POS_COMPLETER (self),
+                              self->lookup_cancel,
+                              on_lookup_ready,
+                              NULL);
 }
 
 
@@ -158,6 +177,25 @@ pos_completer_presage_get_after_text (PosCompleter *iface)
 }
 
 
+static void
+pos_completer_presage_take_surrounding_text (PosCompleterPresage *self,
+                                             char                *before_text,
+                                             char                *after_text)
+{
+  g_free (self->after_text);
+  self->after_text = after_text;
+
+  g_free (self->before_text);
+  self->before_text = before_text;
+
+  pos_completer_presage_predict (self);
+
+  g_debug ("Updating:  b:'%s', a:'%s'", self->before_text, self->after_text);
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_BEFORE_TEXT]);
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_AFTER_TEXT]);
+}
+
+
 static void
 pos_completer_presage_set_surrounding_text (PosCompleter *iface,
                                             const char   *before_text,
@@ -170,17 +208,33 @@ pos_completer_presage_set_surrounding_text (PosCompleter *iface,
     return;
   }
 
-  g_free (self->after_text);
-  self->after_text = g_strdup (after_text);
+  pos_completer_presage_take_surrounding_text (self, g_strdup (before_text), g_strdup (after_text));
+}
 
-  g_free (self->before_text);
-  self->before_text = g_strdup (before_text);
 
-  pos_completer_presage_predict (self);
+static void
+pos_completer_presage_update_surrounding_text (PosCompleter *iface,
+                                               const char   *text,
+                                               guint         cursor)
+{
+  PosCompleterPresage *self = POS_COMPLETER_PRESAGE (iface);
 
-  g_debug ("Updating:  b:'%s', a:'%s'", self->before_text, self->after_text);
-  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_BEFORE_TEXT]);
-  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_AFTER_TEXT]);
+  if (text == NULL) {
+    pos_completer_presage_set_surrounding_text (iface, NULL, NULL);
+    return;
+  }
+
+  /* Only copy the text when it changed so we don't predict again */
+  if (self->before_text && self->after_text &&
+      strlen (self->before_text) == cursor &&
+      strncmp (self->before_text, text, cursor) == 0 &&
+      g_strcmp0 (self->after_text, &text[cursor]) == 0) {
+    return;
+  }
+
+  pos_completer_presage_take_surrounding_text (self,
+                                               g_strndup (text, cursor),
+                                               g_strdup (&text[cursor]));
 }
 
 
@@ -191,6 +245,7 @@ pos_completer_presage_set_language (PosCompleter *completer,
                                     GError      **error)
 {
   PosCompleterPresage *self = POS_COMPLETER_PRESAGE (completer);
+  g_autoptr (GMutexLocker) locker = NULL;
   g_autofree char *dbdir = NULL;
   g_autofree char *dbfile = NULL;
   g_autofree char *dbpath = NULL;
@@ -203,6 +258,8 @@ pos_completer_presage_set_language (PosCompleter *completer,
   if (g_strcmp0 (self->lang, lang) == 0)
     return TRUE;
 
+  locker = g_mutex_locker_new (&self->presage_mutex);
+
   g_debug ("Switching to language '%s'", lang);
 
 #ifdef POS_HAVE_PRESAGE2
@@ -312,6 +369,8 @@ pos_completer_presage_finalize (GObject *object)
 {
   PosCompleterPresage *self = POS_COMPLETER_PRESAGE (object);
 
+  g_cancellable_cancel (self->lookup_cancel);
+  g_clear_object (&self->lookup_cancel);
   g_clear_pointer (&self->completions, g_strfreev);
   g_string_free (self->preedit, TRUE);
   g_clear_pointer (&self->before_text, g_free);
@@ -320,6 +379,7 @@ pos_completer_presage_finalize (GObject *object)
   g_clear_pointer (&self->presage_future, g_free);
   g_clear_pointer (&self->lang, g_free);
   presage_free (self->presage);
+  g_mutex_clear (&self->presage_mutex);
 
   G_OBJECT_CLASS (pos_completer_presage_parent_class)->finalize (object);
 }
@@ -351,16 +411,14 @@ pos_completer_presage_class_init (PosCompleterPresageClass *klass)
 }
 
 
+/* Invoked by presage from within the lookup thread */
 static const char*
 pos_completer_presage_get_past_stream (void *data)
 {
   PosCompleterPresage *self = POS_COMPLETER_PRESAGE (data);
 
-  g_free (self->presage_past);
-  self->presage_past = g_strdup_printf ("%s%s", self->before_text ?: "", self->preedit->str);
-
   g_debug ("Past: %s", self->presage_past);
-  return self->presage_past;
+  return self->presage_past ?: "";
 }
 
 
@@ -432,6 +490,32 @@ pos_completer_presage_get_name (PosCompleter *iface)
 }
 
 
+static GStrv
+pos_completer_presage_lookup (PosCompleter  *iface,
+                              const char    *before_text,
+                              const char    *preedit,
+                              GCancellable  *cancellable,
+                              GError       **error)
+{
+  PosCompleterPresage *self = POS_COMPLETER_PRESAGE (iface);
+  g_autoptr (GMutexLocker) locker = g_mutex_locker_new (&self->presage_mutex);
+  presage_error_code_t result;
+  GStrv completions = NULL;
+
+  g_free (self->presage_past);
+  self->presage_past = g_strdup_printf ("%s%s", before_text ?: "", preedit);
+
+  result = presage_predict (self->presage, &completions);
+  if (result != PRESAGE_OK) {
+    g_set_error (error, POS_COMPLETER_ERROR, POS_COMPLETER_ERROR_ENGINE_INIT,
+                 "Failed to complete %s", preedit);
+    return NULL;
+  }
+
+  return completions;
+}
+
+
 static gboolean
 pos_completer_presage_feed_symbol (PosCompleter *iface, const char *symbol)
 {
@@ -476,7 +560,9 @@ pos_completer_presage_interface_init (PosCompleterInterface *iface)
   iface->get_before_text = pos_completer_presage_get_before_text;
   iface->get_after_text = pos_completer_presage_get_after_text;
   iface->set_surrounding_text = pos_completer_presage_set_surrounding_text;
+  iface->update_surrounding_text = pos_completer_presage_update_surrounding_text;
   iface->set_language = pos_completer_presage_set_language;
+  iface->lookup = pos_completer_presage_lookup;
 }
 
 
@@ -486,6 +572,7 @@ pos_completer_presage_init (PosCompleterPresage *self)
   self->max_completions = MAX_COMPLETIONS;
   self->preedit = g_string_new (NULL);
   self->name = "presage";
+  g_mutex_init (&self->presage_mutex);
 }
 
 /**
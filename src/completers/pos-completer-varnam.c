@@ -53,8 +53,10 @@ struct _PosCompleterVarnam {
   guint                 max_completions;
 
   char                 *lang;
+  GMutex                handle_mutex; /* protects varnam_handle_id from the lookup thread */
   int                   varnam_handle_id;
   SchemeDetails        *vscheme_details;
+  GCancellable         *lookup_cancel;
 };
 
 
@@ -165,10 +167,13 @@ pos_completer_varnam_finalize (GObject *object)
 {
   PosCompleterVarnam *self = POS_COMPLETER_VARNAM(object);
 
+  g_cancellable_cancel (self->lookup_cancel);
+  g_clear_object (&self->lookup_cancel);
   if (self->varnam_handle_id >= 0) {
     varnam_close (self->varnam_handle_id);
     self->varnam_handle_id = -1;
   }
+  g_mutex_clear (&self->handle_mutex);
   g_clear_pointer (&self->lang, g_free);
 
   g_clear_pointer (&self->name, g_free);
@@ -212,6 +217,7 @@ pos_completer_varnam_set_language (PosCompleter *completer,
                                    GError      **error)
 {
   PosCompleterVarnam *self = POS_COMPLETER_VARNAM (completer);
+  g_autoptr (GMutexLocker) locker = NULL;
   gboolean ret;
 
   g_return_val_if_fail (POS_IS_COMPLETER_VARNAM (self), FALSE);
@@ -219,6 +225,8 @@ pos_completer_varnam_set_language (PosCompleter *completer,
   if (g_strcmp0 (self->lang, lang) == 0)
     return TRUE;
 
+  locker = g_mutex_locker_new (&self->handle_mutex);
+
   g_clear_pointer (&self->lang, g_free);
   if (self->varnam_handle_id >= 0)
     varnam_close (self->varnam_handle_id);
@@ -275,47 +283,38 @@ pos_completer_varnam_get_name (PosCompleter *iface)
 }
 
 
-static gboolean
-pos_completer_varnam_feed_symbol (PosCompleter *iface, const char *symbol)
+static GStrv
+pos_completer_varnam_lookup (PosCompleter  *iface,
+                             const char    *before_text,
+                             const char    *preedit,
+                             GCancellable  *cancellable,
+                             GError       **error)
 {
   PosCompleterVarnam *self = POS_COMPLETER_VARNAM (iface);
-  g_autofree char *preedit = g_strdup (self->preedit->str);
+  g_autoptr (GMutexLocker) locker = g_mutex_locker_new (&self->handle_mutex);
   g_autoptr (GPtrArray) completions = g_ptr_array_new ();
   varray *suggestions;
   int ret;
   int transliteration_id = 1;
   char *last = NULL;
 
-  g_return_val_if_fail (self->varnam_handle_id >= 0, FALSE);
-
-  if (pos_completer_add_preedit (POS_COMPLETER (self), self->preedit, symbol)) {
-    g_signal_emit_by_name (self, "commit-string", self->preedit->str);
-    pos_completer_varnam_set_preedit (POS_COMPLETER (self), NULL);
-
-    /* Make sure enter is processed as raw keystroke */
-    if (g_strcmp0 (symbol, "KEY_ENTER") == 0)
-      return FALSE;
-
-    return TRUE;
+  if (self->varnam_handle_id < 0) {
+    g_set_error_literal (error, POS_COMPLETER_ERROR, POS_COMPLETER_ERROR_LANG_INIT,
+                         "No varnam scheme loaded");
+    return NULL;
   }
 
-  /* preedit didn't change and wasn't committed so we didn't handle it */
-  if (g_strcmp0 (self->preedit->str, preedit) == 0)
-    return FALSE;
-
-  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_PREEDIT]);
-
-  g_debug ("Looking up string '%s'", self->preedit->str);
+  g_debug ("Looking up string '%s'", preedit);
 
   varnam_cancel (transliteration_id);
-  ret = varnam_transliterate (self->varnam_handle_id, transliteration_id, self->preedit->str, &suggestions);
+  ret = varnam_transliterate (self->varnam_handle_id, transliteration_id, (char *)preedit, &suggestions);
   if (ret != VARNAM_SUCCESS) {
-    g_warning ("Failed to transliterate: %s\n", varnam_get_last_error (self->varnam_handle_id));
-    pos_completer_varnam_take_completions (POS_COMPLETER (self), NULL);
-    return FALSE;
+    g_set_error (error, POS_COMPLETER_ERROR, POS_COMPLETER_ERROR_ENGINE_INIT,
+                 "Failed to transliterate: %s", varnam_get_last_error (self->varnam_handle_id));
+    return NULL;
   }
 
-  g_ptr_array_add (completions, g_strdup (self->preedit->str));
+  g_ptr_array_add (completions, g_strdup (preedit));
   for (int i = 0; i < varray_length (suggestions) && i < self->max_completions - 1; i++) {
     Suggestion *sug = varray_get (suggestions, i);
 
@@ -329,9 +328,60 @@ pos_completer_varnam_feed_symbol (PosCompleter *iface, const char *symbol)
   }
   g_ptr_array_add (completions, NULL);
 
-  pos_completer_varnam_take_completions (POS_COMPLETER (self),
-                                         (char **)g_ptr_array_steal (completions, NULL));
+  return (GStrv)g_ptr_array_steal (completions, NULL);
+}
+
+
+static void
+on_lookup_ready (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  g_autoptr (GError) err = NULL;
+  GStrv completions;
+
+  completions = pos_completer_lookup_finish (POS_COMPLETER (source), res, &err);
+  if (err) {
+    if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      return;
+
+    g_warning ("%s", err->message);
+  }
 
+  pos_completer_varnam_take_completions (POS_COMPLETER (source), completions);
+}
+
+
+static gboolean
+pos_completer_varnam_feed_symbol (PosCompleter *iface, const char *symbol)
+{
+  PosCompleterVarnam *self = POS_COMPLETER_VARNAM (iface);
+  g_autofree char *preedit = g_strdup (self->preedit->str);
+
+  g_return_val_if_fail (self->varnam_handle_id >= 0, FALSE);
+
+  if (pos_completer_add_preedit (POS_COMPLETER (self), self->preedit, symbol)) {
+    g_signal_emit_by_name (self, "commit-string", self->preedit->str);
+    pos_completer_varnam_set_preedit (POS_COMPLETER (self), NULL);
+
+    /* Make sure enter is processed as raw keystroke */
+    if (g_strcmp0 (symbol, "KEY_ENTER") == 0)
+      return FALSE;
+
+    return TRUE;
+  }
+
+  /* preedit didn't change and wasn't committed so we didn't handle it */
+  if (g_strcmp0 (self->preedit->str, preedit) == 0)
+    return FALSE;
+
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_PREEDIT]);
+
+  g_cancellable_cancel (self->lookup_cancel);
+  g_clear_object (&self->lookup_cancel);
+  self->lookup_cancel = g_cancellable_new ();
+  pos_completer_lookup_async (POS_COMPLETER (self),
+                              self->lookup_cancel,
+                              on_lookup_ready,
+                              NULL);
   return TRUE;
 }
 
@@ -349,6 +399,12 @@ static void
 pos_completer_varnam_learn_accepted (PosCompleter *iface, const char *word)
 {
   PosCompleterVarnam *self = POS_COMPLETER_VARNAM (iface);
+  g_autoptr (GMutexLocker) locker = NULL;
+
+  /* The lookup thread might be using the handle */
+  locker = g_mutex_locker_new (&self->handle_mutex);
+  if (self->varnam_handle_id < 0)
+    return;
 
   g_debug ("Learning %s", word);
   varnam_learn (self->varnam_handle_id, g_strdup (word), 0);
@@ -365,6 +421,7 @@ pos_completer_varnam_interface_init (PosCompleterInterface *iface)
   iface->set_language = pos_completer_varnam_set_language;
   iface->get_display_name = pos_completer_varnam_get_display_name;
   iface->learn_accepted = pos_completer_varnam_learn_accepted;
+  iface->lookup = pos_completer_varnam_lookup;
 }
 
 
@@ -372,6 +429,7 @@ static void
 pos_completer_varnam_init (PosCompleterVarnam *self)
 {
   self->varnam_handle_id = -1;
+  g_mutex_init (&self->handle_mutex);
   self->max_completions = MAX_COMPLETIONS;
   self->preedit = g_string_new (NULL);
 }
@@ -0,0 +1,475 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "pos-completer-wordlist"
+
+#include "pos-config.h"
+
+#include "pos-completer-priv.h"
+#include "pos-completer-wordlist.h"
+#include "pos-word-index.h"
+
+#include <gio/gio.h>
+
+#define MAX_COMPLETIONS 3
+#define MAX_CANDIDATES  256
+#define WORD_LIST       "/usr/share/dict/words"
+
+enum {
+  PROP_0,
+  PROP_NAME,
+  PROP_PREEDIT,
+  PROP_BEFORE_TEXT,
+  PROP_AFTER_TEXT,
+  PROP_COMPLETIONS,
+  PROP_LAST_PROP
+};
+static GParamSpec *props[PROP_LAST_PROP];
+
+/**
+ * PosCompleterWordlist:
+ *
+ * A completer using a prefix index over a word list.
+ *
+ * Completes the preedit with the most frequent words from a hunspell
+ * dictionary or the system's word list. The index is built once, kept
+ * in the user's cache directory and mapped into memory so lookups are
+ * cheap and hardly use any resident memory. When characters get
+ * appended to the preedit the candidates of the previous lookup are
+ * filtered instead of walking the index again.
+ *
+ * Building the index (on first use or when the word list changed)
+ * happens in a worker thread.
+ */
+struct _PosCompleterWordlist {
+  GObject               parent;
+
+  char                 *name;
+  GString              *preedit;
+  GStrv                 completions;
+  guint                 max_completions;
+
+  PosWordIndex         *index;
+  PosCompleterRefiner  *refiner;
+  char                 *lang;         /* the wanted language */
+  gboolean              loading;      /* whether we wait for lang's index */
+  GCancellable         *load_cancel;
+};
+
+
+static void pos_completer_wordlist_interface_init (PosCompleterInterface *iface);
+static void pos_completer_wordlist_initable_interface_init (GInitableIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (PosCompleterWordlist, pos_completer_wordlist, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (POS_TYPE_COMPLETER,
+                                                pos_completer_wordlist_interface_init)
+                         G_IMPLEMENT_INTERFACE (G_TYPE_INITABLE,
+                                                pos_completer_wordlist_initable_interface_init))
+
+static void
+pos_completer_wordlist_take_completions (PosCompleter *iface, GStrv completions)
+{
+  PosCompleterWordlist *self = POS_COMPLETER_WORDLIST (iface);
+
+  g_strfreev (self->completions);
+  self->completions = completions;
+
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_COMPLETIONS]);
+}
+
+
+static const char *
+pos_completer_wordlist_get_preedit (PosCompleter *iface)
+{
+  PosCompleterWordlist *self = POS_COMPLETER_WORDLIST (iface);
+
+  return self->preedit->str;
+}
+
+
+static void
+pos_completer_wordlist_set_preedit (PosCompleter *iface, const char *preedit)
+{
+  PosCompleterWordlist *self = POS_COMPLETER_WORDLIST (iface);
+
+  if (g_strcmp0 (self->preedit->str, preedit) == 0)
+    return;
+
+  pos_completer_refiner_reset (self->refiner);
+  g_string_truncate (self->preedit, 0);
+  if (preedit)
+    g_string_append (self->preedit, preedit);
+  else {
+    pos_completer_wordlist_take_completions (POS_COMPLETER (self), NULL);
+  }
+
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_PREEDIT]);
+}
+
+
+static void
+pos_completer_wordlist_set_property (GObject      *object,
+                                     guint         property_id,
+                                     const GValue *value,
+                                     GParamSpec   *pspec)
+{
+  PosCompleterWordlist *self = POS_COMPLETER_WORDLIST (object);
+
+  switch (property_id) {
+  case PROP_PREEDIT:
+    pos_completer_wordlist_set_preedit (POS_COMPLETER (self), g_value_get_string (value));
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    break;
+  }
+}
+
+
+static void
+pos_completer_wordlist_get_property (GObject    *object,
+                                     guint       property_id,
+                                     GValue     *value,
+                                     GParamSpec *pspec)
+{
+  PosCompleterWordlist *self = POS_COMPLETER_WORDLIST (object);
+
+  switch (property_id) {
+  case PROP_NAME:
+    g_value_set_string (value, self->name);
+    break;
+  case PROP_PREEDIT:
+    g_value_set_string (value, self->preedit->str);
+    break;
+  case PROP_BEFORE_TEXT:
+    g_value_set_string (value, "");
+    break;
+  case PROP_AFTER_TEXT:
+    g_value_set_string (value, "");
+    break;
+  case PROP_COMPLETIONS:
+    g_value_set_boxed (value, self->completions);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    break;
+  }
+}
+
+
+static void
+pos_completer_wordlist_finalize (GObject *object)
+{
+  PosCompleterWordlist *self = POS_COMPLETER_WORDLIST(object);
+
+  g_cancellable_cancel (self->load_cancel);
+  g_clear_object (&self->load_cancel);
+  g_clear_pointer (&self->index, pos_word_index_free);
+  g_clear_pointer (&self->refiner, pos_completer_refiner_free);
+  g_clear_pointer (&self->lang, g_free);
+  g_clear_pointer (&self->completions, g_strfreev);
+  g_string_free (self->preedit, TRUE);
+
+  G_OBJECT_CLASS (pos_completer_wordlist_parent_class)->finalize (object);
+}
+
+
+static void
+pos_completer_wordlist_class_init (PosCompleterWordlistClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->get_property = pos_completer_wordlist_get_property;
+  object_class->set_property = pos_completer_wordlist_set_property;
+  object_class->finalize = pos_completer_wordlist_finalize;
+
+  g_object_class_override_property (object_class, PROP_NAME, "name");
+  props[PROP_NAME] = g_object_class_find_property (object_class, "name");
+
+  g_object_class_override_property (object_class, PROP_PREEDIT, "preedit");
+  props[PROP_PREEDIT] = g_object_class_find_property (object_class, "preedit");
+
+  g_object_class_override_property (object_class, PROP_BEFORE_TEXT, "before-text");
+  props[PROP_BEFORE_TEXT] = g_object_class_find_property (object_class, "before-text");
+
+  g_object_class_override_property (object_class, PROP_AFTER_TEXT, "after-text");
+  props[PROP_AFTER_TEXT] = g_object_class_find_property (object_class, "after-text");
+
+  g_object_class_override_property (object_class, PROP_COMPLETIONS, "completions");
+  props[PROP_COMPLETIONS] = g_object_class_find_property (object_class, "completions");
+}
+
+
+static char *
+find_source (const char *lang, const char *region)
+{
+  g_auto (GStrv) paths = g_strsplit (POS_HUNSPELL_DICT_PATH, ":", -1);
+  g_autofree char *upcase_region = g_ascii_strup (region ?: lang, -1);
+  g_autofree char *locale = g_strdup_printf ("%s_%s", lang, upcase_region);
+
+  for (int i = 0; paths[i] != NULL; i++) {
+    g_autofree char *dict = g_strdup_printf ("%s/%s.dic", paths[i], locale);
+
+    if (g_file_test (dict, G_FILE_TEST_EXISTS))
+      return g_steal_pointer (&dict);
+  }
+
+  /* The system word list is usually English */
+  if (g_strcmp0 (lang, POS_COMPLETER_DEFAULT_LANG) == 0 &&
+      g_file_test (WORD_LIST, G_FILE_TEST_EXISTS)) {
+    return g_strdup (WORD_LIST);
+  }
+
+  return NULL;
+}
+
+
+static void
+set_loading (PosCompleterWordlist *self, gboolean loading)
+{
+  if (self->loading == loading)
+    return;
+
+  self->loading = loading;
+  g_signal_emit_by_name (self, "loading-changed");
+}
+
+
+static void
+build_index_thread (GTask        *task,
+                    gpointer      source_object,
+                    gpointer      task_data,
+                    GCancellable *cancellable)
+{
+  const char *source = task_data;
+  PosWordIndex *index;
+  GError *err = NULL;
+
+  g_debug ("Using word list '%s'", source);
+  index = pos_word_index_new_for_source (source, NULL, &err);
+  if (index == NULL) {
+    g_task_return_error (task, err);
+    return;
+  }
+
+  g_task_return_pointer (task, index, (GDestroyNotify)pos_word_index_free);
+}
+
+
+static void pos_completer_wordlist_lookup_preedit (PosCompleterWordlist *self);
+
+static void
+on_index_built (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  PosCompleterWordlist *self = POS_COMPLETER_WORDLIST (source);
+  g_autoptr (GError) err = NULL;
+  PosWordIndex *index;
+
+  index = g_task_propagate_pointer (G_TASK (res), &err);
+  if (index == NULL) {
+    /* Superseded by another language */
+    if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      return;
+
+    g_warning ("Failed to build word index for '%s': %s", self->lang, err->message);
+    set_loading (self, FALSE);
+    return;
+  }
+
+  g_clear_object (&self->load_cancel);
+  self->index = index;
+  set_loading (self, FALSE);
+
+  if (self->preedit->len)
+    pos_completer_wordlist_lookup_preedit (self);
+}
+
+
+static gboolean
+pos_completer_wordlist_set_language (PosCompleter *completer,
+                                     const char   *lang,
+                                     const char   *region,
+                                     GError      **error)
+{
+  PosCompleterWordlist *self = POS_COMPLETER_WORDLIST (completer);
+  g_autofree char *lang_region = g_strdup_printf ("%s-%s", lang, region ?: "");
+  g_autofree char *source = NULL;
+  g_autoptr (GTask) task = NULL;
+
+  if (g_strcmp0 (self->lang, lang_region) == 0)
+    return TRUE;
+
+  source = find_source (lang, region);
+  if (source == NULL) {
+    g_set_error (error,
+                 POS_COMPLETER_ERROR,
+                 POS_COMPLETER_ERROR_LANG_INIT,
+                 "Failed to find word list for %s", lang_region);
+    return FALSE;
+  }
+
+  g_cancellable_cancel (self->load_cancel);
+  g_clear_object (&self->load_cancel);
+  g_clear_pointer (&self->index, pos_word_index_free);
+  pos_completer_refiner_reset (self->refiner);
+  g_free (self->lang);
+  self->lang = g_steal_pointer (&lang_region);
+  set_loading (self, TRUE);
+
+  self->load_cancel = g_cancellable_new ();
+  task = g_task_new (self, self->load_cancel, on_index_built, NULL);
+  g_task_set_source_tag (task, pos_completer_wordlist_set_language);
+  g_task_set_name (task, "pos-wordlist-build-index");
+  g_task_set_task_data (task, g_steal_pointer (&source), g_free);
+  g_task_run_in_thread (task, build_index_thread);
+
+  return TRUE;
+}
+
+
+static gboolean
+pos_completer_wordlist_initable_init (GInitable    *initable,
+                                      GCancellable *cancelable,
+                                      GError      **error)
+{
+  PosCompleterWordlist *self = POS_COMPLETER_WORDLIST (initable);
+
+  return pos_completer_wordlist_set_language (POS_COMPLETER (self),
+                                              POS_COMPLETER_DEFAULT_LANG,
+                                              POS_COMPLETER_DEFAULT_REGION,
+                                              error);
+}
+
+
+static void
+pos_completer_wordlist_initable_interface_init (GInitableIface *iface)
+{
+  iface->init = pos_completer_wordlist_initable_init;
+}
+
+static const char *
+pos_completer_wordlist_get_name (PosCompleter *iface)
+{
+  PosCompleterWordlist *self = POS_COMPLETER_WORDLIST (iface);
+
+  return self->name;
+}
+
+static int
+prefix_match (const char *query, const char *candidate, gpointer user_data)
+{
+  const char *lower = user_data;
+
+  /* Keep the index' frequency order */
+  return g_str_has_prefix (candidate, lower) ? 0 : -1;
+}
+
+
+static void
+pos_completer_wordlist_lookup_preedit (PosCompleterWordlist *self)
+{
+  g_autofree char *lower = NULL;
+  g_auto (GStrv) candidates = NULL;
+  g_auto (GStrv) completions = NULL;
+
+  /* Looked up once the index is built */
+  if (self->index == NULL)
+    return;
+
+  if (pos_completer_lookup_cached (POS_COMPLETER (self), self->preedit->str, &completions)) {
+    pos_completer_wordlist_take_completions (POS_COMPLETER (self), g_steal_pointer (&completions));
+    return;
+  }
+
+  lower = g_utf8_strdown (self->preedit->str, -1);
+  if (!pos_completer_refiner_refine (self->refiner, self->preedit->str, prefix_match, lower)) {
+    GStrv matches;
+    gboolean complete;
+
+    g_debug ("Looking up string '%s'", self->preedit->str);
+    matches = pos_word_index_lookup_full (self->index,
+                                          self->preedit->str,
+                                          MAX_CANDIDATES,
+                                          &complete);
+    pos_completer_refiner_set_candidates (self->refiner, self->preedit->str, matches, complete);
+  }
+
+  candidates = pos_completer_refiner_get_completions (self->refiner, self->max_completions);
+  completions = pos_completer_capitalize_by_template (self->preedit->str, candidates);
+  pos_completer_cache_completions (POS_COMPLETER (self), self->preedit->str, completions);
+  pos_completer_wordlist_take_completions (POS_COMPLETER (self), g_steal_pointer (&completions));
+}
+
+
+static gboolean
+pos_completer_wordlist_feed_symbol (PosCompleter *iface, const char *symbol)
+{
+  PosCompleterWordlist *self = POS_COMPLETER_WORDLIST (iface);
+  g_autofree char *preedit = g_strdup (self->preedit->str);
+
+  if (pos_completer_add_preedit (POS_COMPLETER (self), self->preedit, symbol)) {
+    g_signal_emit_by_name (self, "commit-string", self->preedit->str);
+    pos_completer_wordlist_set_preedit (POS_COMPLETER (self), NULL);
+
+    /* Make sure enter is processed as raw keystroke */
+    if (g_strcmp0 (symbol, "KEY_ENTER") == 0)
+      return FALSE;
+
+    return TRUE;
+  }
+
+  /* preedit didn't change and wasn't committed so we didn't handle it */
+  if (g_strcmp0 (self->preedit->str, preedit) == 0)
+    return FALSE;
+
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_PREEDIT]);
+
+  pos_completer_wordlist_lookup_preedit (self);
+  return TRUE;
+}
+
+
+static gboolean
+pos_completer_wordlist_is_loading (PosCompleter *iface)
+{
+  PosCompleterWordlist *self = POS_COMPLETER_WORDLIST (iface);
+
+  return self->loading;
+}
+
+
+static void
+pos_completer_wordlist_interface_init (PosCompleterInterface *iface)
+{
+  iface->get_name = pos_completer_wordlist_get_name;
+  iface->feed_symbol = pos_completer_wordlist_feed_symbol;
+  iface->get_preedit = pos_completer_wordlist_get_preedit;
+  iface->set_preedit = pos_completer_wordlist_set_preedit;
+  iface->set_language = pos_completer_wordlist_set_language;
+  iface->is_loading = pos_completer_wordlist_is_loading;
+}
+
+
+static void
+pos_completer_wordlist_init (PosCompleterWordlist *self)
+{
+  self->max_completions = MAX_COMPLETIONS;
+  self->preedit = g_string_new (NULL);
+  self->refiner = pos_completer_refiner_new ();
+  self->name = "wordlist";
+}
+
+/**
+ * pos_completer_wordlist_new:
+ * err: An error location
+ *
+ * Returns:(transfer full): A new completer
+ */
+PosCompleter *
+pos_completer_wordlist_new (GError **err)
+{
+  return POS_COMPLETER (g_initable_new (POS_TYPE_COMPLETER_WORDLIST, NULL, err, NULL));
+}
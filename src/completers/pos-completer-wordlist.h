@@ -0,0 +1,21 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "pos-completer.h"
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define POS_TYPE_COMPLETER_WORDLIST (pos_completer_wordlist_get_type ())
+
+G_DECLARE_FINAL_TYPE (PosCompleterWordlist, pos_completer_wordlist, POS, COMPLETER_WORDLIST, GObject)
+
+PosCompleter *pos_completer_wordlist_new (GError **error);
+
+G_END_DECLS
@@ -0,0 +1,595 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "pos-fuzzy-matcher"
+
+#include "pos-config.h"
+
+#include "pos-fuzzy-matcher.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Scoring modeled after fzf's v1 algorithm */
+#define SCORE_MATCH                  16
+#define SCORE_GAP_START              -3
+#define SCORE_GAP_EXTENSION          -1
+#define BONUS_BOUNDARY               (SCORE_MATCH / 2)
+#define BONUS_CONSECUTIVE            (-(SCORE_GAP_START + SCORE_GAP_EXTENSION))
+#define BONUS_FIRST_CHAR_MULTIPLIER  2
+
+#define MAX_WORD_CHARS               128
+#define FILTER_BLOCK_SIZE            1024
+
+/**
+ * PosFuzzyMatcher:
+ *
+ * An in process fuzzy matcher for word lists.
+ *
+ * The word list is mapped into memory once and indexed by line. Each
+ * word gets a bitmask of the characters it contains so that most words
+ * can be rejected by a cheap, vectorizable filter pass before the more
+ * expensive subsequence scoring runs. The best matches are kept in a
+ * bounded heap.
+ */
+struct _PosFuzzyMatcher {
+  GBytes     *words;
+  const char *data;
+
+  guint       n_words;
+  guint32    *offsets;
+  guint16    *lengths;
+  guint16    *n_chars;
+  guint64    *masks;
+};
+
+typedef struct {
+  gunichar    chars[MAX_WORD_CHARS];
+  guint       len;
+  guint64     mask;
+  gboolean    case_sensitive;
+} PosFuzzyPattern;
+
+typedef struct {
+  int         score;
+  guint       idx;
+  guint       len;
+} PosFuzzyMatch;
+
+
+static inline gunichar
+next_char (const char **p)
+{
+  const guchar *s = (const guchar *)*p;
+  gunichar c;
+
+  if (*s < 0x80) {
+    *p += 1;
+    return *s;
+  }
+
+  c = g_utf8_get_char (*p);
+  *p = g_utf8_next_char (*p);
+  return c;
+}
+
+
+static inline gunichar
+fold_char (gunichar c)
+{
+  if (c < 0x80)
+    return g_ascii_tolower (c);
+
+  return g_unichar_tolower (c);
+}
+
+
+static inline gboolean
+is_alnum (gunichar c)
+{
+  if (c < 0x80)
+    return g_ascii_isalnum (c);
+
+  return g_unichar_isalnum (c);
+}
+
+/* One bit per ASCII letter and digit, everything else shares buckets */
+static inline guint64
+char_mask (gunichar c)
+{
+  if (c >= 'a' && c <= 'z')
+    return G_GUINT64_CONSTANT (1) << (c - 'a');
+  if (c >= '0' && c <= '9')
+    return G_GUINT64_CONSTANT (1) << (26 + c - '0');
+  if (c < 0x80)
+    return G_GUINT64_CONSTANT (1) << (36 + c % 12);
+
+  return G_GUINT64_CONSTANT (1) << (48 + c % 16);
+}
+
+
+static guint
+decode_word (const char *word, gsize len, gboolean fold, gunichar *chars)
+{
+  const char *end = word + len;
+  guint n = 0;
+
+  while (word < end && n < MAX_WORD_CHARS) {
+    gunichar c = next_char (&word);
+
+    chars[n++] = fold ? fold_char (c) : c;
+  }
+
+  return n;
+}
+
+
+static gboolean
+parse_pattern (const char *pattern, PosFuzzyPattern *pat)
+{
+  const char *p = pattern;
+
+  if (pattern == NULL || !g_utf8_validate (pattern, -1, NULL))
+    return FALSE;
+
+  pat->len = 0;
+  pat->mask = 0;
+  pat->case_sensitive = FALSE;
+
+  while (*p) {
+    gunichar c;
+
+    if (pat->len == MAX_WORD_CHARS)
+      return FALSE;
+
+    c = next_char (&p);
+    /* smart case like fzf: any upper case char makes the match case sensitive */
+    if (g_unichar_isupper (c))
+      pat->case_sensitive = TRUE;
+
+    pat->chars[pat->len++] = c;
+    pat->mask |= char_mask (fold_char (c));
+  }
+
+  if (!pat->case_sensitive) {
+    for (guint i = 0; i < pat->len; i++)
+      pat->chars[i] = fold_char (pat->chars[i]);
+  }
+
+  return pat->len > 0;
+}
+
+
+static int
+score_chars (const PosFuzzyPattern *pat, const gunichar *text, guint n)
+{
+  int sidx = -1, eidx = -1;
+  int pidx = 0;
+  int m = pat->len;
+  int score = 0, consecutive = 0, first_bonus = 0;
+  gboolean in_gap = FALSE;
+
+  /* Forward scan: find the end of the first complete match */
+  for (guint i = 0; i < n; i++) {
+    if (text[i] != pat->chars[pidx])
+      continue;
+
+    if (sidx < 0)
+      sidx = i;
+    if (++pidx == m) {
+      eidx = i + 1;
+      break;
+    }
+  }
+  if (eidx < 0)
+    return -1;
+
+  /* Backward scan: shrink to the shortest window ending there */
+  pidx = m - 1;
+  for (int i = eidx - 1; i >= sidx; i--) {
+    if (text[i] != pat->chars[pidx])
+      continue;
+
+    if (pidx == 0) {
+      sidx = i;
+      break;
+    }
+    pidx--;
+  }
+
+  pidx = 0;
+  for (int i = sidx; i < eidx; i++) {
+    if (pidx < m && text[i] == pat->chars[pidx]) {
+      int bonus = (i == 0 || !is_alnum (text[i - 1])) ? BONUS_BOUNDARY : 0;
+
+      score += SCORE_MATCH;
+      if (consecutive == 0) {
+        first_bonus = bonus;
+      } else {
+        if (bonus >= BONUS_BOUNDARY && bonus > first_bonus)
+          first_bonus = bonus;
+        bonus = MAX (MAX (bonus, first_bonus), BONUS_CONSECUTIVE);
+      }
+      score += pidx == 0 ? bonus * BONUS_FIRST_CHAR_MULTIPLIER : bonus;
+
+      in_gap = FALSE;
+      consecutive++;
+      pidx++;
+    } else {
+      score += in_gap ? SCORE_GAP_EXTENSION : SCORE_GAP_START;
+      in_gap = TRUE;
+      consecutive = 0;
+      first_bonus = 0;
+    }
+  }
+
+  return score;
+}
+
+
+static int
+score_word (const PosFuzzyPattern *pat, const char *word, gsize len)
+{
+  gunichar text[MAX_WORD_CHARS];
+  guint n;
+
+  n = decode_word (word, len, !pat->case_sensitive, text);
+  if (n < pat->len)
+    return -1;
+
+  return score_chars (pat, text, n);
+}
+
+/* Better matches have a higher score, then fzf's default tiebreak: shorter words first */
+static inline gboolean
+match_is_better (const PosFuzzyMatch *a, const PosFuzzyMatch *b)
+{
+  if (a->score != b->score)
+    return a->score > b->score;
+  if (a->len != b->len)
+    return a->len < b->len;
+  return a->idx < b->idx;
+}
+
+
+static int
+match_compare (const void *a, const void *b)
+{
+  return match_is_better (a, b) ? -1 : 1;
+}
+
+/**
+ * pos_fuzzy_matcher_compare_candidates:
+ * @a: A scored candidate
+ * @b: Another scored candidate
+ *
+ * Orders candidates like [method@FuzzyMatcher.match] does. The
+ * candidates' ranks must be the indices returned by
+ * [method@FuzzyMatcher.match_full]. Use this as the compare function
+ * of a [struct@CompleterRefiner] so refined and full matches are
+ * ordered the same.
+ *
+ * Returns: A negative value if @a is the better match, a positive value otherwise
+ */
+int
+pos_fuzzy_matcher_compare_candidates (const PosCompleterScoredCandidate *a,
+                                      const PosCompleterScoredCandidate *b)
+{
+  PosFuzzyMatch ma = { .score = a->score, .idx = a->rank, .len = g_utf8_strlen (a->candidate, -1) };
+  PosFuzzyMatch mb = { .score = b->score, .idx = b->rank, .len = g_utf8_strlen (b->candidate, -1) };
+
+  if (a->rank == b->rank)
+    return 0;
+
+  return match_compare (&ma, &mb);
+}
+
+/* Min heap with the worst match at the root */
+static void
+heap_sift_up (PosFuzzyMatch *heap, guint i)
+{
+  while (i > 0) {
+    guint parent = (i - 1) / 2;
+    PosFuzzyMatch tmp;
+
+    if (!match_is_better (&heap[parent], &heap[i]))
+      break;
+
+    tmp = heap[parent];
+    heap[parent] = heap[i];
+    heap[i] = tmp;
+    i = parent;
+  }
+}
+
+
+static void
+heap_sift_down (PosFuzzyMatch *heap, guint n, guint i)
+{
+  for (;;) {
+    guint worst = i, l = 2 * i + 1, r = 2 * i + 2;
+    PosFuzzyMatch tmp;
+
+    if (l < n && match_is_better (&heap[worst], &heap[l]))
+      worst = l;
+    if (r < n && match_is_better (&heap[worst], &heap[r]))
+      worst = r;
+    if (worst == i)
+      return;
+
+    tmp = heap[worst];
+    heap[worst] = heap[i];
+    heap[i] = tmp;
+    i = worst;
+  }
+}
+
+
+static void
+heap_push (PosFuzzyMatch *heap, guint *n, guint max, const PosFuzzyMatch *match)
+{
+  if (*n < max) {
+    heap[*n] = *match;
+    heap_sift_up (heap, *n);
+    (*n)++;
+  } else if (match_is_better (match, &heap[0])) {
+    heap[0] = *match;
+    heap_sift_down (heap, *n, 0);
+  }
+}
+
+/**
+ * pos_fuzzy_matcher_new_from_bytes:
+ * @words: The word list, one word per line
+ *
+ * Creates a new matcher for the given word list. The matcher keeps
+ * a reference to @words and does not copy the words.
+ *
+ * Returns:(transfer full): A new matcher
+ */
+PosFuzzyMatcher *
+pos_fuzzy_matcher_new_from_bytes (GBytes *words)
+{
+  PosFuzzyMatcher *self;
+  g_autoptr (GArray) offsets = g_array_new (FALSE, FALSE, sizeof (guint32));
+  g_autoptr (GArray) lengths = g_array_new (FALSE, FALSE, sizeof (guint16));
+  g_autoptr (GArray) n_chars = g_array_new (FALSE, FALSE, sizeof (guint16));
+  g_autoptr (GArray) masks = g_array_new (FALSE, FALSE, sizeof (guint64));
+  const char *line, *end;
+  gsize len;
+
+  g_return_val_if_fail (words, NULL);
+
+  self = g_new0 (PosFuzzyMatcher, 1);
+  self->words = g_bytes_ref (words);
+  self->data = g_bytes_get_data (words, &len);
+  /* Offsets are 32 bit */
+  len = MIN (len, G_MAXUINT32);
+
+  line = self->data;
+  end = line ? line + len : NULL;
+  while (line < end) {
+    const char *nl = memchr (line, '\n', end - line);
+    const char *word = line;
+    gsize word_len = (nl ? nl : end) - line;
+    guint32 offset = line - self->data;
+    guint64 mask = 0;
+    guint16 n = 0, byte_len;
+
+    line = nl ? nl + 1 : end;
+
+    if (word_len && word[word_len - 1] == '\r')
+      word_len--;
+    if (word_len == 0 || word_len > G_MAXUINT16 || !g_utf8_validate_len (word, word_len, NULL))
+      continue;
+
+    for (const char *p = word; p < word + word_len; n++)
+      mask |= char_mask (fold_char (next_char (&p)));
+    if (n > MAX_WORD_CHARS)
+      continue;
+
+    byte_len = word_len;
+    g_array_append_val (offsets, offset);
+    g_array_append_val (lengths, byte_len);
+    g_array_append_val (n_chars, n);
+    g_array_append_val (masks, mask);
+  }
+
+  self->n_words = offsets->len;
+  self->offsets = (guint32 *)g_array_free (g_steal_pointer (&offsets), FALSE);
+  self->lengths = (guint16 *)g_array_free (g_steal_pointer (&lengths), FALSE);
+  self->n_chars = (guint16 *)g_array_free (g_steal_pointer (&n_chars), FALSE);
+  self->masks = (guint64 *)g_array_free (g_steal_pointer (&masks), FALSE);
+
+  g_debug ("Indexed %u words", self->n_words);
+  return self;
+}
+
+/**
+ * pos_fuzzy_matcher_new:
+ * @path: Path to the word list
+ * @error: The error location
+ *
+ * Creates a new matcher by mapping the word list at @path into memory.
+ *
+ * Returns:(transfer full)(nullable): A new matcher or %NULL on error
+ */
+PosFuzzyMatcher *
+pos_fuzzy_matcher_new (const char *path, GError **error)
+{
+  g_autoptr (GMappedFile) file = NULL;
+  g_autoptr (GBytes) bytes = NULL;
+
+  g_return_val_if_fail (path, NULL);
+
+  file = g_mapped_file_new (path, FALSE, error);
+  if (file == NULL)
+    return NULL;
+
+  bytes = g_mapped_file_get_bytes (file);
+  return pos_fuzzy_matcher_new_from_bytes (bytes);
+}
+
+
+void
+pos_fuzzy_matcher_free (PosFuzzyMatcher *self)
+{
+  g_return_if_fail (self);
+
+  g_free (self->offsets);
+  g_free (self->lengths);
+  g_free (self->n_chars);
+  g_free (self->masks);
+  g_bytes_unref (self->words);
+  g_free (self);
+}
+
+
+guint
+pos_fuzzy_matcher_get_n_words (PosFuzzyMatcher *self)
+{
+  g_return_val_if_fail (self, 0);
+
+  return self->n_words;
+}
+
+/**
+ * pos_fuzzy_matcher_match:
+ * @self: The matcher
+ * @pattern: The pattern to match
+ * @max_matches: The maximum number of matches to return
+ *
+ * Matches @pattern as a subsequence against the word list and returns
+ * the best scoring words. Like fzf the match is case insensitive
+ * unless @pattern contains upper case characters.
+ *
+ * Returns:(transfer full)(nullable): The best matches, best first
+ */
+GStrv
+pos_fuzzy_matcher_match (PosFuzzyMatcher *self, const char *pattern, guint max_matches)
+{
+  return pos_fuzzy_matcher_match_full (self, pattern, max_matches, NULL, NULL);
+}
+
+/**
+ * pos_fuzzy_matcher_match_full:
+ * @self: The matcher
+ * @pattern: The pattern to match
+ * @max_matches: The maximum number of matches to return
+ * @indices:(out)(optional)(transfer full): The word list indices of the matches
+ * @n_total:(out)(optional): The number of all matching words
+ *
+ * Like [method@FuzzyMatcher.match] but also returns the total number of
+ * matches so callers can tell whether the result is complete and the
+ * matches' indices in the word list which break ties between
+ * otherwise equal matches.
+ *
+ * Returns:(transfer full)(nullable): The best matches, best first
+ */
+GStrv
+pos_fuzzy_matcher_match_full (PosFuzzyMatcher *self,
+                              const char      *pattern,
+                              guint            max_matches,
+                              guint          **indices,
+                              guint           *n_total)
+{
+  PosFuzzyPattern pat;
+  g_autofree PosFuzzyMatch *heap = NULL;
+  GStrv matches;
+  guint n_matches = 0;
+  guint total = 0;
+
+  g_return_val_if_fail (self, NULL);
+
+  if (n_total)
+    *n_total = 0;
+  if (indices)
+    *indices = NULL;
+
+  if (max_matches == 0 || !parse_pattern (pattern, &pat))
+    return NULL;
+
+  heap = g_new0 (PosFuzzyMatch, max_matches);
+
+  for (guint block = 0; block < self->n_words; block += FILTER_BLOCK_SIZE) {
+    guint8 candidates[FILTER_BLOCK_SIZE];
+    guint n = MIN (FILTER_BLOCK_SIZE, self->n_words - block);
+    const guint64 *masks = &self->masks[block];
+    const guint16 *n_chars = &self->n_chars[block];
+
+    /* Branch free so the compiler can vectorize the prefilter */
+    for (guint i = 0; i < n; i++)
+      candidates[i] = ((masks[i] & pat.mask) == pat.mask) & (n_chars[i] >= pat.len);
+
+    for (guint i = 0; i < n; i++) {
+      PosFuzzyMatch match;
+      guint idx = block + i;
+
+      if (!candidates[i])
+        continue;
+
+      match.score = score_word (&pat, self->data + self->offsets[idx], self->lengths[idx]);
+      if (match.score < 0)
+        continue;
+
+      total++;
+      match.idx = idx;
+      match.len = self->n_chars[idx];
+      heap_push (heap, &n_matches, max_matches, &match);
+    }
+  }
+
+  if (n_total)
+    *n_total = total;
+
+  if (n_matches == 0)
+    return NULL;
+
+  qsort (heap, n_matches, sizeof (PosFuzzyMatch), match_compare);
+
+  matches = g_new0 (char *, n_matches + 1);
+  if (indices)
+    *indices = g_new (guint, n_matches);
+  for (guint i = 0; i < n_matches; i++) {
+    guint idx = heap[i].idx;
+
+    matches[i] = g_strndup (self->data + self->offsets[idx], self->lengths[idx]);
+    if (indices)
+      (*indices)[i] = idx;
+  }
+
+  return matches;
+}
+
+/**
+ * pos_fuzzy_matcher_score:
+ * @pattern: The pattern
+ * @word: The word to match the pattern against
+ * @word_len: The length of @word in bytes or -1 if nul terminated
+ *
+ * Scores a single word against @pattern the same way
+ * [method@FuzzyMatcher.match] does.
+ *
+ * Returns: The score or -1 if @word doesn't match
+ */
+int
+pos_fuzzy_matcher_score (const char *pattern, const char *word, gssize word_len)
+{
+  PosFuzzyPattern pat;
+
+  g_return_val_if_fail (word, -1);
+
+  if (!parse_pattern (pattern, &pat))
+    return -1;
+
+  if (word_len < 0)
+    word_len = strlen (word);
+
+  if (!g_utf8_validate_len (word, word_len, NULL))
+    return -1;
+
+  return score_word (&pat, word, word_len);
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "pos-completer-priv.h"
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _PosFuzzyMatcher PosFuzzyMatcher;
+
+PosFuzzyMatcher *pos_fuzzy_matcher_new            (const char      *path,
+                                                   GError         **error);
+PosFuzzyMatcher *pos_fuzzy_matcher_new_from_bytes (GBytes          *words);
+void             pos_fuzzy_matcher_free           (PosFuzzyMatcher *self);
+guint            pos_fuzzy_matcher_get_n_words    (PosFuzzyMatcher *self);
+GStrv            pos_fuzzy_matcher_match          (PosFuzzyMatcher *self,
+                                                   const char      *pattern,
+                                                   guint            max_matches);
+GStrv            pos_fuzzy_matcher_match_full     (PosFuzzyMatcher *self,
+                                                   const char      *pattern,
+                                                   guint            max_matches,
+                                                   guint          **indices,
+                                                   guint           *n_total);
+int              pos_fuzzy_matcher_score          (const char      *pattern,
+                                                   const char      *word,
+                                                   gssize           word_len);
+int              pos_fuzzy_matcher_compare_candidates (const PosCompleterScoredCandidate *a,
+                                                       const PosCompleterScoredCandidate *b);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PosFuzzyMatcher, pos_fuzzy_matcher_free)
+
+G_END_DECLS
@@ -0,0 +1,658 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "pos-word-index"
+
+#include "pos-config.h"
+
+#include "pos-word-index.h"
+
+#include <glib/gstdio.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INDEX_MAGIC       "POSWIDX"
+#define INDEX_VERSION     1
+#define INDEX_BYTE_ORDER  0x01020304
+#define MAX_WORD_LEN      255
+#define NO_NODE           G_MAXUINT32
+
+/**
+ * PosWordIndex:
+ *
+ * A prefix index over a word list.
+ *
+ * The index is a trie stored as a flat array of nodes in breadth first
+ * order so the children of a node are contiguous and sorted by byte.
+ * Each node stores the frequency of the word ending there (0 if none)
+ * and the maximum frequency in its subtree which allows to find the
+ * most frequent completions for a prefix without visiting the whole
+ * subtree.
+ *
+ * The index is built once from a word list (one word per line with
+ * an optional count) or a hunspell `.dic` file, written to the cache
+ * directory and mapped into memory on later use.
+ */
+
+typedef struct {
+  char     magic[8];
+  guint32  version;
+  guint32  byte_order;
+  guint32  n_nodes;
+  guint32  reserved;
+  guint64  source_mtime;
+  guint64  source_size;
+} PosWordIndexHeader;
+
+typedef struct {
+  guint32  first_child;
+  guint32  freq;
+  guint32  max_freq;
+  guint16  n_children;
+  guint8   byte;
+  guint8   reserved;
+} PosWordIndexNode;
+
+G_STATIC_ASSERT (sizeof (PosWordIndexHeader) == 40);
+G_STATIC_ASSERT (sizeof (PosWordIndexNode) == 16);
+
+struct _PosWordIndex {
+  GMappedFile              *file;
+  const PosWordIndexHeader *header;
+  const PosWordIndexNode   *nodes;
+};
+
+typedef struct {
+  guint    lo;
+  guint    hi;
+  guint    depth;
+  guint32  node;
+} PosWordIndexRange;
+
+typedef struct {
+  guint32  score;
+  guint32  node;
+  gboolean is_word;
+  char    *path;
+} PosWordIndexCandidate;
+
+
+static void
+add_word (GHashTable *words, const char *word, gsize len, guint64 freq)
+{
+  g_autofree char *lower = NULL;
+  guint64 old;
+
+  if (len == 0 || len > MAX_WORD_LEN || !g_utf8_validate_len (word, len, NULL))
+    return;
+
+  lower = g_utf8_strdown (word, len);
+  old = GPOINTER_TO_UINT (g_hash_table_lookup (words, lower));
+  freq = MIN (old + freq, G_MAXUINT32);
+  g_hash_table_replace (words, g_steal_pointer (&lower), GUINT_TO_POINTER ((guint32)freq));
+}
+
+
+static GHashTable *
+parse_source (const char *source, GError **error)
+{
+  g_autoptr (GMappedFile) file = NULL;
+  g_autoptr (GHashTable) words = NULL;
+  gboolean is_dic = g_str_has_suffix (source, ".dic");
+  gboolean first = TRUE;
+  const char *line, *end;
+
+  file = g_mapped_file_new (source, FALSE, error);
+  if (file == NULL)
+    return NULL;
+
+  words = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  line = g_mapped_file_get_contents (file);
+  end = line ? line + g_mapped_file_get_length (file) : NULL;
+  while (line < end) {
+    const char *nl = memchr (line, '\n', end - line);
+    const char *eol = nl ? nl : end;
+    const char *word = line;
+    const char *p = line;
+    guint64 freq = 1;
+
+    line = nl ? nl + 1 : end;
+
+    if (eol > word && eol[-1] == '\r')
+      eol--;
+    if (eol == word || *word == '#')
+      continue;
+
+    /* hunspell dictionaries start with the number of entries */
+    if (is_dic && first) {
+      first = FALSE;
+      if (g_ascii_isdigit (*word))
+        continue;
+    }
+
+    /* hunspell: word/FLAGS [morphology], word lists: word [count] */
+    while (p < eol && *p != ' ' && *p != '\t' && !(is_dic && *p == '/'))
+      p++;
+
+    if (!is_dic && p < eol) {
+      g_autofree char *count = g_strndup (p + 1, eol - p - 1);
+      guint64 val;
+
+      if (g_ascii_string_to_unsigned (g_strstrip (count), 10, 1, G_MAXUINT32, &val, NULL))
+        freq = val;
+    }
+
+    add_word (words, word, p - word, freq);
+  }
+
+  return g_steal_pointer (&words);
+}
+
+
+static int
+compare_words (const void *a, const void *b)
+{
+  return strcmp (*(const char * const *)a, *(const char * const *)b);
+}
+
+
+static gboolean
+build_index (const char *source, GStatBuf *st, const char *index_path, GError **error)
+{
+  g_autoptr (GHashTable) words = NULL;
+  g_autoptr (GArray) nodes = g_array_new (FALSE, TRUE, sizeof (PosWordIndexNode));
+  g_autoptr (GArray) queue = g_array_new (FALSE, FALSE, sizeof (PosWordIndexRange));
+  g_autofree const char **keys = NULL;
+  g_autofree char *buf = NULL;
+  PosWordIndexHeader header = { INDEX_MAGIC };
+  PosWordIndexNode root = { 0 };
+  PosWordIndexRange range;
+  gsize len;
+  guint n_words, i;
+
+  words = parse_source (source, error);
+  if (words == NULL)
+    return FALSE;
+
+  keys = (const char **)g_hash_table_get_keys_as_array (words, &n_words);
+  qsort (keys, n_words, sizeof (char *), compare_words);
+
+  g_array_append_val (nodes, root);
+  range = (PosWordIndexRange) { .lo = 0, .hi = n_words, .depth = 0, .node = 0 };
+  g_array_append_val (queue, range);
+
+  /* Breadth first so children are contiguous and always come after their parent */
+  for (guint q = 0; q < queue->len; q++) {
+    PosWordIndexRange r = g_array_index (queue, PosWordIndexRange, q);
+    PosWordIndexNode *node;
+    guint32 first_child = nodes->len;
+    guint16 n_children = 0;
+    guint32 freq = 0;
+
+    i = r.lo;
+    /* Sorting puts the word ending at this node first */
+    if (i < r.hi && keys[i][r.depth] == '\0') {
+      freq = GPOINTER_TO_UINT (g_hash_table_lookup (words, keys[i]));
+      i++;
+    }
+
+    while (i < r.hi) {
+      PosWordIndexNode child = { 0 };
+      guint8 byte = keys[i][r.depth];
+      guint j = i + 1;
+
+      while (j < r.hi && (guint8)keys[j][r.depth] == byte)
+        j++;
+
+      child.byte = byte;
+      g_array_append_val (nodes, child);
+      range = (PosWordIndexRange) { .lo = i, .hi = j, .depth = r.depth + 1, .node = nodes->len - 1 };
+      g_array_append_val (queue, range);
+
+      n_children++;
+      i = j;
+    }
+
+    node = &g_array_index (nodes, PosWordIndexNode, r.node);
+    node->freq = freq;
+    node->first_child = n_children ? first_child : 0;
+    node->n_children = n_children;
+  }
+
+  /* Children have higher indices so walking backwards sees them first */
+  i = nodes->len;
+  while (i-- > 0) {
+    PosWordIndexNode *node = &g_array_index (nodes, PosWordIndexNode, i);
+
+    node->max_freq = node->freq;
+    for (guint c = 0; c < node->n_children; c++) {
+      PosWordIndexNode *child = &g_array_index (nodes, PosWordIndexNode, node->first_child + c);
+
+      node->max_freq = MAX (node->max_freq, child->max_freq);
+    }
+  }
+
+  header.version = INDEX_VERSION;
+  header.byte_order = INDEX_BYTE_ORDER;
+  header.n_nodes = nodes->len;
+  header.source_mtime = st->st_mtime;
+  header.source_size = st->st_size;
+
+  len = sizeof (header) + nodes->len * sizeof (PosWordIndexNode);
+  buf = g_malloc (len);
+  memcpy (buf, &header, sizeof (header));
+  memcpy (buf + sizeof (header), nodes->data, nodes->len * sizeof (PosWordIndexNode));
+
+  g_debug ("Indexed %u words from %s in %u nodes", n_words, source, nodes->len);
+
+  return g_file_set_contents (index_path, buf, len, error);
+}
+
+
+static gboolean
+stat_source (const char *source, GStatBuf *st, GError **error)
+{
+  if (g_stat (source, st) != 0) {
+    int err = errno;
+
+    g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (err),
+                 "Failed to stat %s: %s", source, g_strerror (err));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+
+static PosWordIndex *
+load_index (const char *index_path, GStatBuf *st, GError **error)
+{
+  g_autoptr (GMappedFile) file = NULL;
+  const PosWordIndexHeader *header;
+  PosWordIndex *self;
+  const char *data;
+  gsize len;
+
+  file = g_mapped_file_new (index_path, FALSE, error);
+  if (file == NULL)
+    return NULL;
+
+  data = g_mapped_file_get_contents (file);
+  len = g_mapped_file_get_length (file);
+  if (len < sizeof (PosWordIndexHeader)) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "Index %s truncated", index_path);
+    return NULL;
+  }
+
+  header = (gconstpointer)data;
+  if (memcmp (header->magic, INDEX_MAGIC, sizeof (INDEX_MAGIC)) != 0 ||
+      header->version != INDEX_VERSION ||
+      header->byte_order != INDEX_BYTE_ORDER) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "Index %s has wrong format", index_path);
+    return NULL;
+  }
+
+  if (header->source_mtime != (guint64)st->st_mtime ||
+      header->source_size != (guint64)st->st_size) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "Index %s is outdated", index_path);
+    return NULL;
+  }
+
+  if (header->n_nodes == 0 ||
+      (len - sizeof (PosWordIndexHeader)) != (gsize)header->n_nodes * sizeof (PosWordIndexNode)) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "Index %s is corrupt", index_path);
+    return NULL;
+  }
+
+  self = g_new0 (PosWordIndex, 1);
+  self->header = header;
+  self->nodes = (gconstpointer)(data + sizeof (PosWordIndexHeader));
+  self->file = g_steal_pointer (&file);
+
+  return self;
+}
+
+/**
+ * pos_word_index_build:
+ * @source: The word list or hunspell dictionary
+ * @index_path: Where to store the index
+ * @error: The error location
+ *
+ * Builds an index for the given source and stores it at @index_path.
+ *
+ * Returns: %TRUE on success, otherwise %FALSE
+ */
+gboolean
+pos_word_index_build (const char *source, const char *index_path, GError **error)
+{
+  GStatBuf st;
+
+  g_return_val_if_fail (source, FALSE);
+  g_return_val_if_fail (index_path, FALSE);
+
+  if (!stat_source (source, &st, error))
+    return FALSE;
+
+  return build_index (source, &st, index_path, error);
+}
+
+/**
+ * pos_word_index_new_for_source:
+ * @source: The word list or hunspell dictionary
+ * @cache_dir:(nullable): The directory to keep the index in
+ * @error: The error location
+ *
+ * Maps the index for the given source into memory. If there's no
+ * index in @cache_dir yet or it is older than @source it is (re)built
+ * first. If @cache_dir is %NULL the user's cache directory is used.
+ *
+ * Returns:(transfer full)(nullable): The index or %NULL on error
+ */
+PosWordIndex *
+pos_word_index_new_for_source (const char *source, const char *cache_dir, GError **error)
+{
+  g_autoptr (GError) local_err = NULL;
+  g_autofree char *default_dir = NULL;
+  g_autofree char *checksum = NULL;
+  g_autofree char *name = NULL;
+  g_autofree char *path = NULL;
+  PosWordIndex *self;
+  GStatBuf st;
+
+  g_return_val_if_fail (source, NULL);
+
+  if (!stat_source (source, &st, error))
+    return NULL;
+
+  if (cache_dir == NULL) {
+    default_dir = g_build_filename (g_get_user_cache_dir (), "phosh-osk-stub", "word-index", NULL);
+    cache_dir = default_dir;
+  }
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, source, -1);
+  name = g_strdup_printf ("%s.idx", checksum);
+  path = g_build_filename (cache_dir, name, NULL);
+
+  self = load_index (path, &st, &local_err);
+  if (self)
+    return self;
+
+  g_debug ("Building index for %s: %s", source, local_err->message);
+  if (g_mkdir_with_parents (cache_dir, 0755) != 0) {
+    int err = errno;
+
+    g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (err),
+                 "Failed to create %s: %s", cache_dir, g_strerror (err));
+    return NULL;
+  }
+
+  if (!build_index (source, &st, path, error))
+    return NULL;
+
+  return load_index (path, &st, error);
+}
+
+
+void
+pos_word_index_free (PosWordIndex *self)
+{
+  g_return_if_fail (self);
+
+  g_mapped_file_unref (self->file);
+  g_free (self);
+}
+
+
+guint
+pos_word_index_get_n_nodes (PosWordIndex *self)
+{
+  g_return_val_if_fail (self, 0);
+
+  return self->header->n_nodes;
+}
+
+/* Only trust child ranges that point forward and stay within the index */
+static inline gboolean
+children_valid (PosWordIndex *self, guint32 idx)
+{
+  const PosWordIndexNode *node = &self->nodes[idx];
+
+  if (node->n_children == 0)
+    return FALSE;
+
+  return node->first_child > idx &&
+    (guint64)node->first_child + node->n_children <= self->header->n_nodes;
+}
+
+
+static guint32
+find_child (PosWordIndex *self, guint32 idx, guint8 byte)
+{
+  const PosWordIndexNode *node = &self->nodes[idx];
+  guint lo = 0, hi = node->n_children;
+
+  if (!children_valid (self, idx))
+    return NO_NODE;
+
+  while (lo < hi) {
+    guint mid = (lo + hi) / 2;
+    guint8 b = self->nodes[node->first_child + mid].byte;
+
+    if (b == byte)
+      return node->first_child + mid;
+    if (b < byte)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return NO_NODE;
+}
+
+
+static inline gboolean
+candidate_is_better (const PosWordIndexCandidate *a, const PosWordIndexCandidate *b)
+{
+  if (a->score != b->score)
+    return a->score > b->score;
+  if (a->is_word != b->is_word)
+    return a->is_word;
+  return a->node < b->node;
+}
+
+
+static void
+heap_push (GArray *heap, PosWordIndexCandidate *candidate)
+{
+  PosWordIndexCandidate *c;
+  guint i;
+
+  g_array_append_val (heap, *candidate);
+  c = (PosWordIndexCandidate *)heap->data;
+
+  for (i = heap->len - 1; i > 0;) {
+    guint parent = (i - 1) / 2;
+    PosWordIndexCandidate tmp;
+
+    if (!candidate_is_better (&c[i], &c[parent]))
+      break;
+
+    tmp = c[parent];
+    c[parent] = c[i];
+    c[i] = tmp;
+    i = parent;
+  }
+}
+
+
+static PosWordIndexCandidate
+heap_pop (GArray *heap)
+{
+  PosWordIndexCandidate *c = (PosWordIndexCandidate *)heap->data;
+  PosWordIndexCandidate top = c[0];
+  guint n, i = 0;
+
+  c[0] = c[heap->len - 1];
+  g_array_set_size (heap, heap->len - 1);
+  n = heap->len;
+
+  for (;;) {
+    guint best = i, l = 2 * i + 1, r = 2 * i + 2;
+    PosWordIndexCandidate tmp;
+
+    if (l < n && candidate_is_better (&c[l], &c[best]))
+      best = l;
+    if (r < n && candidate_is_better (&c[r], &c[best]))
+      best = r;
+    if (best == i)
+      break;
+
+    tmp = c[best];
+    c[best] = c[i];
+    c[i] = tmp;
+    i = best;
+  }
+
+  return top;
+}
+
+
+static char *
+path_append (const char *path, gsize len, guint8 byte)
+{
+  char *new_path = g_malloc (len + 2);
+
+  memcpy (new_path, path, len);
+  new_path[len] = byte;
+  new_path[len + 1] = '\0';
+
+  return new_path;
+}
+
+/**
+ * pos_word_index_lookup:
+ * @self: The index
+ * @prefix: The prefix to complete
+ * @max_results: The maximum number of completions
+ *
+ * Looks up the most frequent words starting with @prefix. The lookup
+ * is case insensitive and the words are returned in lower case.
+ *
+ * Returns:(transfer full)(nullable): The completions, most frequent first
+ */
+GStrv
+pos_word_index_lookup (PosWordIndex *self, const char *prefix, guint max_results)
+{
+  return pos_word_index_lookup_full (self, prefix, max_results, NULL);
+}
+
+/**
+ * pos_word_index_lookup_full:
+ * @self: The index
+ * @prefix: The prefix to complete
+ * @max_results: The maximum number of completions
+ * @complete:(out)(optional): Whether all words starting with @prefix were returned
+ *
+ * Like [method@WordIndex.lookup] but also tells whether the result
+ * holds all words matching @prefix.
+ *
+ * Returns:(transfer full)(nullable): The completions, most frequent first
+ */
+GStrv
+pos_word_index_lookup_full (PosWordIndex *self,
+                            const char   *prefix,
+                            guint         max_results,
+                            gboolean     *complete)
+{
+  g_autoptr (GArray) heap = NULL;
+  g_autoptr (GPtrArray) results = NULL;
+  g_autofree char *lower = NULL;
+  PosWordIndexCandidate candidate;
+  guint32 idx = 0;
+
+  g_return_val_if_fail (self, NULL);
+  g_return_val_if_fail (prefix, NULL);
+
+  if (complete)
+    *complete = FALSE;
+
+  if (max_results == 0)
+    return NULL;
+
+  lower = g_utf8_strdown (prefix, -1);
+  for (const char *p = lower; *p; p++) {
+    idx = find_child (self, idx, *p);
+    if (idx == NO_NODE) {
+      if (complete)
+        *complete = TRUE;
+      return NULL;
+    }
+  }
+
+  heap = g_array_new (FALSE, FALSE, sizeof (PosWordIndexCandidate));
+  results = g_ptr_array_new_with_free_func (g_free);
+
+  candidate = (PosWordIndexCandidate) {
+    .score = self->nodes[idx].max_freq,
+    .node = idx,
+    .path = g_steal_pointer (&lower),
+  };
+  heap_push (heap, &candidate);
+
+  /* Best first: a subtree is only expanded once it can contain a better word */
+  while (heap->len && results->len < max_results) {
+    PosWordIndexCandidate c = heap_pop (heap);
+    const PosWordIndexNode *node = &self->nodes[c.node];
+    gsize len;
+
+    if (c.is_word) {
+      g_ptr_array_add (results, c.path);
+      continue;
+    }
+
+    if (node->freq) {
+      candidate = (PosWordIndexCandidate) {
+        .score = node->freq,
+        .node = c.node,
+        .is_word = TRUE,
+        .path = g_strdup (c.path),
+      };
+      heap_push (heap, &candidate);
+    }
+
+    len = strlen (c.path);
+    if (len < MAX_WORD_LEN && children_valid (self, c.node)) {
+      for (guint i = 0; i < node->n_children; i++) {
+        guint32 child = node->first_child + i;
+
+        candidate = (PosWordIndexCandidate) {
+          .score = self->nodes[child].max_freq,
+          .node = child,
+          .path = path_append (c.path, len, self->nodes[child].byte),
+        };
+        heap_push (heap, &candidate);
+      }
+    }
+
+    g_free (c.path);
+  }
+
+  /* Unexpanded subtrees might hold further words */
+  if (complete)
+    *complete = heap->len == 0;
+
+  for (guint i = 0; i < heap->len; i++)
+    g_free (g_array_index (heap, PosWordIndexCandidate, i).path);
+
+  if (results->len == 0)
+    return NULL;
+
+  g_ptr_array_add (results, NULL);
+  return (GStrv)g_ptr_array_free (g_steal_pointer (&results), FALSE);
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _PosWordIndex PosWordIndex;
+
+PosWordIndex *pos_word_index_new_for_source (const char    *source,
+                                             const char    *cache_dir,
+                                             GError       **error);
+gboolean      pos_word_index_build          (const char    *source,
+                                             const char    *index_path,
+                                             GError       **error);
+void          pos_word_index_free           (PosWordIndex  *self);
+guint         pos_word_index_get_n_nodes    (PosWordIndex  *self);
+GStrv         pos_word_index_lookup         (PosWordIndex  *self,
+                                             const char    *prefix,
+                                             guint          max_results);
+GStrv         pos_word_index_lookup_full    (PosWordIndex  *self,
+                                             const char    *prefix,
+                                             guint          max_results,
+                                             gboolean      *complete);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PosWordIndex, pos_word_index_free)
+
+G_END_DECLS
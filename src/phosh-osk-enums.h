@@ -35,10 +35,13 @@ typedef enum {
  *   [signal@PosOskWiddget:key-up] for the old key and a
  *   [signal@PosOskWiddget:key-down] for the newly touched key. Without
  *   this flags the key press is canceled.
+ * PHOSH_OSK_FEATURE_BATCH_COMMITS: When set text sent via the input
+ *   method within one frame is merged into a single commit.
  */
 typedef enum {
-  PHOSH_OSK_FEATURE_DEFAULT  = 0,        /*< skip >*/
-  PHOSH_OSK_FEATURE_KEY_DRAG = (1 << 0), /*< nick=key-drag >*/
+  PHOSH_OSK_FEATURE_DEFAULT       = 0,        /*< skip >*/
+  PHOSH_OSK_FEATURE_KEY_DRAG      = (1 << 0), /*< nick=key-drag >*/
+  PHOSH_OSK_FEATURE_BATCH_COMMITS = (1 << 1), /*< nick=batch-commits >*/
 } PhoshOskFeatures;
 
 G_END_DECLS
@@ -0,0 +1,22 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "pos-clipboard-manager.h"
+
+G_BEGIN_DECLS
+
+void                 pos_clipboard_manager_read_text_async (GInputStream        *stream,
+                                                           gsize                max_size,
+                                                           GCancellable        *cancellable,
+                                                           GAsyncReadyCallback  callback,
+                                                           gpointer             user_data);
+char                *pos_clipboard_manager_read_text_finish (GInputStream  *stream,
+                                                            GAsyncResult  *res,
+                                                            GError       **error);
+
+G_END_DECLS
@@ -10,17 +10,27 @@
 
 #include "pos-config.h"
 
-#include "pos-clipboard-manager.h"
+#include "pos-clipboard-manager-priv.h"
 
 #include <glib-unix.h>
 #include <gio/gunixinputstream.h>
 
 #define MAX_TEXTS 5
+#define READ_CHUNK_SIZE 16384
+#define DEFAULT_MAX_SIZE (1024 * 1024)
 
 /**
  * PosClipboardManager:
  *
  * Handle copy/paste
+ *
+ * By default offers are kept and their text is only transferred when
+ * requested via [method@ClipboardManager.fetch_text_async]. When
+ * [property@ClipboardManager:fetch-on-demand] is disabled the text
+ * of each offer is read right away. In both cases the text is
+ * streamed from the compositor, validated as it arrives and the
+ * transfer is aborted once it exceeds
+ * [property@ClipboardManager:max-size].
  */
 
 typedef enum {
@@ -39,6 +49,8 @@ enum {
   PROP_DATA_CONTROL_MANAGER,
   PROP_WL_SEAT,
   PROP_HAS_TEXT,
+  PROP_FETCH_ON_DEMAND,
+  PROP_MAX_SIZE,
   PROP_LAST_PROP
 };
 static GParamSpec *props[PROP_LAST_PROP];
@@ -54,10 +66,82 @@ struct _PosClipboardManager {
   PosClipboardDataType                    data_type;
   GPtrArray                              *texts;
   GCancellable                           *cancel[2];
+  gboolean                                has_text;
+
+  /* Fetch on demand */
+  gboolean                                fetch_on_demand;
+  guint                                   max_size;
+  struct zwlr_data_control_offer_v1      *offers[2];
+  char                                   *offer_texts[2];
+  /* The fetch tasks waiting for an offer's ongoing transfer */
+  GPtrArray                              *fetch_tasks[2];
+  PosClipboardType                        last_type;
+
+  GSettings                              *settings;
 };
 G_DEFINE_TYPE (PosClipboardManager, pos_clipboard_manager, G_TYPE_OBJECT)
 
 
+static void
+pos_clipboard_manager_update_has_text (PosClipboardManager *self)
+{
+  gboolean has_text;
+
+  has_text = self->texts->len ||
+    self->offers[POS_CLIPBOARD_DEFAULT] ||
+    self->offers[POS_CLIPBOARD_PRIMARY];
+
+  if (self->has_text == has_text)
+    return;
+
+  self->has_text = has_text;
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_HAS_TEXT]);
+}
+
+
+static void
+pos_clipboard_manager_clear_offer (PosClipboardManager *self, PosClipboardType clipboard_type)
+{
+  g_cancellable_cancel (self->cancel[clipboard_type]);
+  g_clear_object (&self->cancel[clipboard_type]);
+  /* The cancelled transfer still completes the tasks it holds */
+  g_clear_pointer (&self->fetch_tasks[clipboard_type], g_ptr_array_unref);
+
+  g_clear_pointer (&self->offers[clipboard_type], zwlr_data_control_offer_v1_destroy);
+  g_clear_pointer (&self->offer_texts[clipboard_type], g_free);
+}
+
+
+static void
+pos_clipboard_manager_set_fetch_on_demand (PosClipboardManager *self, gboolean fetch_on_demand)
+{
+  if (self->fetch_on_demand == fetch_on_demand)
+    return;
+
+  self->fetch_on_demand = fetch_on_demand;
+
+  /* Kept offers are only useful when fetching on demand */
+  if (!fetch_on_demand) {
+    pos_clipboard_manager_clear_offer (self, POS_CLIPBOARD_DEFAULT);
+    pos_clipboard_manager_clear_offer (self, POS_CLIPBOARD_PRIMARY);
+    pos_clipboard_manager_update_has_text (self);
+  }
+
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_FETCH_ON_DEMAND]);
+}
+
+
+static void
+pos_clipboard_manager_set_max_size (PosClipboardManager *self, guint max_size)
+{
+  if (self->max_size == max_size)
+    return;
+
+  self->max_size = max_size;
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_MAX_SIZE]);
+}
+
+
 static void
 pos_clipboard_manager_set_property (GObject      *object,
                                     guint         property_id,
@@ -73,6 +157,12 @@ pos_clipboard_manager_set_property (GObject      *object,
   case PROP_WL_SEAT:
     self->wl_seat = g_value_get_pointer (value);
     break;
+  case PROP_FETCH_ON_DEMAND:
+    pos_clipboard_manager_set_fetch_on_demand (self, g_value_get_boolean (value));
+    break;
+  case PROP_MAX_SIZE:
+    pos_clipboard_manager_set_max_size (self, g_value_get_uint (value));
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     break;
@@ -90,7 +180,13 @@ pos_clipboard_manager_get_property (GObject    *object,
 
   switch (property_id) {
   case PROP_HAS_TEXT:
-    g_value_set_boolean (value, !!self->texts->len);
+    g_value_set_boolean (value, self->has_text);
+    break;
+  case PROP_FETCH_ON_DEMAND:
+    g_value_set_boolean (value, self->fetch_on_demand);
+    break;
+  case PROP_MAX_SIZE:
+    g_value_set_uint (value, self->max_size);
     break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -99,13 +195,177 @@ pos_clipboard_manager_get_property (GObject    *object,
 }
 
 
-#define BUFFER_SIZE 1023
+typedef struct {
+  GString *text;
+  gsize    read;
+  gsize    validated;
+  gsize    max_size;
+} ReadTextData;
+
+
+static void
+read_text_data_free (ReadTextData *data)
+{
+  if (data->text)
+    g_string_free (data->text, TRUE);
+  g_free (data);
+}
+
+/*
+ * Validate the text read since the last call. An incomplete multibyte
+ * sequence at the end is fine as long as more data can follow.
+ */
+static gboolean
+read_text_validate (ReadTextData *data, gboolean eos)
+{
+  const char *start = data->text->str + data->validated;
+  const char *end;
+
+  if (g_utf8_validate_len (start, data->text->len - data->validated, &end)) {
+    data->validated = data->text->len;
+    return TRUE;
+  }
+
+  data->validated = end - data->text->str;
+  if (eos)
+    return FALSE;
+
+  return g_utf8_get_char_validated (end, data->text->len - data->validated) == (gunichar)-2;
+}
+
+
+static void read_text_chunk (GTask *task);
+
+static void
+on_read_text_chunk_ready (GObject      *source_object,
+                          GAsyncResult *res,
+                          gpointer      user_data)
+{
+  g_autoptr (GTask) task = user_data;
+  ReadTextData *data = g_task_get_task_data (task);
+  GError *err = NULL;
+  gssize n;
+
+  n = g_input_stream_read_finish (G_INPUT_STREAM (source_object), res, &err);
+  if (n < 0) {
+    g_task_return_error (task, err);
+    return;
+  }
+
+  data->read += n;
+  g_string_truncate (data->text, data->read);
+
+  if (data->max_size && data->read > data->max_size) {
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_MESSAGE_TOO_LARGE,
+                             "Clipboard text exceeds %" G_GSIZE_FORMAT " bytes",
+                             data->max_size);
+    return;
+  }
+
+  if (!read_text_validate (data, n == 0)) {
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                             "Invalid utf-8 text received");
+    return;
+  }
+
+  if (n == 0) {
+    g_task_return_pointer (task, g_string_free (g_steal_pointer (&data->text), FALSE), g_free);
+    return;
+  }
+
+  read_text_chunk (g_steal_pointer (&task));
+}
+
+
+static void
+read_text_chunk (GTask *task)
+{
+  ReadTextData *data = g_task_get_task_data (task);
+  GInputStream *stream = g_task_get_source_object (task);
+  gsize count = READ_CHUNK_SIZE;
+
+  /* Read one byte more than allowed so we notice oversized text */
+  if (data->max_size)
+    count = MIN (count, data->max_size - data->read + 1);
+
+  /* GString grows exponentially so appending stays linear */
+  g_string_set_size (data->text, data->read + count);
+  g_input_stream_read_async (stream,
+                             data->text->str + data->read,
+                             count,
+                             G_PRIORITY_DEFAULT,
+                             g_task_get_cancellable (task),
+                             on_read_text_chunk_ready,
+                             task);
+}
+
+/*
+ * Read utf-8 text from @stream until the end of the stream. Fails with
+ * G_IO_ERROR_MESSAGE_TOO_LARGE if the text is larger than @max_size
+ * bytes. A @max_size of 0 disables the limit.
+ */
+void
+pos_clipboard_manager_read_text_async (GInputStream        *stream,
+                                       gsize                max_size,
+                                       GCancellable        *cancellable,
+                                       GAsyncReadyCallback  callback,
+                                       gpointer             user_data)
+{
+  g_autoptr (GTask) task = NULL;
+  ReadTextData *data;
+
+  data = g_new0 (ReadTextData, 1);
+  data->text = g_string_sized_new (READ_CHUNK_SIZE);
+  data->max_size = max_size;
+
+  task = g_task_new (stream, cancellable, callback, user_data);
+  g_task_set_source_tag (task, pos_clipboard_manager_read_text_async);
+  g_task_set_name (task, "pos-clipboard-read-text");
+  g_task_set_task_data (task, data, (GDestroyNotify)read_text_data_free);
+
+  read_text_chunk (g_steal_pointer (&task));
+}
+
+
+char *
+pos_clipboard_manager_read_text_finish (GInputStream *stream, GAsyncResult *res, GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (res, stream), NULL);
+
+  return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+
+static GInputStream *
+pos_clipboard_manager_receive_text (PosClipboardManager                *self,
+                                    struct zwlr_data_control_offer_v1  *offer,
+                                    GError                            **error)
+{
+  int fds[2];
+
+  if (!g_unix_open_pipe (fds, O_NONBLOCK, error))
+    return NULL;
+
+  zwlr_data_control_offer_v1_receive (offer, self->mime_type, fds[G_UNIX_PIPE_END_WRITE]);
+  close (fds[G_UNIX_PIPE_END_WRITE]);
+
+  return g_unix_input_stream_new (fds[G_UNIX_PIPE_END_READ], TRUE);
+}
+
+
+static void
+pos_clipboard_manager_add_text (PosClipboardManager *self, char *text)
+{
+  g_ptr_array_add (self->texts, text);
+  if (self->texts->len > MAX_TEXTS)
+    g_ptr_array_remove_index (self->texts, 0);
+
+  pos_clipboard_manager_update_has_text (self);
+}
+
+
 typedef struct  {
-  char                               buffer[BUFFER_SIZE+1];
-  char                              *text;
   struct zwlr_data_control_offer_v1 *offer;
-  PosClipboardType                   clipboard_type;
-  PosClipboardDataType               data_type;
   PosClipboardManager               *manager;
 } RequestData;
 
@@ -113,7 +373,6 @@ typedef struct  {
 static void
 pos_clipboard_manager_destroy_request_data (RequestData *request_data)
 {
-  g_free (request_data->text);
   zwlr_data_control_offer_v1_destroy (request_data->offer);
   g_free (request_data);
 }
@@ -125,47 +384,19 @@ pos_clipboard_manager_offer_request_text (GObject      *source_object,
                                           gpointer      data)
 {
   RequestData *request_data = data;
-  GInputStream *stream = G_INPUT_STREAM (source_object);
   g_autoptr (GError) error = NULL;
-  gboolean success;
-  gsize size;
-  PosClipboardManager *self;
+  char *text;
 
-  success = g_input_stream_read_all_finish (stream, res, &size, &error);
-  if (!success) {
+  text = pos_clipboard_manager_read_text_finish (G_INPUT_STREAM (source_object), res, &error);
+  if (text == NULL) {
     if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
       g_warning ("Failed to get text from pipe: %s", error->message);
     pos_clipboard_manager_destroy_request_data (request_data);
     return;
   }
 
-  self = request_data->manager;
-  if (size > 0) {
-    char *text;
-
-    request_data->buffer[size] = '\0';
-    text = g_strconcat (request_data->text, request_data->buffer, NULL);
-    g_free (request_data->text);
-    request_data->text = text;
-
-    if (size == BUFFER_SIZE) {
-      g_input_stream_read_all_async (stream, request_data->buffer, BUFFER_SIZE, G_PRIORITY_DEFAULT,
-                                     self->cancel[request_data->clipboard_type],
-                                     pos_clipboard_manager_offer_request_text,
-                                     request_data);
-      return;
-    }
-  }
-
-  if (g_utf8_validate (request_data->text, -1, NULL)) {
-
-    g_debug ("Got %s", request_data->text);
-    g_ptr_array_add (self->texts, g_steal_pointer (&request_data->text));
-    if (self->texts->len == 1)
-      g_object_notify_by_pspec (G_OBJECT (self), props[PROP_HAS_TEXT]);
-  } else {
-    g_warning_once ("Invalid utf-8 text received");
-  }
+  g_debug ("Got %" G_GSIZE_FORMAT " bytes of text", strlen (text));
+  pos_clipboard_manager_add_text (request_data->manager, text);
 
   pos_clipboard_manager_destroy_request_data (request_data);
 }
@@ -179,38 +410,58 @@ pos_clipboard_manager_offer_request_data (PosClipboardManager               *sel
   RequestData *request_data;
   g_autoptr (GInputStream) stream = NULL;
   g_autoptr (GError) error = NULL;
-  int fds[2];
 
-  if (!g_unix_open_pipe (fds, O_NONBLOCK, &error)) {
+  stream = pos_clipboard_manager_receive_text (self, offer, &error);
+  if (stream == NULL) {
     g_warning ("Failed to open pipe: %s", error->message);
     return FALSE;
   }
-  zwlr_data_control_offer_v1_receive (offer, self->mime_type, fds[G_UNIX_PIPE_END_WRITE]);
-  close (fds[G_UNIX_PIPE_END_WRITE]);
-
-  stream = g_unix_input_stream_new (fds[G_UNIX_PIPE_END_READ], TRUE);
-  self->cancel[clipboard_type] = g_cancellable_new ();
-
-  if (self->data_type != POS_CLIPBOARD_DATA_TEXT) {
-    close (G_UNIX_PIPE_END_READ);
-    g_return_val_if_reached (FALSE);
-  }
 
   request_data = g_new0 (RequestData, 1);
   request_data->offer = offer;
   request_data->manager = self;
-  request_data->clipboard_type = clipboard_type;
-  request_data->data_type = self->data_type;
-  request_data->text = g_strdup ("");
-
-  g_input_stream_read_all_async (stream, request_data->buffer, BUFFER_SIZE, G_PRIORITY_DEFAULT,
-                                 self->cancel[request_data->clipboard_type],
-                                 pos_clipboard_manager_offer_request_text,
-                                 request_data);
+
+  pos_clipboard_manager_read_text_async (stream,
+                                         self->max_size,
+                                         self->cancel[clipboard_type],
+                                         pos_clipboard_manager_offer_request_text,
+                                         request_data);
   return TRUE;
 }
 
 
+static void
+pos_clipboard_manager_set_selection (PosClipboardManager               *self,
+                                     struct zwlr_data_control_offer_v1 *offer,
+                                     PosClipboardType                   clipboard_type)
+{
+  pos_clipboard_manager_clear_offer (self, clipboard_type);
+
+  if (offer == NULL)
+    goto out;
+
+  if (self->data_type == POS_CLIPBOARD_DATA_NONE) {
+    zwlr_data_control_offer_v1_destroy (offer);
+    goto out;
+  }
+
+  self->cancel[clipboard_type] = g_cancellable_new ();
+
+  if (self->fetch_on_demand) {
+    /* Keep the offer around until someone wants its text */
+    self->offers[clipboard_type] = offer;
+    self->last_type = clipboard_type;
+    goto out;
+  }
+
+  if (!pos_clipboard_manager_offer_request_data (self, offer, clipboard_type))
+    zwlr_data_control_offer_v1_destroy (offer);
+
+ out:
+  pos_clipboard_manager_update_has_text (self);
+}
+
+
 static void
 handle_zwlr_data_control_offer_offer (void                              *data,
                                       struct zwlr_data_control_offer_v1 *offer,
@@ -260,19 +511,7 @@ handle_zwlr_data_control_device_selection (void                               *d
 {
   PosClipboardManager *self = POS_CLIPBOARD_MANAGER (data);
 
-  g_cancellable_cancel (self->cancel[POS_CLIPBOARD_DEFAULT]);
-  g_clear_object (&self->cancel[POS_CLIPBOARD_DEFAULT]);
-
-  if (offer == NULL)
-    return;
-
-  if (self->data_type == POS_CLIPBOARD_DATA_NONE) {
-    zwlr_data_control_offer_v1_destroy (offer);
-    return;
-  }
-
-  if (!pos_clipboard_manager_offer_request_data (self, offer, POS_CLIPBOARD_DEFAULT))
-    zwlr_data_control_offer_v1_destroy (offer);
+  pos_clipboard_manager_set_selection (self, offer, POS_CLIPBOARD_DEFAULT);
 }
 
 
@@ -283,19 +522,7 @@ handle_zwlr_data_control_device_primary_selection (void
 {
   PosClipboardManager *self = POS_CLIPBOARD_MANAGER (data);
 
-  g_cancellable_cancel (self->cancel[POS_CLIPBOARD_PRIMARY]);
-  g_clear_object (&self->cancel[POS_CLIPBOARD_PRIMARY]);
-
-  if (offer == NULL)
-    return;
-
-  if (self->data_type == POS_CLIPBOARD_DATA_NONE) {
-    zwlr_data_control_offer_v1_destroy (offer);
-    return;
-  }
-
-  if (!pos_clipboard_manager_offer_request_data (self, offer, POS_CLIPBOARD_PRIMARY))
-    zwlr_data_control_offer_v1_destroy (offer);
+  pos_clipboard_manager_set_selection (self, offer, POS_CLIPBOARD_PRIMARY);
 }
 
 
@@ -338,12 +565,10 @@ pos_clipboard_manager_finalize (GObject *object)
 {
   PosClipboardManager *self = POS_CLIPBOARD_MANAGER (object);
 
-  g_cancellable_cancel (self->cancel[POS_CLIPBOARD_PRIMARY]);
-  g_clear_object (&self->cancel[POS_CLIPBOARD_PRIMARY]);
-
-  g_cancellable_cancel (self->cancel[POS_CLIPBOARD_DEFAULT]);
-  g_clear_object (&self->cancel[POS_CLIPBOARD_DEFAULT]);
+  pos_clipboard_manager_clear_offer (self, POS_CLIPBOARD_PRIMARY);
+  pos_clipboard_manager_clear_offer (self, POS_CLIPBOARD_DEFAULT);
 
+  g_clear_object (&self->settings);
   g_clear_pointer (&self->texts, g_ptr_array_unref);
   g_clear_pointer (&self->mime_type, g_free);
   g_clear_pointer (&self->data_control_device, zwlr_data_control_device_v1_destroy);
@@ -375,6 +600,29 @@ pos_clipboard_manager_class_init (PosClipboardManagerClass *klass)
                           FALSE,
                           G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * PosClipboardManager:fetch-on-demand:
+   *
+   * Whether to keep offers and only transfer their text when it's
+   * requested via [method@ClipboardManager.fetch_text_async] instead
+   * of reading the text of every offer right away.
+   */
+  props[PROP_FETCH_ON_DEMAND] =
+    g_param_spec_boolean ("fetch-on-demand", "", "",
+                          TRUE,
+                          G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
+  /**
+   * PosClipboardManager:max-size:
+   *
+   * The maximum size of clipboard text in bytes. Larger texts are
+   * dropped. `0` means no limit.
+   */
+  props[PROP_MAX_SIZE] =
+    g_param_spec_uint ("max-size", "", "",
+                       0, G_MAXUINT, DEFAULT_MAX_SIZE,
+                       G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
   g_object_class_install_properties (object_class, PROP_LAST_PROP, props);
 }
 
@@ -382,7 +630,13 @@ pos_clipboard_manager_class_init (PosClipboardManagerClass *klass)
 static void
 pos_clipboard_manager_init (PosClipboardManager *self)
 {
-  self->texts = g_ptr_array_new_full (MAX_TEXTS, g_free);
+  self->texts = g_ptr_array_new_full (MAX_TEXTS + 1, g_free);
+  self->fetch_on_demand = TRUE;
+  self->max_size = DEFAULT_MAX_SIZE;
+
+  self->settings = g_settings_new ("sm.puri.phosh.osk.Clipboard");
+  g_settings_bind (self->settings, "fetch-on-demand", self, "fetch-on-demand", G_SETTINGS_BIND_GET);
+  g_settings_bind (self->settings, "max-size", self, "max-size", G_SETTINGS_BIND_GET);
 }
 
 
@@ -400,7 +654,8 @@ pos_clipboard_manager_new (struct zwlr_data_control_manager_v1 *manager,
  * pos_clipboard_manager_get_text:
  * @self: The clipboard manager
  *
- * Get the most recently copied text
+ * Get the most recently copied text. When fetching on demand this is
+ * the most recently fetched text.
  *
  * Returns: The text
  */
@@ -436,3 +691,145 @@ pos_clipboard_manager_get_texts (PosClipboardManager *self)
 
   return g_strv_builder_end (builder);
 }
+
+
+static void
+on_fetch_text_read (GObject      *source_object,
+                    GAsyncResult *res,
+                    gpointer      user_data)
+{
+  g_autoptr (GPtrArray) tasks = user_data;
+  GTask *first = g_ptr_array_index (tasks, 0);
+  PosClipboardManager *self = g_task_get_source_object (first);
+  PosClipboardType clipboard_type = GPOINTER_TO_UINT (g_task_get_task_data (first));
+  g_autoptr (GError) err = NULL;
+  g_autofree char *text = NULL;
+
+  text = pos_clipboard_manager_read_text_finish (G_INPUT_STREAM (source_object), res, &err);
+
+  /* Only an ongoing transfer can have waiting tasks */
+  if (self->fetch_tasks[clipboard_type] == tasks)
+    g_clear_pointer (&self->fetch_tasks[clipboard_type], g_ptr_array_unref);
+
+  if (text) {
+    /* A selection change would have cancelled the read so the offer is still current */
+    g_debug ("Fetched %" G_GSIZE_FORMAT " bytes of text", strlen (text));
+    g_free (self->offer_texts[clipboard_type]);
+    self->offer_texts[clipboard_type] = g_strdup (text);
+    pos_clipboard_manager_add_text (self, g_strdup (text));
+  }
+
+  for (guint i = 0; i < tasks->len; i++) {
+    GTask *task = g_ptr_array_index (tasks, i);
+
+    /* The caller gave up while the transfer was ongoing */
+    if (g_task_return_error_if_cancelled (task))
+      continue;
+
+    if (text)
+      g_task_return_pointer (task, g_strdup (text), g_free);
+    else
+      g_task_return_error (task, g_error_copy (err));
+  }
+}
+
+/**
+ * pos_clipboard_manager_fetch_text_async:
+ * @self: The clipboard manager
+ * @cancellable:(nullable): A cancellable
+ * @callback: The callback to invoke once the text is available
+ * @user_data: The user data passed to @callback
+ *
+ * Fetches the text of the most recent selection. When fetching on
+ * demand the text is transferred from the selection's owner unless it
+ * was already fetched before. Concurrent requests for the same
+ * selection share a single transfer. Otherwise this returns the most
+ * recently copied text.
+ */
+void
+pos_clipboard_manager_fetch_text_async (PosClipboardManager *self,
+                                        GCancellable        *cancellable,
+                                        GAsyncReadyCallback  callback,
+                                        gpointer             user_data)
+{
+  g_autoptr (GTask) task = NULL;
+  g_autoptr (GInputStream) stream = NULL;
+  PosClipboardType clipboard_type;
+  const char *text;
+  GError *err = NULL;
+
+  g_return_if_fail (POS_IS_CLIPBOARD_MANAGER (self));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, pos_clipboard_manager_fetch_text_async);
+  g_task_set_name (task, "pos-clipboard-fetch-text");
+
+  clipboard_type = self->last_type;
+  if (self->offers[clipboard_type] == NULL) {
+    clipboard_type = clipboard_type == POS_CLIPBOARD_DEFAULT ?
+      POS_CLIPBOARD_PRIMARY : POS_CLIPBOARD_DEFAULT;
+  }
+
+  if (self->offers[clipboard_type] == NULL) {
+    text = pos_clipboard_manager_get_text (self);
+    if (text == NULL) {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "No text in clipboard");
+      return;
+    }
+    g_task_return_pointer (task, g_strdup (text), g_free);
+    return;
+  }
+
+  text = self->offer_texts[clipboard_type];
+  if (text) {
+    g_task_return_pointer (task, g_strdup (text), g_free);
+    return;
+  }
+
+  g_task_set_task_data (task, GUINT_TO_POINTER (clipboard_type), NULL);
+
+  /* Repeated requests share the ongoing transfer */
+  if (self->fetch_tasks[clipboard_type]) {
+    g_debug ("Waiting for ongoing transfer");
+    g_ptr_array_add (self->fetch_tasks[clipboard_type], g_steal_pointer (&task));
+    return;
+  }
+
+  stream = pos_clipboard_manager_receive_text (self, self->offers[clipboard_type], &err);
+  if (stream == NULL) {
+    g_task_return_error (task, err);
+    return;
+  }
+
+  /* The transfer only ends with the offer so it isn't tied to a single caller */
+  self->fetch_tasks[clipboard_type] = g_ptr_array_new_with_free_func (g_object_unref);
+  g_ptr_array_add (self->fetch_tasks[clipboard_type], g_steal_pointer (&task));
+  pos_clipboard_manager_read_text_async (stream,
+                                         self->max_size,
+                                         self->cancel[clipboard_type],
+                                         on_fetch_text_read,
+                                         g_ptr_array_ref (self->fetch_tasks[clipboard_type]));
+}
+
+/**
+ * pos_clipboard_manager_fetch_text_finish:
+ * @self: The clipboard manager
+ * @res: The result
+ * @error: The return location for a recoverable error.
+ *
+ * Finishes an operation started by
+ * [method@ClipboardManager.fetch_text_async].
+ *
+ * Returns:(transfer full): The text or %NULL on error.
+ */
+char *
+pos_clipboard_manager_fetch_text_finish (PosClipboardManager  *self,
+                                         GAsyncResult         *res,
+                                         GError              **error)
+{
+  g_return_val_if_fail (POS_IS_CLIPBOARD_MANAGER (self), NULL);
+  g_return_val_if_fail (g_task_is_valid (res, self), NULL);
+
+  return g_task_propagate_pointer (G_TASK (res), error);
+}
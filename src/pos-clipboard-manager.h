@@ -8,7 +8,7 @@
 #include "wlr-data-control-unstable-v1-client-protocol.h"
 
 #include <gdk/gdkwayland.h>
-#include <glib-object.h>
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
@@ -20,5 +20,12 @@ PosClipboardManager *pos_clipboard_manager_new (struct zwlr_data_control_manager
                                                 struct wl_seat                      *seat);
 const char          *pos_clipboard_manager_get_text (PosClipboardManager *self);
 GStrv                pos_clipboard_manager_get_texts (PosClipboardManager *self);
+void                 pos_clipboard_manager_fetch_text_async (PosClipboardManager *self,
+                                                            GCancellable        *cancellable,
+                                                            GAsyncReadyCallback  callback,
+                                                            gpointer             user_data);
+char                *pos_clipboard_manager_fetch_text_finish (PosClipboardManager  *self,
+                                                             GAsyncResult         *res,
+                                                             GError              **error);
 
 G_END_DECLS
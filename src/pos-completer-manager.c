@@ -13,9 +13,8 @@
 #include "pos-completer-manager.h"
 #include "completers/pos-completer-presage.h"
 #include "completers/pos-completer-pipe.h"
-#ifdef POS_HAVE_FZF
-# include "completers/pos-completer-fzf.h"
-#endif
+#include "completers/pos-completer-fzf.h"
+#include "completers/pos-completer-wordlist.h"
 #ifdef POS_HAVE_HUNSPELL
 # include "completers/pos-completer-hunspell.h"
 #endif
@@ -27,10 +26,15 @@
 
 #include <gio/gio.h>
 
+#define COMPLETION_CACHE_SIZE (256 * 1024)
+
 /**
  * PosCompleterManager:
  *
  * Manages initialization and lookup of the different completion engines.
+ *
+ * All completers share a [class@CompletionCache] so retyping the same
+ * input doesn't hit the completion engines again.
  */
 
 /**
@@ -47,12 +51,13 @@ enum {
 static GParamSpec *props[PROP_LAST_PROP];
 
 struct _PosCompleterManager {
-  GObject           parent;
+  GObject             parent;
 
-  PosCompleter     *default_;
-  GSettings        *settings;
+  PosCompleter       *default_;
+  GSettings          *settings;
 
-  GHashTable       *completers; /* key: engine name, value: PosCompleter */
+  GHashTable         *completers; /* key: engine name, value: PosCompleter */
+  PosCompletionCache *cache;
 };
 G_DEFINE_TYPE (PosCompleterManager, pos_completer_manager, G_TYPE_OBJECT)
 
@@ -97,13 +102,16 @@ init_completer (PosCompleterManager *self, const char *name, GError **err)
       goto done;
     return NULL;
 #endif
-#ifdef POS_HAVE_FZF
   } else if (g_strcmp0 (name, "fzf") == 0) {
     completer = pos_completer_fzf_new (err);
     if (completer)
       goto done;
     return NULL;
-#endif
+  } else if (g_strcmp0 (name, "wordlist") == 0) {
+    completer = pos_completer_wordlist_new (err);
+    if (completer)
+      goto done;
+    return NULL;
 #ifdef POS_HAVE_HUNSPELL
   } else if (g_strcmp0 (name, "hunspell") == 0) {
     completer = pos_completer_hunspell_new (err);
@@ -128,6 +136,7 @@ init_completer (PosCompleterManager *self, const char *name, GError **err)
   return NULL;
 
  done:
+  pos_completer_set_cache (completer, self->cache);
   if (!g_hash_table_contains (self->completers, name))
     g_hash_table_insert (self->completers, g_strdup (name), g_object_ref (completer));
   return completer;
@@ -195,6 +204,7 @@ pos_completer_manager_finalize (GObject *object)
 
   g_clear_object (&self->settings);
   g_clear_pointer (&self->completers, g_hash_table_destroy);
+  g_clear_object (&self->cache);
   self->default_ = NULL;
 
   G_OBJECT_CLASS (pos_completer_manager_parent_class)->finalize (object);
@@ -254,6 +264,7 @@ static void
 pos_completer_manager_init (PosCompleterManager *self)
 {
   self->settings = g_settings_new ("sm.puri.phosh.osk.Completers");
+  self->cache = pos_completion_cache_new (COMPLETION_CACHE_SIZE);
   self->completers = g_hash_table_new_full (g_str_hash,
                                             g_str_equal,
                                             g_free,
@@ -332,3 +343,20 @@ pos_completer_manager_get_info (PosCompleterManager *self,
 
   return info;
 }
+
+/**
+ * pos_completer_manager_get_cache:
+ * @self: The completer manager
+ *
+ * Get the completion cache shared by all completers. This can e.g. be
+ * used to query the hit and miss counters.
+ *
+ * Returns:(transfer none): The completion cache
+ */
+PosCompletionCache *
+pos_completer_manager_get_cache (PosCompleterManager *self)
+{
+  g_return_val_if_fail (POS_IS_COMPLETER_MANAGER (self), NULL);
+
+  return self->cache;
+}
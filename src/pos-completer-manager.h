@@ -30,6 +30,7 @@ PosCompletionInfo   *pos_completer_manager_get_info              (PosCompleterMa
                                                                   const char          *lang,
                                                                   const char          *region,
                                                                   GError             **err);
+PosCompletionCache  *pos_completer_manager_get_cache             (PosCompleterManager *self);
 
 void                 pos_completion_info_free                    (PosCompletionInfo   *info);
 
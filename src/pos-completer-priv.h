@@ -17,4 +17,72 @@ gboolean       pos_completer_add_preedit (PosCompleter *self,
 gboolean       pos_completer_symbol_is_word_separator (const char *symbol,
                                                        gboolean *is_ws);
 gboolean       pos_completer_grab_last_word (const char *before, char **new_before, char **word);
+gboolean       pos_completer_lookup_cached (PosCompleter *self, const char *preedit, GStrv *completions);
+void           pos_completer_cache_completions (PosCompleter *self, const char *preedit, GStrv completions);
+
+/**
+ * PosCompleterMatchFunc:
+ * @query: The query
+ * @candidate: The candidate to check
+ * @user_data: The user data
+ *
+ * Checks whether @candidate matches @query.
+ *
+ * Returns: The score of the match (higher is better) or a negative value if
+ *    @candidate doesn't match.
+ */
+typedef int (*PosCompleterMatchFunc) (const char *query, const char *candidate, gpointer user_data);
+
+/**
+ * PosCompleterScoredCandidate:
+ * @candidate: The candidate
+ * @score: The candidate's score for the current query
+ * @rank: The candidate's rank as given to the refiner
+ *
+ * A candidate scored by the refiner.
+ */
+typedef struct {
+  const char *candidate;
+  int         score;
+  guint       rank;
+} PosCompleterScoredCandidate;
+
+/**
+ * PosCompleterCompareFunc:
+ * @a: A scored candidate
+ * @b: Another scored candidate
+ *
+ * Orders scored candidates the same way the completion engine orders
+ * the results of a full query.
+ *
+ * Returns: A negative value if @a comes first, a positive value if @b does
+ */
+typedef int (*PosCompleterCompareFunc) (const PosCompleterScoredCandidate *a,
+                                        const PosCompleterScoredCandidate *b);
+
+typedef struct _PosCompleterRefiner PosCompleterRefiner;
+
+PosCompleterRefiner *pos_completer_refiner_new             (void);
+void                 pos_completer_refiner_free            (PosCompleterRefiner   *self);
+void                 pos_completer_refiner_reset           (PosCompleterRefiner   *self);
+void                 pos_completer_refiner_set_candidates  (PosCompleterRefiner   *self,
+                                                            const char            *query,
+                                                            GStrv                  candidates,
+                                                            gboolean               complete);
+void                 pos_completer_refiner_set_candidates_full (PosCompleterRefiner *self,
+                                                                const char          *query,
+                                                                GStrv                candidates,
+                                                                const guint         *ranks,
+                                                                gboolean             complete);
+void                 pos_completer_refiner_set_compare_func (PosCompleterRefiner     *self,
+                                                             PosCompleterCompareFunc  compare_func);
+gboolean             pos_completer_refiner_refine          (PosCompleterRefiner   *self,
+                                                            const char            *query,
+                                                            PosCompleterMatchFunc  match_func,
+                                                            gpointer               user_data);
+GStrv                pos_completer_refiner_get_completions (PosCompleterRefiner   *self,
+                                                            guint                  max_completions);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PosCompleterRefiner, pos_completer_refiner_free)
+
 G_END_DECLS
@@ -12,10 +12,10 @@
 
 #include "pos-completer.h"
 #include "pos-completer-priv.h"
+#include "pos-completion-cache.h"
+#include "pos-word-boundary.h"
 #include "util.h"
 
-#include <ctype.h>
-
 /**
  * PosCompleter:
  *
@@ -34,30 +34,56 @@
  * characters to either take the user input as is or force
  * "aggressive" autocorrection (picking a correction on the users
  * behalf).
+ *
+ * Looking up completions can be slow (e.g. on long words or when
+ * dictionaries are cold) so engines should implement the `lookup`
+ * vfunc and use [method@Completer.lookup_async] to run it in a
+ * worker thread instead of blocking the main loop on every keystroke.
  */
 
 G_DEFINE_INTERFACE (PosCompleter, pos_completer, G_TYPE_OBJECT)
 
-/* TODO: all the brackets, also language dependent */
-static const char * const completion_end_symbols[] = {
-  /* whitespace */
-  " ",
-  "\t",
-  "\n",
-  /* non-whitespace */
-  ".",
-  ",",
-  ";",
-  ":",
-  "?",
-  "!",
-  "(", ")",
-  "{", "}",
-  "[", "]",
-  NULL,
+
+/* Context n-gram based completers care about */
+#define CACHE_CONTEXT_LEN 64
+
+typedef struct {
+  char     *before_text;
+  char     *preedit;
+  char     *cache_key;
+  gboolean  cached;
+} PosCompleterLookupData;
+
+/**
+ * PosCompleterRefiner:
+ *
+ * Keeps the candidates of the last full query of a completer so that
+ * appending characters to the preedit only needs to filter these
+ * instead of querying the engine again.
+ *
+ * This is only correct when the engine's matches for a longer query
+ * are a subset of those for its prefix (e.g. prefix or subsequence
+ * matching) and the stored candidates were complete.
+ */
+struct _PosCompleterRefiner {
+  char                    *query;
+  GPtrArray               *candidates;
+  GArray                  *ranks;
+  gboolean                 complete;
+  PosCompleterCompareFunc  compare_func;
 };
 
 
+static void
+pos_completer_lookup_data_free (PosCompleterLookupData *data)
+{
+  g_free (data->before_text);
+  g_free (data->preedit);
+  g_free (data->cache_key);
+  g_free (data);
+}
+
+
 GQuark
 pos_completer_error_quark (void)
 {
@@ -158,6 +184,20 @@ pos_completer_default_init (PosCompleterInterface *iface)
                 G_TYPE_STRING,
                 G_TYPE_UINT,
                 G_TYPE_UINT);
+  /**
+   * PosCompleter::loading-changed
+   * @iface: The completer interface
+   *
+   * The completer started or finished loading data (e.g. a dictionary)
+   * it needs to provide completions. Use [method@Completer.is_loading]
+   * to get the current state.
+   */
+  g_signal_new ("loading-changed",
+                iface_type,
+                G_SIGNAL_RUN_LAST,
+                0, NULL, NULL, NULL,
+                G_TYPE_NONE,
+                0);
 }
 
 /**
@@ -334,6 +374,133 @@ pos_completer_set_surrounding_text (PosCompleter *self,
   return iface->set_surrounding_text (self, before_text, after_text);
 }
 
+/**
+ * pos_completer_update_surrounding_text:
+ * @self: the completer
+ * @text: (nullable): the surrounding text
+ * @cursor: the cursor position in bytes
+ *
+ * Like [method@Completer.set_surrounding_text] but passes the whole
+ * surrounding text. The text is only borrowed for the duration of the
+ * call so completers implementing the `update_surrounding_text` vfunc
+ * can check for changes without the text being copied first.
+ * Completers that don't implement it get copies of the text before
+ * and after the cursor via `set_surrounding_text`.
+ */
+void
+pos_completer_update_surrounding_text (PosCompleter *self,
+                                       const char   *text,
+                                       guint         cursor)
+{
+  PosCompleterInterface *iface;
+  g_autofree char *before = NULL;
+  g_autofree char *after = NULL;
+
+  g_return_if_fail (POS_IS_COMPLETER (self));
+
+  iface = POS_COMPLETER_GET_IFACE (self);
+  if (text)
+    cursor = MIN (cursor, strlen (text));
+
+  if (iface->update_surrounding_text) {
+    iface->update_surrounding_text (self, text, cursor);
+    return;
+  }
+
+  /* optional */
+  if (iface->set_surrounding_text == NULL)
+    return;
+
+  if (text) {
+    before = g_strndup (text, cursor);
+    after = g_strdup (&text[cursor]);
+  }
+
+  iface->set_surrounding_text (self, before, after);
+}
+
+static char *
+build_cache_key (PosCompleter *self, const char *before_text, const char *preedit)
+{
+  const char *lang = g_object_get_data (G_OBJECT (self), "pos-lang");
+  const char *context = before_text ?: "";
+  gsize len = strlen (context);
+
+  /* Only the last words matter to context aware completers */
+  if (len > CACHE_CONTEXT_LEN) {
+    context = &context[len - CACHE_CONTEXT_LEN];
+    /* Skip continuation bytes */
+    while ((*context & 0xc0) == 0x80)
+      context++;
+  }
+
+  return g_strdup_printf ("%s\x1f%s\x1f%s\x1f%s",
+                          pos_completer_get_name (self),
+                          lang ?: "",
+                          context,
+                          preedit ?: "");
+}
+
+
+static void
+invalidate_cache (PosCompleter *self)
+{
+  PosCompletionCache *cache = g_object_get_data (G_OBJECT (self), "pos-completion-cache");
+  g_autofree char *prefix = NULL;
+
+  if (cache == NULL)
+    return;
+
+  prefix = g_strdup_printf ("%s\x1f", pos_completer_get_name (self));
+  pos_completion_cache_invalidate (cache, prefix);
+}
+
+/**
+ * pos_completer_is_loading:
+ * @self: The completer
+ *
+ * Whether the completer is still loading data it needs to provide
+ * completions for the current language. Completions will be empty
+ * until loading finished.
+ *
+ * Returns: %TRUE if the completer is loading
+ */
+gboolean
+pos_completer_is_loading (PosCompleter *self)
+{
+  PosCompleterInterface *iface;
+
+  g_return_val_if_fail (POS_IS_COMPLETER (self), FALSE);
+
+  iface = POS_COMPLETER_GET_IFACE (self);
+  /* optional */
+  if (iface->is_loading == NULL)
+    return FALSE;
+
+  return iface->is_loading (self);
+}
+
+/**
+ * pos_completer_set_cache:
+ * @self: The completer
+ * @cache:(nullable): The completion cache
+ *
+ * Sets the cache the completer should use to look up and store
+ * completions. Several completers can share a cache.
+ */
+void
+pos_completer_set_cache (PosCompleter *self, PosCompletionCache *cache)
+{
+  g_return_if_fail (POS_IS_COMPLETER (self));
+  g_return_if_fail (cache == NULL || POS_IS_COMPLETION_CACHE (cache));
+
+  if (cache)
+    g_object_set_data_full (G_OBJECT (self), "pos-completion-cache", g_object_ref (cache),
+                            g_object_unref);
+  else
+    g_object_set_data (G_OBJECT (self), "pos-completion-cache", NULL);
+}
+
 /**
  * pos_completer_set_language:
  * @self: The completer
@@ -356,6 +523,7 @@ pos_completer_set_language (PosCompleter *self,
                             GError      **error)
 {
   PosCompleterInterface *iface;
+  g_autofree char *lang_region = NULL;
 
   g_return_val_if_fail (POS_IS_COMPLETER (self), FALSE);
 
@@ -366,7 +534,16 @@ pos_completer_set_language (PosCompleter *self,
 
   g_return_val_if_fail (lang, FALSE);
 
-  return iface->set_language (self, lang, region, error);
+  if (!iface->set_language (self, lang, region, error))
+    return FALSE;
+
+  lang_region = g_strdup_printf ("%s-%s", lang, region ?: "");
+  if (g_strcmp0 (g_object_get_data (G_OBJECT (self), "pos-lang"), lang_region)) {
+    invalidate_cache (self);
+    g_object_set_data_full (G_OBJECT (self), "pos-lang", g_steal_pointer (&lang_region), g_free);
+  }
+
+  return TRUE;
 }
 
 /* Used by completers to simplify implementations */
@@ -451,10 +628,202 @@ pos_completer_learn_accepted (PosCompleter *self, const char *word)
   g_return_if_fail (POS_IS_COMPLETER (self));
 
   iface = POS_COMPLETER_GET_IFACE (self);
-  if (iface->get_display_name == NULL)
+  if (iface->learn_accepted == NULL)
+    return;
+
+  iface->learn_accepted (self, word);
+  /* Learned words affect the completions */
+  invalidate_cache (self);
+}
+
+
+static void
+lookup_thread (GTask        *task,
+               gpointer      source_object,
+               gpointer      task_data,
+               GCancellable *cancellable)
+{
+  PosCompleter *self = POS_COMPLETER (source_object);
+  PosCompleterLookupData *data = task_data;
+  PosCompleterInterface *iface;
+  GError *err = NULL;
+  GStrv completions;
+
+  /* A newer lookup superseded us while we were queued */
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  iface = POS_COMPLETER_GET_IFACE (self);
+  completions = iface->lookup (self, data->before_text, data->preedit, cancellable, &err);
+  if (err) {
+    g_task_return_error (task, err);
+    return;
+  }
+
+  g_task_return_pointer (task, completions, (GDestroyNotify)g_strfreev);
+}
+
+/**
+ * pos_completer_lookup_async:
+ * @self: The completer
+ * @cancellable:(nullable): A cancellable
+ * @callback: The callback to invoke once the lookup finished
+ * @user_data: The user data passed to @callback
+ *
+ * Looks up completions for the current preedit and before text in a
+ * worker thread using the completer's `lookup` vfunc. The current
+ * preedit and before text are copied so the completer can continue
+ * to process symbols while the lookup is running. @callback is
+ * invoked in the current thread default main context.
+ *
+ * Callers usually cancel @cancellable of the previous lookup when
+ * starting a new one so queued lookups for outdated input never run.
+ *
+ * If the completer has a cache (see [method@Completer.set_cache]) the
+ * lookup is served from it when possible and results are added to it.
+ */
+void
+pos_completer_lookup_async (PosCompleter        *self,
+                            GCancellable        *cancellable,
+                            GAsyncReadyCallback  callback,
+                            gpointer             user_data)
+{
+  PosCompleterInterface *iface;
+  PosCompleterLookupData *data;
+  PosCompletionCache *cache;
+  g_autoptr (GTask) task = NULL;
+
+  g_return_if_fail (POS_IS_COMPLETER (self));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  iface = POS_COMPLETER_GET_IFACE (self);
+  g_return_if_fail (iface->lookup != NULL);
+
+  data = g_new0 (PosCompleterLookupData, 1);
+  data->before_text = g_strdup (pos_completer_get_before_text (self));
+  data->preedit = g_strdup (pos_completer_get_preedit (self));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, pos_completer_lookup_async);
+  g_task_set_name (task, "pos-completer-lookup");
+  g_task_set_task_data (task, data, (GDestroyNotify)pos_completer_lookup_data_free);
+
+  cache = g_object_get_data (G_OBJECT (self), "pos-completion-cache");
+  if (cache) {
+    GStrv completions = NULL;
+
+    data->cache_key = build_cache_key (self, data->before_text, data->preedit);
+    if (pos_completion_cache_lookup (cache, data->cache_key, &completions)) {
+      data->cached = TRUE;
+      g_task_return_pointer (task, completions, (GDestroyNotify)g_strfreev);
+      return;
+    }
+  }
+
+  g_task_run_in_thread (task, lookup_thread);
+}
+
+/**
+ * pos_completer_lookup_finish:
+ * @self: The completer
+ * @res: The async result
+ * @error: The error location
+ *
+ * Finishes a lookup started with [method@Completer.lookup_async].
+ *
+ * If the preedit or before text changed while the lookup was running
+ * the result is stale. It is then dropped and a %G_IO_ERROR_CANCELLED
+ * error is returned.
+ *
+ * Returns:(transfer full)(nullable): The completions
+ */
+GStrv
+pos_completer_lookup_finish (PosCompleter  *self,
+                             GAsyncResult  *res,
+                             GError       **error)
+{
+  PosCompleterLookupData *data;
+  PosCompletionCache *cache;
+  g_auto (GStrv) completions = NULL;
+  g_autoptr (GError) local_err = NULL;
+
+  g_return_val_if_fail (POS_IS_COMPLETER (self), NULL);
+  g_return_val_if_fail (g_task_is_valid (res, self), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (res)) == pos_completer_lookup_async, NULL);
+
+  completions = g_task_propagate_pointer (G_TASK (res), &local_err);
+  if (local_err) {
+    g_propagate_error (error, g_steal_pointer (&local_err));
+    return NULL;
+  }
+
+  data = g_task_get_task_data (G_TASK (res));
+  cache = g_object_get_data (G_OBJECT (self), "pos-completion-cache");
+  /* Even stale results are valid for their input */
+  if (cache && data->cache_key && !data->cached)
+    pos_completion_cache_insert (cache, data->cache_key, (const char * const *)completions);
+
+  if (g_strcmp0 (data->preedit, pos_completer_get_preedit (self)) ||
+      g_strcmp0 (data->before_text, pos_completer_get_before_text (self))) {
+    g_debug ("Dropping stale completions for '%s'", data->preedit);
+    g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_CANCELLED, "Input changed");
+    return NULL;
+  }
+
+  return g_steal_pointer (&completions);
+}
+
+/**
+ * pos_completer_lookup_cached:
+ * @self: The completer
+ * @preedit: The preedit
+ * @completions:(out)(transfer full)(nullable): The cached completions
+ *
+ * Looks up completions for @preedit and the current before text in
+ * the completer's cache. This is for completers that don't use
+ * [method@Completer.lookup_async].
+ *
+ * Returns: %TRUE if completions were found in the cache
+ */
+gboolean
+pos_completer_lookup_cached (PosCompleter *self, const char *preedit, GStrv *completions)
+{
+  PosCompletionCache *cache;
+  g_autofree char *key = NULL;
+
+  g_return_val_if_fail (POS_IS_COMPLETER (self), FALSE);
+
+  cache = g_object_get_data (G_OBJECT (self), "pos-completion-cache");
+  if (cache == NULL)
+    return FALSE;
+
+  key = build_cache_key (self, pos_completer_get_before_text (self), preedit);
+  return pos_completion_cache_lookup (cache, key, completions);
+}
+
+/**
+ * pos_completer_cache_completions:
+ * @self: The completer
+ * @preedit: The preedit
+ * @completions:(nullable): The completions for @preedit
+ *
+ * Stores @completions for @preedit and the current before text in
+ * the completer's cache.
+ */
+void
+pos_completer_cache_completions (PosCompleter *self, const char *preedit, GStrv completions)
+{
+  PosCompletionCache *cache;
+  g_autofree char *key = NULL;
+
+  g_return_if_fail (POS_IS_COMPLETER (self));
+
+  cache = g_object_get_data (G_OBJECT (self), "pos-completion-cache");
+  if (cache == NULL)
     return;
 
-  return iface->learn_accepted (self, word);
+  key = build_cache_key (self, pos_completer_get_before_text (self), preedit);
+  pos_completion_cache_insert (cache, key, (const char * const *)completions);
 }
 
 /**
@@ -471,26 +840,14 @@ pos_completer_learn_accepted (PosCompleter *self, const char *word)
 gboolean
 pos_completer_symbol_is_word_separator (const char *symbol, gboolean *is_ws)
 {
-  static int nl = -1;
-
-  if (nl < 0) {
-    for (nl = 0; completion_end_symbols[nl]; nl++) {
-      if (!isspace (completion_end_symbols[nl][0]))
-        break;
-    }
-  }
   if (is_ws != NULL)
     *is_ws = FALSE;
 
-  /* TODO: use hash table - or rather just use isalnum? */
-  for (int i = 0; completion_end_symbols[i]; i++) {
-    if (strcmp (symbol, completion_end_symbols[i]) == 0) {
-      if (i < nl && is_ws != NULL)
-        *is_ws = TRUE;
-      return TRUE;
-    }
-  }
-  return FALSE;
+  /* Separators are single characters */
+  if (STR_IS_NULL_OR_EMPTY (symbol) || *g_utf8_next_char (symbol) != '\0')
+    return FALSE;
+
+  return pos_word_boundary_is_separator (g_utf8_get_char (symbol), is_ws);
 }
 
 /**
@@ -508,8 +865,7 @@ pos_completer_symbol_is_word_separator (const char *symbol, gboolean *is_ws)
 gboolean
 pos_completer_grab_last_word (const char *text, char **new_text, char **word)
 {
-  gsize len;
-  g_autofree char *symbol = NULL;
+  gsize len, start;
 
   g_return_val_if_fail (new_text && *new_text == NULL, FALSE);
   g_return_val_if_fail (word && *word == NULL, FALSE);
@@ -518,27 +874,22 @@ pos_completer_grab_last_word (const char *text, char **new_text, char **word)
   if (STR_IS_NULL_OR_EMPTY (text))
     return FALSE;
 
+  len = strlen (text);
+  start = pos_word_boundary_find_start (text, len);
+
   /* text ends with whitespace */
-  len = g_utf8_strlen (text, -1);
-  symbol = g_utf8_substring (text, len-1, len);
-  if (pos_completer_symbol_is_word_separator (symbol, NULL))
+  if (start == len)
     return FALSE;
 
-  /* Get last word in text */
-  for (glong start = len - 1; start >= 0; start--) {
-    g_free (symbol);
-    symbol = g_utf8_substring (text, start, start+1);
-
-    if (pos_completer_symbol_is_word_separator (symbol, NULL)) {
-      *word = g_strdup (g_utf8_offset_to_pointer (text, start+1));
-      *new_text = g_utf8_substring (text, 0, start+1);
-      return TRUE;
-    }
+  /* No whitespace in text */
+  if (start == 0) {
+    *new_text = NULL;
+    *word = g_strdup (text);
+    return TRUE;
   }
 
-  /* No whitespace in text */
-  *new_text = NULL;
-  *word = g_strdup (text);
+  *word = g_strdup (&text[start]);
+  *new_text = g_strndup (text, start);
 
   return TRUE;
 }
@@ -604,3 +955,236 @@ pos_completer_capitalize_by_template (const char *template, const GStrv completi
 
   return g_strv_builder_end (builder);
 }
+
+
+/* Higher scores first, then the engine's original order */
+static int
+compare_scored_candidates (const PosCompleterScoredCandidate *a,
+                           const PosCompleterScoredCandidate *b)
+{
+  if (a->score != b->score)
+    return b->score - a->score;
+
+  return (a->rank > b->rank) - (a->rank < b->rank);
+}
+
+
+PosCompleterRefiner *
+pos_completer_refiner_new (void)
+{
+  PosCompleterRefiner *self = g_new0 (PosCompleterRefiner, 1);
+
+  self->candidates = g_ptr_array_new_with_free_func (g_free);
+  self->ranks = g_array_new (FALSE, FALSE, sizeof (guint));
+  self->compare_func = compare_scored_candidates;
+
+  return self;
+}
+
+
+void
+pos_completer_refiner_free (PosCompleterRefiner *self)
+{
+  g_return_if_fail (self);
+
+  g_free (self->query);
+  g_ptr_array_unref (self->candidates);
+  g_array_unref (self->ranks);
+  g_free (self);
+}
+
+/**
+ * pos_completer_refiner_reset:
+ * @self: The refiner
+ *
+ * Drops the stored candidates so the next query is a full one. Use
+ * when the preedit is reset or set from the outside.
+ */
+void
+pos_completer_refiner_reset (PosCompleterRefiner *self)
+{
+  g_return_if_fail (self);
+
+  g_clear_pointer (&self->query, g_free);
+  g_ptr_array_set_size (self->candidates, 0);
+  g_array_set_size (self->ranks, 0);
+  self->complete = FALSE;
+}
+
+/**
+ * pos_completer_refiner_set_candidates:
+ * @self: The refiner
+ * @query: The query that resulted in @candidates
+ * @candidates:(transfer full)(nullable): The candidates, best first
+ * @complete: Whether @candidates holds all matches for @query
+ *
+ * Stores the result of a full query. Each candidate's rank is its
+ * position in @candidates.
+ */
+void
+pos_completer_refiner_set_candidates (PosCompleterRefiner *self,
+                                      const char          *query,
+                                      GStrv                candidates,
+                                      gboolean             complete)
+{
+  pos_completer_refiner_set_candidates_full (self, query, candidates, NULL, complete);
+}
+
+/**
+ * pos_completer_refiner_set_candidates_full:
+ * @self: The refiner
+ * @query: The query that resulted in @candidates
+ * @candidates:(transfer full)(nullable): The candidates, best first
+ * @ranks:(nullable): The rank of each candidate
+ * @complete: Whether @candidates holds all matches for @query
+ *
+ * Like [method@CompleterRefiner.set_candidates] but allows to pass
+ * the rank the engine uses to order otherwise equal candidates
+ * (e.g. their position in the word list). The ranks are passed
+ * to the compare function (see
+ * [method@CompleterRefiner.set_compare_func]) when refining.
+ */
+void
+pos_completer_refiner_set_candidates_full (PosCompleterRefiner *self,
+                                           const char          *query,
+                                           GStrv                candidates,
+                                           const guint         *ranks,
+                                           gboolean             complete)
+{
+  g_return_if_fail (self);
+
+  pos_completer_refiner_reset (self);
+
+  self->query = g_strdup (query);
+  self->complete = complete;
+  for (guint i = 0; candidates && candidates[i]; i++) {
+    guint rank = ranks ? ranks[i] : i;
+
+    g_ptr_array_add (self->candidates, candidates[i]);
+    g_array_append_val (self->ranks, rank);
+  }
+
+  /* We took the strings */
+  g_free (candidates);
+}
+
+/**
+ * pos_completer_refiner_set_compare_func:
+ * @self: The refiner
+ * @compare_func:(nullable): The function to order refined candidates
+ *
+ * Sets the function used to order the candidates when refining. It
+ * should order candidates like the engine orders a full query's result
+ * so refining and querying give the same order. The default orders by
+ * score and then by rank.
+ */
+void
+pos_completer_refiner_set_compare_func (PosCompleterRefiner     *self,
+                                        PosCompleterCompareFunc  compare_func)
+{
+  g_return_if_fail (self);
+
+  self->compare_func = compare_func ?: compare_scored_candidates;
+}
+
+
+/**
+ * pos_completer_refiner_refine:
+ * @self: The refiner
+ * @query: The new query
+ * @match_func: Function to check and score the stored candidates
+ * @user_data: The user data passed to @match_func
+ *
+ * If @query extends the query of the stored candidates (i.e. characters
+ * got appended to the preedit) and the stored candidates are complete
+ * they are filtered and reordered by @match_func and %TRUE is returned.
+ * Otherwise (e.g. after a backspace or reset) %FALSE is returned and the
+ * caller needs to perform a full query and use
+ * [method@CompleterRefiner.set_candidates].
+ *
+ * Returns: %TRUE if the candidates got refined
+ */
+gboolean
+pos_completer_refiner_refine (PosCompleterRefiner   *self,
+                              const char            *query,
+                              PosCompleterMatchFunc  match_func,
+                              gpointer               user_data)
+{
+  g_autoptr (GArray) scored = NULL;
+  g_autoptr (GPtrArray) refined = NULL;
+  g_autoptr (GArray) ranks = NULL;
+
+  g_return_val_if_fail (self, FALSE);
+  g_return_val_if_fail (match_func, FALSE);
+
+  if (self->query == NULL || !self->complete || query == NULL)
+    return FALSE;
+
+  if (strlen (query) <= strlen (self->query) || !g_str_has_prefix (query, self->query))
+    return FALSE;
+
+  scored = g_array_sized_new (FALSE, FALSE, sizeof (PosCompleterScoredCandidate),
+                              self->candidates->len);
+  for (guint i = 0; i < self->candidates->len; i++) {
+    PosCompleterScoredCandidate c;
+
+    c.candidate = g_ptr_array_index (self->candidates, i);
+    c.rank = g_array_index (self->ranks, guint, i);
+    c.score = match_func (query, c.candidate, user_data);
+    if (c.score < 0)
+      continue;
+
+    g_array_append_val (scored, c);
+  }
+
+  /* Ranks are unique so the order doesn't depend on the sort's stability */
+  g_array_sort (scored, (GCompareFunc)self->compare_func);
+
+  g_debug ("Refined %u candidates for '%s' to %u for '%s'",
+           self->candidates->len, self->query, scored->len, query);
+
+  /* Matches for the longer query are a subset so we're still complete */
+  refined = g_ptr_array_new_full (scored->len, g_free);
+  ranks = g_array_sized_new (FALSE, FALSE, sizeof (guint), scored->len);
+  for (guint i = 0; i < scored->len; i++) {
+    PosCompleterScoredCandidate *c = &g_array_index (scored, PosCompleterScoredCandidate, i);
+
+    g_ptr_array_add (refined, g_strdup (c->candidate));
+    g_array_append_val (ranks, c->rank);
+  }
+  g_ptr_array_unref (self->candidates);
+  self->candidates = g_steal_pointer (&refined);
+  g_array_unref (self->ranks);
+  self->ranks = g_steal_pointer (&ranks);
+
+  g_free (self->query);
+  self->query = g_strdup (query);
+
+  return TRUE;
+}
+
+/**
+ * pos_completer_refiner_get_completions:
+ * @self: The refiner
+ * @max_completions: The maximum number of completions to return
+ *
+ * Returns:(transfer full)(nullable): The best candidates
+ */
+GStrv
+pos_completer_refiner_get_completions (PosCompleterRefiner *self, guint max_completions)
+{
+  GStrv completions;
+  guint n;
+
+  g_return_val_if_fail (self, NULL);
+
+  n = MIN (max_completions, self->candidates->len);
+  if (n == 0)
+    return NULL;
+
+  completions = g_new0 (char *, n + 1);
+  for (guint i = 0; i < n; i++)
+    completions[i] = g_strdup (g_ptr_array_index (self->candidates, i));
+
+  return completions;
+}
@@ -6,7 +6,9 @@
 
 #pragma once
 
-#include <glib-object.h>
+#include "pos-completion-cache.h"
+
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
@@ -58,6 +60,15 @@ struct _PosCompleterInterface
                                   GError       **error);
   char *         (*get_display_name) (PosCompleter *self);
   void           (*learn_accepted) (PosCompleter *self, const char *word);
+  GStrv          (*lookup)       (PosCompleter  *self,
+                                  const char    *before_text,
+                                  const char    *preedit,
+                                  GCancellable  *cancellable,
+                                  GError       **error);
+  gboolean       (*is_loading)   (PosCompleter  *self);
+  void           (*update_surrounding_text) (PosCompleter *self,
+                                             const char   *text,
+                                             guint         cursor);
 };
 
 /* Used by completion users */
@@ -71,12 +82,24 @@ const char    *pos_completer_get_after_text (PosCompleter *self);
 void           pos_completer_set_surrounding_text (PosCompleter *self,
                                                    const char *before_text,
                                                    const char *after_text);
+void           pos_completer_update_surrounding_text (PosCompleter *self,
+                                                      const char   *text,
+                                                      guint         cursor);
 gboolean       pos_completer_set_language (PosCompleter  *self,
                                            const char    *lang,
                                            const char    *region,
                                            GError       **error);
 char          *pos_completer_get_display_name (PosCompleter *self);
 void           pos_completer_learn_accepted (PosCompleter *self, const char *word);
+void           pos_completer_set_cache (PosCompleter *self, PosCompletionCache *cache);
+gboolean       pos_completer_is_loading (PosCompleter *self);
+void           pos_completer_lookup_async (PosCompleter        *self,
+                                           GCancellable        *cancellable,
+                                           GAsyncReadyCallback  callback,
+                                           gpointer             user_data);
+GStrv          pos_completer_lookup_finish (PosCompleter  *self,
+                                            GAsyncResult  *res,
+                                            GError       **error);
 
 GStrv          pos_completer_capitalize_by_template (const char *template,
                                                      const GStrv completions);
@@ -12,6 +12,8 @@
 
 #include "pos-completion-bar.h"
 
+#include <glib/gi18n-lib.h>
+
 enum {
   SELECTED,
   N_SIGNALS
@@ -23,20 +25,42 @@ static guint signals[N_SIGNALS];
  *
  * A button bar that displays completions and emits "selected" if one
  * is picked.
+ *
+ * Completions change on every key press so the buttons are kept in a
+ * pool and only relabeled. Buttons not needed for the current
+ * completions are hidden.
  */
 struct _PosCompletionBar {
   GtkBox                parent;
 
   GtkWidget            *buttons;
+  GPtrArray            *pool;
+  GtkWidget            *loading_label;
+  GStrv                 completions;
 };
 G_DEFINE_TYPE (PosCompletionBar, pos_completion_bar, GTK_TYPE_BOX)
 
 
+static void
+pos_completion_bar_finalize (GObject *object)
+{
+  PosCompletionBar *self = POS_COMPLETION_BAR (object);
+
+  g_clear_pointer (&self->pool, g_ptr_array_unref);
+  g_clear_pointer (&self->completions, g_strfreev);
+
+  G_OBJECT_CLASS (pos_completion_bar_parent_class)->finalize (object);
+}
+
+
 static void
 pos_completion_bar_class_init (PosCompletionBarClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
+  object_class->finalize = pos_completion_bar_finalize;
+
   signals[SELECTED] = g_signal_new ("selected",
                                     G_TYPE_FROM_CLASS (klass),
                                     G_SIGNAL_RUN_LAST,
@@ -57,6 +81,9 @@ static void
 pos_completion_bar_init (PosCompletionBar *self)
 {
   gtk_widget_init_template (GTK_WIDGET (self));
+
+  /* The container owns the buttons */
+  self->pool = g_ptr_array_new ();
 }
 
 
@@ -75,38 +102,98 @@ on_button_clicked (PosCompletionBar *self, GtkButton *btn)
   g_assert (POS_IS_COMPLETION_BAR (self));
   g_assert (GTK_IS_BUTTON (btn));
 
-  completion = g_object_get_data (G_OBJECT (btn), "pos-text");
+  completion = gtk_label_get_label (GTK_LABEL (gtk_bin_get_child (GTK_BIN (btn))));
   g_assert (completion != NULL);
 
   g_signal_emit (self, signals[SELECTED], 0, completion);
 }
 
 
+static GtkWidget *
+pos_completion_bar_get_button (PosCompletionBar *self, guint index)
+{
+  GtkWidget *lbl, *btn;
+
+  if (index < self->pool->len)
+    return g_ptr_array_index (self->pool, index);
+
+  lbl = g_object_new (GTK_TYPE_LABEL,
+                      "ellipsize", PANGO_ELLIPSIZE_MIDDLE,
+                      "visible", TRUE,
+                      NULL);
+  btn = g_object_new (GTK_TYPE_BUTTON,
+                      "child", lbl,
+                      NULL);
+  g_signal_connect_swapped (btn, "clicked", G_CALLBACK (on_button_clicked), self);
+  gtk_container_add (GTK_CONTAINER (self->buttons), btn);
+  g_ptr_array_add (self->pool, btn);
+
+  return btn;
+}
+
+
 void
 pos_completion_bar_set_completions (PosCompletionBar *self, GStrv completions)
 {
-  g_return_if_fail (POS_IS_COMPLETION_BAR (self));
+  guint n_completions;
 
-  gtk_container_foreach (GTK_CONTAINER (self->buttons), (GtkCallback) gtk_widget_destroy, NULL);
+  g_return_if_fail (POS_IS_COMPLETION_BAR (self));
 
-  if (completions == NULL)
+  if (self->completions && completions &&
+      g_strv_equal ((const char * const *)self->completions, (const char * const *)completions)) {
     return;
+  }
+  if (self->completions == NULL && completions == NULL &&
+      (self->loading_label == NULL || !gtk_widget_get_visible (self->loading_label))) {
+    return;
+  }
+
+  g_strfreev (self->completions);
+  self->completions = g_strdupv (completions);
+
+  if (self->loading_label)
+    gtk_widget_hide (self->loading_label);
+
+  n_completions = completions ? g_strv_length (completions) : 0;
+  for (guint i = 0; i < n_completions; i++) {
+    GtkWidget *btn = pos_completion_bar_get_button (self, i);
+    GtkLabel *lbl = GTK_LABEL (gtk_bin_get_child (GTK_BIN (btn)));
+
+    if (g_strcmp0 (gtk_label_get_label (lbl), completions[i]))
+      gtk_label_set_label (lbl, completions[i]);
+    gtk_widget_show (btn);
+  }
+
+  for (guint i = n_completions; i < self->pool->len; i++)
+    gtk_widget_hide (g_ptr_array_index (self->pool, i));
+}
+
+
+/**
+ * pos_completion_bar_set_loading:
+ * @self: The completion bar
+ *
+ * Shows a placeholder instead of completions while the completer is
+ * loading. The placeholder is removed by the next call to
+ * [method@CompletionBar.set_completions].
+ */
+void
+pos_completion_bar_set_loading (PosCompletionBar *self)
+{
+  g_return_if_fail (POS_IS_COMPLETION_BAR (self));
 
-  for (int i = 0; i < g_strv_length (completions); i++) {
-    GtkWidget *lbl, *btn;
-
-    lbl = g_object_new (GTK_TYPE_LABEL,
-                        "label", completions[i],
-                        "ellipsize", PANGO_ELLIPSIZE_MIDDLE,
-                        "visible", TRUE,
-                        NULL);
-    btn = g_object_new (GTK_TYPE_BUTTON,
-                        "child", lbl,
-                        "visible", TRUE,
-                        NULL);
-    g_object_set_data_full (G_OBJECT (btn), "pos-text", g_strdup (completions[i]), g_free);
-
-    g_signal_connect_swapped (btn, "clicked", G_CALLBACK (on_button_clicked), self);
-    gtk_container_add (GTK_CONTAINER (self->buttons), btn);
+  g_clear_pointer (&self->completions, g_strfreev);
+  for (guint i = 0; i < self->pool->len; i++)
+    gtk_widget_hide (g_ptr_array_index (self->pool, i));
+
+  if (self->loading_label == NULL) {
+    self->loading_label = g_object_new (GTK_TYPE_LABEL,
+                                        "label", _("Loading dictionary…"),
+                                        "ellipsize", PANGO_ELLIPSIZE_END,
+                                        "sensitive", FALSE,
+                                        NULL);
+    gtk_style_context_add_class (gtk_widget_get_style_context (self->loading_label), "dim-label");
+    gtk_container_add (GTK_CONTAINER (self->buttons), self->loading_label);
   }
+  gtk_widget_show (self->loading_label);
 }
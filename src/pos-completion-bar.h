@@ -17,6 +17,7 @@ G_DECLARE_FINAL_TYPE (PosCompletionBar, pos_completion_bar, POS, COMPLETION_BAR,
 PosCompletionBar *pos_completion_bar_new (void);
 void              pos_completion_bar_set_completions (PosCompletionBar *self,
                                                       GStrv             completions);
+void              pos_completion_bar_set_loading     (PosCompletionBar *self);
 
 G_END_DECLS
 
@@ -0,0 +1,375 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "pos-completion-cache"
+
+#include "pos-config.h"
+
+#include "pos-completion-cache.h"
+
+#include <string.h>
+
+/**
+ * PosCompletionCache:
+ *
+ * A memory bounded least recently used cache of completions.
+ *
+ * Completers look up completions for the same input over and over
+ * again (e.g. when deleting and retyping a character) so remember
+ * the results of recent lookups. Entries are keyed by an opaque
+ * string built by the caller. When the size of the stored entries
+ * exceeds the configured limit the least recently used entries are
+ * evicted.
+ *
+ * The cache is not thread safe and is meant to be used from the main
+ * thread only.
+ */
+
+enum {
+  PROP_0,
+  PROP_MAX_SIZE,
+  PROP_HITS,
+  PROP_MISSES,
+  PROP_LAST_PROP
+};
+static GParamSpec *props[PROP_LAST_PROP];
+
+typedef struct {
+  char  *key;
+  GStrv  completions;
+  gsize  size;
+} PosCompletionCacheEntry;
+
+struct _PosCompletionCache {
+  GObject     parent;
+
+  GHashTable *entries; /* key: cache key, value: GList link in lru */
+  GQueue      lru;     /* of PosCompletionCacheEntry, most recently used first */
+  gsize       size;
+  gsize       max_size;
+
+  guint       hits;
+  guint       misses;
+};
+G_DEFINE_TYPE (PosCompletionCache, pos_completion_cache, G_TYPE_OBJECT)
+
+
+static void
+pos_completion_cache_entry_free (PosCompletionCacheEntry *entry)
+{
+  g_free (entry->key);
+  g_strfreev (entry->completions);
+  g_free (entry);
+}
+
+
+static gsize
+entry_size (const char *key, const char * const *completions)
+{
+  gsize size = sizeof (PosCompletionCacheEntry) + strlen (key) + 1 + sizeof (char *);
+
+  for (int i = 0; completions && completions[i]; i++)
+    size += sizeof (char *) + strlen (completions[i]) + 1;
+
+  return size;
+}
+
+
+static void
+remove_link (PosCompletionCache *self, GList *link)
+{
+  PosCompletionCacheEntry *entry = link->data;
+
+  g_hash_table_remove (self->entries, entry->key);
+  g_queue_unlink (&self->lru, link);
+  self->size -= entry->size;
+
+  pos_completion_cache_entry_free (entry);
+  g_list_free_1 (link);
+}
+
+
+static void
+evict (PosCompletionCache *self)
+{
+  while (self->size > self->max_size && self->lru.tail)
+    remove_link (self, self->lru.tail);
+}
+
+
+static void
+pos_completion_cache_set_property (GObject      *object,
+                                   guint         property_id,
+                                   const GValue *value,
+                                   GParamSpec   *pspec)
+{
+  PosCompletionCache *self = POS_COMPLETION_CACHE (object);
+
+  switch (property_id) {
+  case PROP_MAX_SIZE:
+    self->max_size = g_value_get_uint64 (value);
+    evict (self);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    break;
+  }
+}
+
+
+static void
+pos_completion_cache_get_property (GObject    *object,
+                                   guint       property_id,
+                                   GValue     *value,
+                                   GParamSpec *pspec)
+{
+  PosCompletionCache *self = POS_COMPLETION_CACHE (object);
+
+  switch (property_id) {
+  case PROP_MAX_SIZE:
+    g_value_set_uint64 (value, self->max_size);
+    break;
+  case PROP_HITS:
+    g_value_set_uint (value, self->hits);
+    break;
+  case PROP_MISSES:
+    g_value_set_uint (value, self->misses);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    break;
+  }
+}
+
+
+static void
+pos_completion_cache_finalize (GObject *object)
+{
+  PosCompletionCache *self = POS_COMPLETION_CACHE (object);
+
+  g_debug ("Completion cache: %u hits, %u misses", self->hits, self->misses);
+
+  pos_completion_cache_clear (self);
+  g_hash_table_destroy (self->entries);
+
+  G_OBJECT_CLASS (pos_completion_cache_parent_class)->finalize (object);
+}
+
+
+static void
+pos_completion_cache_class_init (PosCompletionCacheClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->get_property = pos_completion_cache_get_property;
+  object_class->set_property = pos_completion_cache_set_property;
+  object_class->finalize = pos_completion_cache_finalize;
+
+  /**
+   * PosCompletionCache:max-size:
+   *
+   * The approximate maximum memory in bytes used by the cached entries.
+   */
+  props[PROP_MAX_SIZE] =
+    g_param_spec_uint64 ("max-size", "", "",
+                         0, G_MAXUINT64, 0,
+                         G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS);
+  /**
+   * PosCompletionCache:hits:
+   *
+   * The number of lookups that could be served from the cache.
+   */
+  props[PROP_HITS] =
+    g_param_spec_uint ("hits", "", "",
+                       0, G_MAXUINT, 0,
+                       G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+  /**
+   * PosCompletionCache:misses:
+   *
+   * The number of lookups that couldn't be served from the cache.
+   */
+  props[PROP_MISSES] =
+    g_param_spec_uint ("misses", "", "",
+                       0, G_MAXUINT, 0,
+                       G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (object_class, PROP_LAST_PROP, props);
+}
+
+
+static void
+pos_completion_cache_init (PosCompletionCache *self)
+{
+  self->entries = g_hash_table_new (g_str_hash, g_str_equal);
+  g_queue_init (&self->lru);
+}
+
+/**
+ * pos_completion_cache_new:
+ * @max_size: The approximate maximum memory used by the entries in bytes
+ *
+ * Returns:(transfer full): A new completion cache
+ */
+PosCompletionCache *
+pos_completion_cache_new (gsize max_size)
+{
+  return g_object_new (POS_TYPE_COMPLETION_CACHE, "max-size", (guint64)max_size, NULL);
+}
+
+/**
+ * pos_completion_cache_lookup:
+ * @self: The completion cache
+ * @key: The key to look up
+ * @completions:(out)(transfer full)(nullable): The cached completions
+ *
+ * Looks up the completions stored for @key and marks the entry as
+ * recently used. An empty result is returned as %NULL completions.
+ *
+ * Returns: %TRUE if @key was found in the cache
+ */
+gboolean
+pos_completion_cache_lookup (PosCompletionCache *self, const char *key, GStrv *completions)
+{
+  PosCompletionCacheEntry *entry;
+  GList *link;
+
+  g_return_val_if_fail (POS_IS_COMPLETION_CACHE (self), FALSE);
+  g_return_val_if_fail (key, FALSE);
+  g_return_val_if_fail (completions && *completions == NULL, FALSE);
+
+  link = g_hash_table_lookup (self->entries, key);
+  if (link == NULL) {
+    self->misses++;
+    g_object_notify_by_pspec (G_OBJECT (self), props[PROP_MISSES]);
+    return FALSE;
+  }
+
+  g_queue_unlink (&self->lru, link);
+  g_queue_push_head_link (&self->lru, link);
+
+  entry = link->data;
+  *completions = g_strdupv (entry->completions);
+
+  self->hits++;
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_HITS]);
+  return TRUE;
+}
+
+/**
+ * pos_completion_cache_insert:
+ * @self: The completion cache
+ * @key: The key
+ * @completions:(nullable): The completions to store for @key
+ *
+ * Stores @completions for @key replacing any previous entry. This
+ * might evict the least recently used entries.
+ */
+void
+pos_completion_cache_insert (PosCompletionCache *self,
+                             const char         *key,
+                             const char * const *completions)
+{
+  PosCompletionCacheEntry *entry;
+  GList *link;
+  gsize size;
+
+  g_return_if_fail (POS_IS_COMPLETION_CACHE (self));
+  g_return_if_fail (key);
+
+  link = g_hash_table_lookup (self->entries, key);
+  if (link)
+    remove_link (self, link);
+
+  size = entry_size (key, completions);
+  if (size > self->max_size)
+    return;
+
+  entry = g_new0 (PosCompletionCacheEntry, 1);
+  entry->key = g_strdup (key);
+  entry->completions = g_strdupv ((GStrv)completions);
+  entry->size = size;
+
+  g_queue_push_head (&self->lru, entry);
+  g_hash_table_insert (self->entries, entry->key, self->lru.head);
+  self->size += size;
+
+  evict (self);
+}
+
+/**
+ * pos_completion_cache_invalidate:
+ * @self: The completion cache
+ * @prefix: The key prefix
+ *
+ * Drops all entries with keys starting with @prefix. This can be used
+ * to invalidate all entries of a completer.
+ */
+void
+pos_completion_cache_invalidate (PosCompletionCache *self, const char *prefix)
+{
+  GList *link;
+
+  g_return_if_fail (POS_IS_COMPLETION_CACHE (self));
+  g_return_if_fail (prefix);
+
+  link = self->lru.head;
+  while (link) {
+    GList *next = link->next;
+    PosCompletionCacheEntry *entry = link->data;
+
+    if (g_str_has_prefix (entry->key, prefix))
+      remove_link (self, link);
+
+    link = next;
+  }
+}
+
+/**
+ * pos_completion_cache_clear:
+ * @self: The completion cache
+ *
+ * Drops all entries.
+ */
+void
+pos_completion_cache_clear (PosCompletionCache *self)
+{
+  g_return_if_fail (POS_IS_COMPLETION_CACHE (self));
+
+  while (self->lru.head)
+    remove_link (self, self->lru.head);
+}
+
+
+guint
+pos_completion_cache_get_hits (PosCompletionCache *self)
+{
+  g_return_val_if_fail (POS_IS_COMPLETION_CACHE (self), 0);
+
+  return self->hits;
+}
+
+
+guint
+pos_completion_cache_get_misses (PosCompletionCache *self)
+{
+  g_return_val_if_fail (POS_IS_COMPLETION_CACHE (self), 0);
+
+  return self->misses;
+}
+
+/**
+ * pos_completion_cache_get_size:
+ * @self: The completion cache
+ *
+ * Returns: The approximate memory used by the stored entries in bytes
+ */
+gsize
+pos_completion_cache_get_size (PosCompletionCache *self)
+{
+  g_return_val_if_fail (POS_IS_COMPLETION_CACHE (self), 0);
+
+  return self->size;
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define POS_TYPE_COMPLETION_CACHE (pos_completion_cache_get_type ())
+
+G_DECLARE_FINAL_TYPE (PosCompletionCache, pos_completion_cache, POS, COMPLETION_CACHE, GObject)
+
+PosCompletionCache *pos_completion_cache_new        (gsize               max_size);
+gboolean            pos_completion_cache_lookup     (PosCompletionCache *self,
+                                                     const char         *key,
+                                                     GStrv              *completions);
+void                pos_completion_cache_insert     (PosCompletionCache *self,
+                                                     const char         *key,
+                                                     const char * const *completions);
+void                pos_completion_cache_invalidate (PosCompletionCache *self,
+                                                     const char         *prefix);
+void                pos_completion_cache_clear      (PosCompletionCache *self);
+guint               pos_completion_cache_get_hits   (PosCompletionCache *self);
+guint               pos_completion_cache_get_misses (PosCompletionCache *self);
+gsize               pos_completion_cache_get_size   (PosCompletionCache *self);
+
+G_END_DECLS
@@ -0,0 +1,809 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "pos-emoji-grid"
+
+#include "pos-config.h"
+
+#include "pos-emoji-grid.h"
+
+/* Space between a section and its separator */
+#define SECTION_SPACE 6
+#define CELL_PADDING 6
+#define GLYPH_CACHE_MAX 512
+#define DEFAULT_ROWS 4
+
+enum {
+  EMOJI_ACTIVATED,
+  EMOJI_LONG_PRESSED,
+  N_SIGNALS
+};
+static guint signals[N_SIGNALS];
+
+/*
+ * A section holds the indices of all emojis of a group that can be
+ * rendered by the current font. Items are laid out column by column
+ * so @x and @width depend on the number of rows.
+ */
+typedef struct {
+  int     group;
+  GArray *items;
+  int     x;
+  int     width;
+} PosEmojiGridSection;
+
+/**
+ * PosEmojiGrid:
+ *
+ * Renders the emojis of the emoji data in sections of columns. Only
+ * indices into the (mapped) emoji data are kept. Glyphs are shaped
+ * when they scroll into view, so there's no per emoji widget.
+ */
+struct _PosEmojiGrid {
+  GtkDrawingArea  parent;
+
+  GVariant       *data;
+  GArray         *sections;
+  guint           populate_pos;
+  guint           populate_section;
+  guint           populate_id;
+
+  int             cell_width;
+  int             cell_height;
+  int             n_rows;
+  int             emoji_max_width;
+  PangoLayout    *measure_layout;
+  /* Shaped glyphs keyed by index in the emoji data */
+  GHashTable     *glyph_cache;
+
+  GtkGesture     *multi_press;
+  GtkGesture     *long_press;
+  int             pressed;
+  gboolean        long_pressed;
+};
+G_DEFINE_TYPE (PosEmojiGrid, pos_emoji_grid, GTK_TYPE_DRAWING_AREA)
+
+
+static void
+pos_emoji_grid_section_clear (gpointer data)
+{
+  PosEmojiGridSection *section = data;
+
+  g_clear_pointer (&section->items, g_array_unref);
+}
+
+
+static int
+compare_index (gconstpointer a, gconstpointer b)
+{
+  guint32 index_a = *(const guint32 *)a;
+  guint32 index_b = *(const guint32 *)b;
+
+  return (index_a > index_b) - (index_a < index_b);
+}
+
+
+static PangoAttrList *
+get_emoji_attrs (void)
+{
+  PangoAttrList *attrs;
+
+  attrs = pango_attr_list_new ();
+  pango_attr_list_insert (attrs, pango_attr_scale_new (PANGO_SCALE_X_LARGE));
+
+  return attrs;
+}
+
+
+static PangoLayout *
+create_emoji_layout (PosEmojiGrid *self, const char *text)
+{
+  PangoLayout *layout = gtk_widget_create_pango_layout (GTK_WIDGET (self), text);
+  PangoAttrList *attrs = get_emoji_attrs ();
+
+  pango_layout_set_attributes (layout, attrs);
+  pango_attr_list_unref (attrs);
+
+  return layout;
+}
+
+
+static void
+update_metrics (PosEmojiGrid *self)
+{
+  PangoRectangle rect;
+
+  g_clear_object (&self->measure_layout);
+  g_hash_table_remove_all (self->glyph_cache);
+
+  /* Get a reasonable maximum width for an emoji. We do this to
+   * skip overly wide fallback rendering for certain emojis the
+   * font does not contain and therefore end up being rendered
+   * as multiply glyphs. */
+  self->measure_layout = create_emoji_layout (self, "🙂");
+  pango_layout_get_extents (self->measure_layout, NULL, &rect);
+  self->emoji_max_width = rect.width;
+
+  self->cell_width = PANGO_PIXELS_CEIL (rect.width) + 2 * CELL_PADDING;
+  self->cell_height = PANGO_PIXELS_CEIL (rect.height) + 2 * CELL_PADDING;
+}
+
+
+static gboolean
+emoji_fits (PosEmojiGrid *self, GVariant *item)
+{
+  PangoRectangle rect;
+  char text[64];
+
+  pos_emoji_format (item, 0, text, sizeof (text));
+  pango_layout_set_text (self->measure_layout, text, -1);
+  pango_layout_get_extents (self->measure_layout, &rect, NULL);
+
+  /* Check for fallback rendering that generates too wide items */
+  return pango_layout_get_unknown_glyphs_count (self->measure_layout) == 0 &&
+    rect.width < 1.5 * self->emoji_max_width;
+}
+
+
+static PosEmojiGridSection *
+get_section_by_group (PosEmojiGrid *self, int group)
+{
+  for (guint i = 0; i < self->sections->len; i++) {
+    PosEmojiGridSection *section = &g_array_index (self->sections, PosEmojiGridSection, i);
+
+    if (section->group == group)
+      return section;
+  }
+
+  return NULL;
+}
+
+
+static gboolean
+populate_sections (gpointer data)
+{
+  PosEmojiGrid *self = POS_EMOJI_GRID (data);
+  gsize n_items = g_variant_n_children (self->data);
+  gint64 start = g_get_monotonic_time ();
+
+  while (self->populate_pos < n_items && self->sections->len) {
+    g_autoptr (GVariant) item = g_variant_get_child_value (self->data, self->populate_pos);
+    PosEmojiGridSection *section;
+    guint group;
+
+    /* Emojis of unknown groups go into the preceding section */
+    g_variant_get_child (item, 3, "u", &group);
+    for (guint i = 0; i < self->sections->len; i++) {
+      if (g_array_index (self->sections, PosEmojiGridSection, i).group == group) {
+        self->populate_section = i;
+        break;
+      }
+    }
+    section = &g_array_index (self->sections, PosEmojiGridSection, self->populate_section);
+
+    if (emoji_fits (self, item)) {
+      guint32 index = self->populate_pos;
+
+      g_array_append_val (section->items, index);
+    }
+    self->populate_pos++;
+
+    if (g_get_monotonic_time () > start + 8000) {
+      gtk_widget_queue_resize (GTK_WIDGET (self));
+      return G_SOURCE_CONTINUE;
+    }
+  }
+
+  gtk_widget_queue_resize (GTK_WIDGET (self));
+  self->populate_id = 0;
+  return G_SOURCE_REMOVE;
+}
+
+
+static int
+get_n_rows_for_height (PosEmojiGrid *self, int height)
+{
+  return MAX (1, height / self->cell_height);
+}
+
+
+static int
+get_section_width (PosEmojiGrid *self, PosEmojiGridSection *section, int n_rows)
+{
+  int n_cols = (section->items->len + n_rows - 1) / n_rows;
+
+  return n_cols * self->cell_width;
+}
+
+
+static int
+get_separator_width (void)
+{
+  return 2 * SECTION_SPACE + 1;
+}
+
+
+/* Lays out the sections for @n_rows, returns the overall width */
+static int
+layout_sections (PosEmojiGrid *self, int n_rows, gboolean store)
+{
+  int x = 0;
+
+  for (guint i = 0; i < self->sections->len; i++) {
+    PosEmojiGridSection *section = &g_array_index (self->sections, PosEmojiGridSection, i);
+    int width;
+
+    if (section->items->len == 0)
+      continue;
+
+    if (x)
+      x += get_separator_width ();
+
+    width = get_section_width (self, section, n_rows);
+    if (store) {
+      section->x = x;
+      section->width = width;
+    }
+    x += width;
+  }
+
+  return x;
+}
+
+
+static gboolean
+is_rtl (PosEmojiGrid *self)
+{
+  return gtk_widget_get_direction (GTK_WIDGET (self)) == GTK_TEXT_DIR_RTL;
+}
+
+
+/* Flip the logical x coordinate of an area of @width in RTL */
+static int
+get_visual_x (PosEmojiGrid *self, int x, int width)
+{
+  if (!is_rtl (self))
+    return x;
+
+  return gtk_widget_get_allocated_width (GTK_WIDGET (self)) - x - width;
+}
+
+
+static void
+get_cell_area (PosEmojiGrid *self, PosEmojiGridSection *section, guint n, GdkRectangle *area)
+{
+  area->width = self->cell_width;
+  area->height = self->cell_height;
+  area->x = get_visual_x (self, section->x + (n / self->n_rows) * self->cell_width, area->width);
+  area->y = (n % self->n_rows) * self->cell_height;
+}
+
+
+/* Returns the index into the emoji data at the given position or -1 */
+static int
+get_index_at_pos (PosEmojiGrid *self, double x, double y)
+{
+  int row, col;
+
+  if (self->data == NULL || y < 0)
+    return -1;
+
+  row = y / self->cell_height;
+  if (row >= self->n_rows)
+    return -1;
+
+  if (is_rtl (self))
+    x = gtk_widget_get_allocated_width (GTK_WIDGET (self)) - x;
+
+  for (guint i = 0; i < self->sections->len; i++) {
+    PosEmojiGridSection *section = &g_array_index (self->sections, PosEmojiGridSection, i);
+    guint n;
+
+    if (section->items->len == 0 || x < section->x || x >= section->x + section->width)
+      continue;
+
+    col = (x - section->x) / self->cell_width;
+    n = col * self->n_rows + row;
+    if (n >= section->items->len)
+      return -1;
+
+    return g_array_index (section->items, guint32, n);
+  }
+
+  return -1;
+}
+
+
+static PangoLayout *
+get_glyph (PosEmojiGrid *self, guint32 index)
+{
+  g_autoptr (GVariant) item = NULL;
+  PangoLayout *layout;
+  char text[64];
+
+  layout = g_hash_table_lookup (self->glyph_cache, GUINT_TO_POINTER (index));
+  if (layout)
+    return layout;
+
+  item = g_variant_get_child_value (self->data, index);
+  pos_emoji_format (item, 0, text, sizeof (text));
+  layout = create_emoji_layout (self, text);
+  g_hash_table_insert (self->glyph_cache, GUINT_TO_POINTER (index), layout);
+
+  return layout;
+}
+
+
+static void
+render_emoji (PosEmojiGrid       *self,
+              cairo_t            *cr,
+              GtkStyleContext    *context,
+              guint32             index,
+              const GdkRectangle *area)
+{
+  PangoLayout *layout;
+  PangoRectangle extents;
+
+  if ((int)index == self->pressed) {
+    gtk_style_context_save (context);
+    gtk_style_context_add_class (context, "emoji");
+    gtk_style_context_set_state (context, GTK_STATE_FLAG_ACTIVE);
+    gtk_render_background (context, cr, area->x, area->y, area->width, area->height);
+    gtk_style_context_restore (context);
+  }
+
+  layout = get_glyph (self, index);
+  pango_layout_get_extents (layout, NULL, &extents);
+  gtk_render_layout (context, cr,
+                     area->x + (area->width - PANGO_PIXELS (extents.width)) / 2,
+                     area->y + (area->height - PANGO_PIXELS (extents.height)) / 2,
+                     layout);
+}
+
+
+static void
+render_section (PosEmojiGrid        *self,
+                cairo_t             *cr,
+                GtkStyleContext     *context,
+                PosEmojiGridSection *section,
+                const GdkRectangle  *clip)
+{
+  int first_col, last_col, n_cols, clip_start, clip_end;
+
+  /* Visible columns in logical coordinates */
+  if (is_rtl (self)) {
+    int width = gtk_widget_get_allocated_width (GTK_WIDGET (self));
+
+    clip_start = width - clip->x - clip->width;
+    clip_end = width - clip->x;
+  } else {
+    clip_start = clip->x;
+    clip_end = clip->x + clip->width;
+  }
+
+  if (section->x >= clip_end || section->x + section->width <= clip_start)
+    return;
+
+  n_cols = section->width / self->cell_width;
+  first_col = MAX (0, (clip_start - section->x) / self->cell_width);
+  last_col = MIN (n_cols - 1, (clip_end - section->x) / self->cell_width);
+
+  for (int col = first_col; col <= last_col; col++) {
+    for (int row = 0; row < self->n_rows; row++) {
+      guint n = col * self->n_rows + row;
+      GdkRectangle area;
+
+      if (n >= section->items->len)
+        return;
+
+      get_cell_area (self, section, n, &area);
+      render_emoji (self, cr, context, g_array_index (section->items, guint32, n), &area);
+    }
+  }
+}
+
+
+static gboolean
+pos_emoji_grid_draw (GtkWidget *widget, cairo_t *cr)
+{
+  PosEmojiGrid *self = POS_EMOJI_GRID (widget);
+  GtkStyleContext *context = gtk_widget_get_style_context (widget);
+  GdkRectangle clip;
+  int height = gtk_widget_get_allocated_height (widget);
+  gboolean first = TRUE;
+
+  if (self->data == NULL || !gdk_cairo_get_clip_rectangle (cr, &clip))
+    return GDK_EVENT_PROPAGATE;
+
+  /* Only glyphs that got drawn recently need to stay around */
+  if (g_hash_table_size (self->glyph_cache) > GLYPH_CACHE_MAX)
+    g_hash_table_remove_all (self->glyph_cache);
+
+  for (guint i = 0; i < self->sections->len; i++) {
+    PosEmojiGridSection *section = &g_array_index (self->sections, PosEmojiGridSection, i);
+
+    if (section->items->len == 0)
+      continue;
+
+    if (!first) {
+      int x = get_visual_x (self, section->x - SECTION_SPACE - 1, 1);
+
+      gtk_style_context_save (context);
+      gtk_style_context_add_class (context, GTK_STYLE_CLASS_SEPARATOR);
+      gtk_render_line (context, cr, x + 0.5, 0, x + 0.5, height);
+      gtk_style_context_restore (context);
+    }
+    first = FALSE;
+
+    render_section (self, cr, context, section, &clip);
+  }
+
+  return GDK_EVENT_PROPAGATE;
+}
+
+
+static GtkSizeRequestMode
+pos_emoji_grid_get_request_mode (GtkWidget *widget)
+{
+  return GTK_SIZE_REQUEST_WIDTH_FOR_HEIGHT;
+}
+
+
+static void
+pos_emoji_grid_get_preferred_width_for_height (GtkWidget *widget,
+                                               int        height,
+                                               int       *minimum,
+                                               int       *natural)
+{
+  PosEmojiGrid *self = POS_EMOJI_GRID (widget);
+  int width;
+
+  width = layout_sections (self, get_n_rows_for_height (self, height), FALSE);
+  *minimum = *natural = MAX (width, self->cell_width);
+}
+
+
+static void
+pos_emoji_grid_get_preferred_width (GtkWidget *widget, int *minimum, int *natural)
+{
+  PosEmojiGrid *self = POS_EMOJI_GRID (widget);
+
+  pos_emoji_grid_get_preferred_width_for_height (widget,
+                                                 DEFAULT_ROWS * self->cell_height,
+                                                 minimum,
+                                                 natural);
+}
+
+
+static void
+pos_emoji_grid_get_preferred_height (GtkWidget *widget, int *minimum, int *natural)
+{
+  PosEmojiGrid *self = POS_EMOJI_GRID (widget);
+
+  *minimum = self->cell_height;
+  *natural = DEFAULT_ROWS * self->cell_height;
+}
+
+
+static void
+pos_emoji_grid_size_allocate (GtkWidget *widget, GtkAllocation *allocation)
+{
+  PosEmojiGrid *self = POS_EMOJI_GRID (widget);
+
+  GTK_WIDGET_CLASS (pos_emoji_grid_parent_class)->size_allocate (widget, allocation);
+
+  self->n_rows = get_n_rows_for_height (self, allocation->height);
+  layout_sections (self, self->n_rows, TRUE);
+}
+
+
+static void
+pos_emoji_grid_style_updated (GtkWidget *widget)
+{
+  PosEmojiGrid *self = POS_EMOJI_GRID (widget);
+
+  GTK_WIDGET_CLASS (pos_emoji_grid_parent_class)->style_updated (widget);
+
+  update_metrics (self);
+  gtk_widget_queue_resize (widget);
+}
+
+
+static void
+set_pressed (PosEmojiGrid *self, int index)
+{
+  if (self->pressed == index)
+    return;
+
+  self->pressed = index;
+  gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+
+static void
+on_pressed (PosEmojiGrid *self, int n_press, double x, double y)
+{
+  self->long_pressed = FALSE;
+  set_pressed (self, get_index_at_pos (self, x, y));
+}
+
+
+static void
+on_released (PosEmojiGrid *self, int n_press, double x, double y)
+{
+  int index = get_index_at_pos (self, x, y);
+
+  if (!self->long_pressed && index >= 0 && index == self->pressed)
+    g_signal_emit (self, signals[EMOJI_ACTIVATED], 0, (guint)index);
+
+  set_pressed (self, -1);
+}
+
+
+static void
+on_press_stopped (PosEmojiGrid *self)
+{
+  set_pressed (self, -1);
+}
+
+
+static void
+on_long_pressed (PosEmojiGrid *self, double x, double y)
+{
+  int index = get_index_at_pos (self, x, y);
+
+  if (index < 0)
+    return;
+
+  self->long_pressed = TRUE;
+  set_pressed (self, -1);
+  g_signal_emit (self, signals[EMOJI_LONG_PRESSED], 0, (guint)index);
+}
+
+
+static void
+pos_emoji_grid_finalize (GObject *object)
+{
+  PosEmojiGrid *self = POS_EMOJI_GRID (object);
+
+  g_clear_handle_id (&self->populate_id, g_source_remove);
+  g_clear_pointer (&self->data, g_variant_unref);
+  g_clear_pointer (&self->sections, g_array_unref);
+  g_clear_pointer (&self->glyph_cache, g_hash_table_destroy);
+  g_clear_object (&self->measure_layout);
+  g_clear_object (&self->multi_press);
+  g_clear_object (&self->long_press);
+
+  G_OBJECT_CLASS (pos_emoji_grid_parent_class)->finalize (object);
+}
+
+
+static void
+pos_emoji_grid_class_init (PosEmojiGridClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+  object_class->finalize = pos_emoji_grid_finalize;
+
+  widget_class->draw = pos_emoji_grid_draw;
+  widget_class->get_request_mode = pos_emoji_grid_get_request_mode;
+  widget_class->get_preferred_width = pos_emoji_grid_get_preferred_width;
+  widget_class->get_preferred_width_for_height = pos_emoji_grid_get_preferred_width_for_height;
+  widget_class->get_preferred_height = pos_emoji_grid_get_preferred_height;
+  widget_class->size_allocate = pos_emoji_grid_size_allocate;
+  widget_class->style_updated = pos_emoji_grid_style_updated;
+
+  /**
+   * PosEmojiGrid::emoji-activated:
+   * @self: The emoji grid
+   * @index: The index of the emoji in the emoji data
+   *
+   * The user tapped an emoji.
+   */
+  signals[EMOJI_ACTIVATED] =
+    g_signal_new ("emoji-activated",
+                  G_OBJECT_CLASS_TYPE (object_class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 1, G_TYPE_UINT);
+  /**
+   * PosEmojiGrid::emoji-long-pressed:
+   * @self: The emoji grid
+   * @index: The index of the emoji in the emoji data
+   *
+   * The user long pressed an emoji. Use
+   * [method@EmojiGrid.get_item_area] to position a popover.
+   */
+  signals[EMOJI_LONG_PRESSED] =
+    g_signal_new ("emoji-long-pressed",
+                  G_OBJECT_CLASS_TYPE (object_class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 1, G_TYPE_UINT);
+
+  gtk_widget_class_set_css_name (widget_class, "pos-emoji-grid");
+}
+
+
+static void
+pos_emoji_grid_init (PosEmojiGrid *self)
+{
+  self->pressed = -1;
+  self->n_rows = 1;
+  self->sections = g_array_new (FALSE, TRUE, sizeof (PosEmojiGridSection));
+  g_array_set_clear_func (self->sections, pos_emoji_grid_section_clear);
+  self->glyph_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                             NULL, g_object_unref);
+  update_metrics (self);
+
+  gtk_widget_add_events (GTK_WIDGET (self),
+                         GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK | GDK_TOUCH_MASK);
+
+  self->multi_press = gtk_gesture_multi_press_new (GTK_WIDGET (self));
+  g_signal_connect_swapped (self->multi_press, "pressed", G_CALLBACK (on_pressed), self);
+  g_signal_connect_swapped (self->multi_press, "released", G_CALLBACK (on_released), self);
+  g_signal_connect_swapped (self->multi_press, "stopped", G_CALLBACK (on_press_stopped), self);
+
+  self->long_press = gtk_gesture_long_press_new (GTK_WIDGET (self));
+  g_signal_connect_swapped (self->long_press, "pressed", G_CALLBACK (on_long_pressed), self);
+}
+
+
+GtkWidget *
+pos_emoji_grid_new (void)
+{
+  return g_object_new (POS_TYPE_EMOJI_GRID, NULL);
+}
+
+/**
+ * pos_emoji_grid_set_data:
+ * @self: The emoji grid
+ * @data: The emoji data of type `a(ausasu)`
+ * @groups: The emoji groups that get their own section
+ * @n_groups: The number of groups
+ *
+ * Sets the emojis to display. The emojis are sorted into sections
+ * in an idle callback.
+ */
+void
+pos_emoji_grid_set_data (PosEmojiGrid *self, GVariant *data, const int *groups, guint n_groups)
+{
+  g_return_if_fail (POS_IS_EMOJI_GRID (self));
+  g_return_if_fail (g_variant_is_of_type (data, G_VARIANT_TYPE ("a(ausasu)")));
+
+  g_clear_handle_id (&self->populate_id, g_source_remove);
+  g_clear_pointer (&self->data, g_variant_unref);
+  g_hash_table_remove_all (self->glyph_cache);
+  g_array_set_size (self->sections, 0);
+
+  self->data = g_variant_ref_sink (data);
+  for (guint i = 0; i < n_groups; i++) {
+    PosEmojiGridSection section = {
+      .group = groups[i],
+      .items = g_array_new (FALSE, FALSE, sizeof (guint32)),
+    };
+
+    g_array_append_val (self->sections, section);
+  }
+
+  self->populate_pos = 0;
+  self->populate_section = 0;
+  self->populate_id = g_idle_add (populate_sections, self);
+  g_source_set_name_by_id (self->populate_id, "[pos-emoji-grid] populate");
+}
+
+/**
+ * pos_emoji_grid_get_section_extents:
+ * @self: The emoji grid
+ * @group: The group of the section
+ * @x:(out): The section's x position
+ * @width:(out): The section's width
+ *
+ * Gets the horizontal extents of a section relative to the grid.
+ *
+ * Returns: %TRUE if the section exists and isn't empty
+ */
+gboolean
+pos_emoji_grid_get_section_extents (PosEmojiGrid *self, int group, int *x, int *width)
+{
+  PosEmojiGridSection *section;
+
+  g_return_val_if_fail (POS_IS_EMOJI_GRID (self), FALSE);
+
+  section = get_section_by_group (self, group);
+  if (section == NULL || section->items->len == 0)
+    return FALSE;
+
+  *x = get_visual_x (self, section->x, section->width);
+  *width = section->width;
+  return TRUE;
+}
+
+/**
+ * pos_emoji_grid_get_item_area:
+ * @self: The emoji grid
+ * @index: The index of the emoji in the emoji data
+ * @area:(out): The area of the emoji's cell
+ *
+ * Gets the area the emoji with the given index is drawn in.
+ *
+ * Returns: %TRUE if the emoji is shown in the grid
+ */
+gboolean
+pos_emoji_grid_get_item_area (PosEmojiGrid *self, guint index, GdkRectangle *area)
+{
+  g_return_val_if_fail (POS_IS_EMOJI_GRID (self), FALSE);
+
+  for (guint i = 0; i < self->sections->len; i++) {
+    PosEmojiGridSection *section = &g_array_index (self->sections, PosEmojiGridSection, i);
+    guint32 needle = index;
+    guint n;
+
+    /* Items are sorted as they're added in order */
+    if (!g_array_binary_search (section->items, &needle, compare_index, &n))
+      continue;
+
+    get_cell_area (self, section, n, area);
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/**
+ * pos_emoji_grid_get_n_items:
+ * @self: The emoji grid
+ *
+ * Gets the number of emojis sorted into sections so far.
+ *
+ * Returns: The number of emojis
+ */
+guint
+pos_emoji_grid_get_n_items (PosEmojiGrid *self)
+{
+  guint n_items = 0;
+
+  g_return_val_if_fail (POS_IS_EMOJI_GRID (self), 0);
+
+  for (guint i = 0; i < self->sections->len; i++)
+    n_items += g_array_index (self->sections, PosEmojiGridSection, i).items->len;
+
+  return n_items;
+}
+
+/**
+ * pos_emoji_format:
+ * @item: The emoji data of type `(au...)`
+ * @modifier: The modifier to use for variations or `0`
+ * @text: The buffer to store the emoji in
+ * @len: The size of @text
+ *
+ * Formats an emoji as UTF-8 including the emoji variation selector.
+ */
+void
+pos_emoji_format (GVariant *item, gunichar modifier, char *text, gsize len)
+{
+  g_autoptr (GVariant) codes = NULL;
+  char *p = text;
+  /* Room for the variation selector and the terminating NUL */
+  char *end = text + len - 7;
+
+  g_return_if_fail (len > 7);
+
+  codes = g_variant_get_child_value (item, 0);
+  for (gsize i = 0; i < g_variant_n_children (codes) && p + 6 <= end; i++) {
+    gunichar code;
+
+    g_variant_get_child (codes, i, "u", &code);
+    if (code == 0)
+      code = modifier;
+    if (code != 0)
+      p += g_unichar_to_utf8 (code, p);
+  }
+  p += g_unichar_to_utf8 (0xFE0F, p); /* U+FE0F is the Emoji variation selector */
+  p[0] = 0;
+}
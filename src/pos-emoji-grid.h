@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define POS_TYPE_EMOJI_GRID (pos_emoji_grid_get_type ())
+
+G_DECLARE_FINAL_TYPE (PosEmojiGrid, pos_emoji_grid, POS, EMOJI_GRID, GtkDrawingArea)
+
+GtkWidget *pos_emoji_grid_new                  (void);
+void       pos_emoji_grid_set_data             (PosEmojiGrid *self,
+                                                GVariant     *data,
+                                                const int    *groups,
+                                                guint         n_groups);
+gboolean   pos_emoji_grid_get_section_extents  (PosEmojiGrid *self,
+                                                int           group,
+                                                int          *x,
+                                                int          *width);
+gboolean   pos_emoji_grid_get_item_area        (PosEmojiGrid *self,
+                                                guint         index,
+                                                GdkRectangle *area);
+guint      pos_emoji_grid_get_n_items          (PosEmojiGrid *self);
+
+void       pos_emoji_format                    (GVariant     *item,
+                                                gunichar      modifier,
+                                                char         *text,
+                                                gsize         len);
+
+G_END_DECLS
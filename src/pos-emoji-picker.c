@@ -11,7 +11,9 @@
  * Author: Matthias Clasen <mclasen@redhat.com>
  */
 
+#include "pos-emoji-grid.h"
 #include "pos-emoji-picker.h"
+#include "pos-emoji-search.h"
 
 #define BOX_SPACE 6
 
@@ -19,11 +21,13 @@ enum {
   EMOJI_PICKED,
   DELETE_LAST,
   DONE,
+  SEARCH,
   LAST_SIGNAL
 };
 
 static int signals[LAST_SIGNAL];
 
+/* Only the recent section has its own box, all others are in the emoji grid */
 typedef struct {
   GtkWidget *box;
   GtkWidget *button;
@@ -41,6 +45,7 @@ struct _PosEmojiPicker {
   GtkBox        parent_instance;
 
   GtkWidget    *scrolled_window;
+  GtkWidget    *emoji_grid;
 
   int           emoji_max_width;
 
@@ -58,16 +63,10 @@ struct _PosEmojiPicker {
   EmojiSection  flags;
 
   GtkGesture   *recent_long_press;
-  GtkGesture   *recent_multi_press;
-  GtkGesture   *people_long_press;
-  GtkGesture   *people_multi_press;
-  GtkGesture   *body_long_press;
-  GtkGesture   *body_multi_press;
 
   GVariant     *data;
-  GtkWidget    *box;
-  GVariantIter *iter;
-  guint         populate_idle;
+  GVariant     *index;
+  GArray       *search_results;
 
   GSettings    *settings;
 };
@@ -87,6 +86,44 @@ on_backspace_clicked (PosEmojiPicker *self)
 }
 
 
+static void
+on_search_clicked (PosEmojiPicker *self)
+{
+  g_signal_emit (self, signals[SEARCH], 0);
+}
+
+
+static gboolean
+get_section_allocation (PosEmojiPicker     *self,
+                        EmojiSection const *section,
+                        GtkAllocation      *alloc)
+{
+  int x, width;
+
+  if (section->box) {
+    if (!gtk_widget_get_visible (section->box))
+      return FALSE;
+
+    gtk_widget_get_allocation (section->box, alloc);
+    return TRUE;
+  }
+
+  if (!pos_emoji_grid_get_section_extents (POS_EMOJI_GRID (self->emoji_grid),
+                                           section->group,
+                                           &x,
+                                           &width)) {
+    return FALSE;
+  }
+
+  gtk_widget_get_allocation (self->emoji_grid, alloc);
+  if (alloc->x != -1)
+    alloc->x += x;
+  alloc->width = width;
+
+  return TRUE;
+}
+
+
 static void
 scroll_to_section (GtkButton *button,
                    gpointer   data)
@@ -101,7 +138,8 @@ scroll_to_section (GtkButton *button,
 
   adj = gtk_scrolled_window_get_hadjustment (GTK_SCROLLED_WINDOW (self->scrolled_window));
 
-  gtk_widget_get_allocation (section->box, &alloc);
+  if (!get_section_allocation (self, section, &alloc))
+    return;
 
   if (gtk_widget_get_direction (GTK_WIDGET (self)) == GTK_TEXT_DIR_RTL) {
     double width = gtk_widget_get_allocated_width (GTK_WIDGET (self));
@@ -150,9 +188,8 @@ populate_recent_section (PosEmojiPicker *self)
 }
 
 static GVariant *
-get_recent_emoji_data (GtkWidget *widget)
+get_recent_emoji_data (GVariant *emoji_data)
 {
-  GVariant *emoji_data = g_object_get_data (G_OBJECT (widget), "emoji-data");
   GVariantIter *codes_iter;
   GVariantIter *keywords_iter;
   GVariantBuilder codes_builder;
@@ -194,7 +231,7 @@ add_recent_item (PosEmojiPicker *self, GVariant *item, gunichar modifier)
 
   children = gtk_container_get_children (GTK_CONTAINER (self->recent.box));
   for (l = children, i = 1; l; l = l->next, i++) {
-    GVariant *item2 = get_recent_emoji_data (GTK_WIDGET (l->data));
+    GVariant *item2 = get_recent_emoji_data (g_object_get_data (G_OBJECT (l->data), "emoji-data"));
     gunichar modifier2 = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (l->data), "modifier"));
 
     if (modifier == modifier2 && g_variant_equal (item, item2)) {
@@ -223,23 +260,39 @@ add_recent_item (PosEmojiPicker *self, GVariant *item, gunichar modifier)
 }
 
 
+static void
+emoji_picked (PosEmojiPicker *self, GVariant *emoji_data, gunichar modifier)
+{
+  char text[64];
+
+  pos_emoji_format (emoji_data, modifier, text, sizeof (text));
+  add_recent_item (self, get_recent_emoji_data (emoji_data), modifier);
+
+  g_signal_emit (self, signals[EMOJI_PICKED], 0, text);
+}
+
+
 static void
 on_emoji_activated (GtkFlowBox *box, GtkFlowBoxChild *child, gpointer data)
 {
   PosEmojiPicker *self = POS_EMOJI_PICKER (data);
-  g_autofree char *text = NULL;
-  GtkWidget *label;
-  GVariant *item;
+  g_autoptr (GVariant) emoji_data = NULL;
   gunichar modifier;
 
-  label = gtk_bin_get_child (GTK_BIN (child));
-  text = g_strdup (gtk_label_get_label (GTK_LABEL (label)));
-
-  item = get_recent_emoji_data (GTK_WIDGET (child));
+  /* Adding to the recent section might destroy the child */
+  emoji_data = g_variant_ref (g_object_get_data (G_OBJECT (child), "emoji-data"));
   modifier = (gunichar) GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (child), "modifier"));
-  add_recent_item (self, item, modifier);
 
-  g_signal_emit (data, signals[EMOJI_PICKED], 0, text);
+  emoji_picked (self, emoji_data, modifier);
+}
+
+
+static void
+on_grid_emoji_activated (PosEmojiPicker *self, guint index)
+{
+  g_autoptr (GVariant) emoji_data = g_variant_get_child_value (self->data, index);
+
+  emoji_picked (self, emoji_data, 0);
 }
 
 static gboolean
@@ -265,27 +318,25 @@ has_variations (GVariant *emoji_data)
 }
 
 static void
-show_variations (PosEmojiPicker *self, GtkWidget *child)
+show_variations (PosEmojiPicker     *self,
+                 GtkWidget          *relative_to,
+                 const GdkRectangle *area,
+                 GVariant           *emoji_data)
 {
   GtkWidget *popover;
   GtkWidget *view;
   GtkWidget *box;
-  GVariant *emoji_data;
-  GtkWidget *parent;
   gunichar modifier;
 
-  if (!child)
-    return;
-
-  emoji_data = (GVariant*) g_object_get_data (G_OBJECT (child), "emoji-data");
   if (!emoji_data)
     return;
 
   if (!has_variations (emoji_data))
     return;
 
-  parent = gtk_widget_get_ancestor (child, POS_TYPE_EMOJI_PICKER);
-  popover = gtk_popover_new (child);
+  popover = gtk_popover_new (relative_to);
+  if (area)
+    gtk_popover_set_pointing_to (GTK_POPOVER (popover), area);
   view = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
   gtk_style_context_add_class (gtk_widget_get_style_context (view), "view");
   box = gtk_flow_box_new ();
@@ -297,7 +348,7 @@ show_variations (PosEmojiPicker *self, GtkWidget *child)
   gtk_container_add (GTK_CONTAINER (popover), view);
   gtk_container_add (GTK_CONTAINER (view), box);
 
-  g_signal_connect (box, "child-activated", G_CALLBACK (on_emoji_activated), parent);
+  g_signal_connect (box, "child-activated", G_CALLBACK (on_emoji_activated), self);
 
   add_emoji (box, FALSE, emoji_data, 0, self);
   for (modifier = 0x1f3fb; modifier <= 0x1f3ff; modifier++)
@@ -317,15 +368,32 @@ long_pressed_cb (GtkGesture *gesture, double x, double y, gpointer data)
 
   box = gtk_event_controller_get_widget (GTK_EVENT_CONTROLLER (gesture));
   child = GTK_WIDGET (gtk_flow_box_get_child_at_pos (GTK_FLOW_BOX (box), x, y));
-  show_variations (self, child);
+  if (!child)
+    return;
+
+  show_variations (self, child, NULL, g_object_get_data (G_OBJECT (child), "emoji-data"));
+}
+
+
+static void
+on_grid_emoji_long_pressed (PosEmojiPicker *self, guint index)
+{
+  g_autoptr (GVariant) emoji_data = g_variant_get_child_value (self->data, index);
+  GdkRectangle area;
+
+  if (!pos_emoji_grid_get_item_area (POS_EMOJI_GRID (self->emoji_grid), index, &area))
+    return;
+
+  show_variations (self, self->emoji_grid, &area, emoji_data);
 }
 
+
 static gboolean
 popup_menu (GtkWidget *widget, gpointer data)
 {
   PosEmojiPicker *self = data;
 
-  show_variations (self, widget);
+  show_variations (self, widget, NULL, g_object_get_data (G_OBJECT (widget), "emoji-data"));
   return TRUE;
 }
 
@@ -339,26 +407,11 @@ add_emoji (GtkWidget      *box,
   GtkWidget *child;
   GtkWidget *label;
   PangoAttrList *attrs;
-  GVariant *codes;
   char text[64];
-  char *p = text;
-  int i;
   PangoLayout *layout;
   PangoRectangle rect;
 
-  codes = g_variant_get_child_value (item, 0);
-  for (i = 0; i < g_variant_n_children (codes); i++) {
-    gunichar code;
-
-    g_variant_get_child (codes, i, "u", &code);
-    if (code == 0)
-      code = modifier;
-    if (code != 0)
-      p += g_unichar_to_utf8 (code, p);
-  }
-  g_variant_unref (codes);
-  p += g_unichar_to_utf8 (0xFE0F, p); /* U+FE0F is the Emoji variation selector */
-  p[0] = 0;
+  pos_emoji_format (item, modifier, text, sizeof (text));
 
   label = gtk_label_new (text);
   attrs = pango_attr_list_new ();
@@ -399,67 +452,11 @@ get_emoji_data (void)
   return g_resources_lookup_data ("/mobi/phosh/osk-stub/emoji/en.data", 0, NULL);
 }
 
-static gboolean
-populate_emoji_chooser (gpointer data)
-{
-  PosEmojiPicker *self = data;
-  GVariant *item;
-  guint64 start, now;
-
-  start = g_get_monotonic_time ();
-
-  if (!self->data) {
-    GBytes *bytes;
-
-    bytes = get_emoji_data ();
-
-    self->data = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE ("a(ausasu)"), bytes, TRUE));
-    g_bytes_unref (bytes);
-  }
-
-  if (!self->iter) {
-    self->iter = g_variant_iter_new (self->data);
-    self->box = self->people.box;
-  }
-  while ((item = g_variant_iter_next_value (self->iter)))
-  {
-    guint group;
-
-    g_variant_get_child (item, 3, "u", &group);
-
-    if (group == self->people.group)
-      self->box = self->people.box;
-    else if (group == self->body.group)
-      self->box = self->body.box;
-    else if (group == self->nature.group)
-      self->box = self->nature.box;
-    else if (group == self->food.group)
-      self->box = self->food.box;
-    else if (group == self->travel.group)
-      self->box = self->travel.box;
-    else if (group == self->activities.group)
-      self->box = self->activities.box;
-    else if (group == self->objects.group)
-      self->box = self->objects.box;
-    else if (group == self->symbols.group)
-      self->box = self->symbols.box;
-    else if (group == self->flags.group)
-      self->box = self->flags.box;
-
-    add_emoji (self->box, FALSE, item, 0, self);
-    g_variant_unref (item);
-
-    now = g_get_monotonic_time ();
-    if (now > start + 8000)
-      return G_SOURCE_CONTINUE;
-  }
-
-  g_variant_iter_free (self->iter);
-  self->iter = NULL;
-  self->box = NULL;
-  self->populate_idle = 0;
 
-  return G_SOURCE_REMOVE;
+static GBytes *
+get_emoji_index (void)
+{
+  return g_resources_lookup_data ("/mobi/phosh/osk-stub/emoji/en.index", 0, NULL);
 }
 
 static void
@@ -489,11 +486,9 @@ adj_value_changed (GtkAdjustment *adj, gpointer data)
     EmojiSection const *section = sections[i];
     GtkAllocation alloc;
 
-    if (!gtk_widget_get_visible (section->box))
+    if (!get_section_allocation (self, section, &alloc))
       continue;
 
-    gtk_widget_get_allocation (section->box, &alloc);
-
     if (gtk_widget_get_direction (GTK_WIDGET (self)) == GTK_TEXT_DIR_RTL) {
       if (alloc.x == -1 || value > alloc.x + alloc.width - width)
         break;
@@ -588,12 +583,6 @@ pos_emoji_picker_init (PosEmojiPicker *self)
   self->recent_long_press = gtk_gesture_long_press_new (self->recent.box);
   g_signal_connect (self->recent_long_press, "pressed", G_CALLBACK (long_pressed_cb), self);
 
-  self->people_long_press = gtk_gesture_long_press_new (self->people.box);
-  g_signal_connect (self->people_long_press, "pressed", G_CALLBACK (long_pressed_cb), self);
-
-  self->body_long_press = gtk_gesture_long_press_new (self->body.box);
-  g_signal_connect (self->body_long_press, "pressed", G_CALLBACK (long_pressed_cb), self);
-
   adj = gtk_scrolled_window_get_hadjustment (GTK_SCROLLED_WINDOW (self->scrolled_window));
   g_signal_connect (adj, "value-changed", G_CALLBACK (adj_value_changed), self);
 
@@ -610,8 +599,29 @@ pos_emoji_picker_init (PosEmojiPicker *self)
 
   populate_recent_section (self);
 
-  self->populate_idle = g_idle_add (populate_emoji_chooser, self);
-  g_source_set_name_by_id (self->populate_idle, "[pos] populate_emoji_chooser");
+  {
+    g_autoptr (GBytes) bytes = get_emoji_data ();
+    int groups[] = {
+      self->people.group,
+      self->body.group,
+      self->nature.group,
+      self->food.group,
+      self->travel.group,
+      self->activities.group,
+      self->objects.group,
+      self->symbols.group,
+      self->flags.group,
+    };
+
+    /* The emoji data is mapped from the resource, the grid only keeps indices into it */
+    self->data = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE ("a(ausasu)"),
+                                                               bytes,
+                                                               TRUE));
+    pos_emoji_grid_set_data (POS_EMOJI_GRID (self->emoji_grid),
+                             self->data,
+                             groups,
+                             G_N_ELEMENTS (groups));
+  }
 }
 
 static void
@@ -632,18 +642,12 @@ pos_emoji_picker_finalize (GObject *object)
 {
   PosEmojiPicker *self = POS_EMOJI_PICKER (object);
 
-  if (self->populate_idle)
-    g_source_remove (self->populate_idle);
-
-  g_variant_unref (self->data);
+  g_clear_pointer (&self->data, g_variant_unref);
+  g_clear_pointer (&self->index, g_variant_unref);
+  g_clear_pointer (&self->search_results, g_array_unref);
   g_object_unref (self->settings);
 
   g_clear_object (&self->recent_long_press);
-  g_clear_object (&self->recent_multi_press);
-  g_clear_object (&self->people_long_press);
-  g_clear_object (&self->people_multi_press);
-  g_clear_object (&self->body_long_press);
-  g_clear_object (&self->body_multi_press);
 
   G_OBJECT_CLASS (pos_emoji_picker_parent_class)->finalize (object);
 }
@@ -654,6 +658,8 @@ pos_emoji_picker_class_init (PosEmojiPickerClass *klass)
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
+  g_type_ensure (POS_TYPE_EMOJI_GRID);
+
   object_class->finalize = pos_emoji_picker_finalize;
   widget_class->show = pos_emoji_picker_show;
 
@@ -699,46 +705,53 @@ pos_emoji_picker_class_init (PosEmojiPickerClass *klass)
                   G_SIGNAL_RUN_LAST,
                   0, NULL, NULL, NULL,
                   G_TYPE_NONE, 0);
+ /**
+   * PosEmojiPicker::search:
+   *
+   * The user wants to search for emojis. The query is entered via
+   * a keyboard layout, see [method@EmojiPicker.search].
+   */
+  signals[SEARCH] =
+    g_signal_new ("search",
+                  G_OBJECT_CLASS_TYPE (object_class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 0);
 
   gtk_widget_class_set_template_from_resource (widget_class,
                                                "/mobi/phosh/osk-stub/ui/emoji-picker.ui");
 
   gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, scrolled_window);
   gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, scrolled_sections);
+  gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, emoji_grid);
 
   gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, recent.box);
   gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, recent.button);
 
-  gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, people.box);
   gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, people.button);
 
-  gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, body.box);
   gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, body.button);
 
-  gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, nature.box);
   gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, nature.button);
 
-  gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, food.box);
   gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, food.button);
 
-  gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, travel.box);
   gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, travel.button);
 
-  gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, activities.box);
   gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, activities.button);
 
-  gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, objects.box);
   gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, objects.button);
 
-  gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, symbols.box);
   gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, symbols.button);
 
-  gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, flags.box);
   gtk_widget_class_bind_template_child (widget_class, PosEmojiPicker, flags.button);
 
   gtk_widget_class_bind_template_callback (widget_class, on_emoji_activated);
+  gtk_widget_class_bind_template_callback (widget_class, on_grid_emoji_activated);
+  gtk_widget_class_bind_template_callback (widget_class, on_grid_emoji_long_pressed);
   gtk_widget_class_bind_template_callback (widget_class, on_done_clicked);
   gtk_widget_class_bind_template_callback (widget_class, on_backspace_clicked);
+  gtk_widget_class_bind_template_callback (widget_class, on_search_clicked);
 
   gtk_widget_class_set_css_name (widget_class, "pos-emoji-picker");
 }
@@ -748,3 +761,79 @@ pos_emoji_picker_new (void)
 {
   return GTK_WIDGET (g_object_new (POS_TYPE_EMOJI_PICKER, NULL));
 }
+
+/**
+ * pos_emoji_picker_search:
+ * @self: The emoji picker
+ * @query: The search query
+ * @max_results: The maximum number of results
+ *
+ * Searches emojis by name and keywords. The results can be picked via
+ * [method@EmojiPicker.pick_search_result].
+ *
+ * Returns:(transfer full): The matching emojis, best matches first
+ */
+GStrv
+pos_emoji_picker_search (PosEmojiPicker *self, const char *query, guint max_results)
+{
+  g_autoptr (GStrvBuilder) builder = g_strv_builder_new ();
+
+  g_return_val_if_fail (POS_IS_EMOJI_PICKER (self), NULL);
+  g_return_val_if_fail (query, NULL);
+
+  if (self->index == NULL) {
+    g_autoptr (GBytes) bytes = get_emoji_index ();
+
+    self->index = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE ("a(sauau)"),
+                                                                bytes,
+                                                                TRUE));
+  }
+
+  g_clear_pointer (&self->search_results, g_array_unref);
+  self->search_results = pos_emoji_search (self->index, self->data, query, max_results);
+
+  for (guint i = 0; i < self->search_results->len; i++) {
+    guint32 index = g_array_index (self->search_results, guint32, i);
+    g_autoptr (GVariant) emoji_data = g_variant_get_child_value (self->data, index);
+    char text[64];
+
+    pos_emoji_format (emoji_data, 0, text, sizeof (text));
+    g_strv_builder_add (builder, text);
+  }
+
+  return g_strv_builder_end (builder);
+}
+
+/**
+ * pos_emoji_picker_pick_search_result:
+ * @self: The emoji picker
+ * @emoji: An emoji returned by the last search
+ *
+ * Picks an emoji from the last search result. This adds it to the
+ * recently used emojis and emits [signal@EmojiPicker::emoji-picked].
+ *
+ * Returns: %TRUE if the emoji was found in the search results
+ */
+gboolean
+pos_emoji_picker_pick_search_result (PosEmojiPicker *self, const char *emoji)
+{
+  g_return_val_if_fail (POS_IS_EMOJI_PICKER (self), FALSE);
+  g_return_val_if_fail (emoji, FALSE);
+
+  if (self->search_results == NULL)
+    return FALSE;
+
+  for (guint i = 0; i < self->search_results->len; i++) {
+    guint32 index = g_array_index (self->search_results, guint32, i);
+    g_autoptr (GVariant) emoji_data = g_variant_get_child_value (self->data, index);
+    char text[64];
+
+    pos_emoji_format (emoji_data, 0, text, sizeof (text));
+    if (g_str_equal (text, emoji)) {
+      emoji_picked (self, emoji_data, 0);
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
@@ -17,5 +17,10 @@ G_BEGIN_DECLS
 G_DECLARE_FINAL_TYPE (PosEmojiPicker, pos_emoji_picker, POS, EMOJI_PICKER, GtkBox)
 
 GtkWidget *pos_emoji_picker_new      (void);
+GStrv      pos_emoji_picker_search   (PosEmojiPicker *self,
+                                      const char     *query,
+                                      guint           max_results);
+gboolean   pos_emoji_picker_pick_search_result (PosEmojiPicker *self,
+                                                const char     *emoji);
 
 G_END_DECLS
@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "pos-emoji-search"
+
+#include "pos-config.h"
+
+#include "pos-emoji-search.h"
+
+#include <string.h>
+
+/**
+ * PosEmojiSearch:
+ *
+ * Searches emojis by name and keywords using the prebuilt index from
+ * `tools/compile-emoji-index.py`.
+ *
+ * The index is a sorted `a(sauau)` of words with the emojis that have
+ * the word in their name and the ones that have it in their keywords
+ * only. All words of the query need to match (as prefix) for an emoji
+ * to be found.
+ */
+
+/* Scores per query word, the best one wins */
+#define SCORE_NAME_EXACT    8
+#define SCORE_NAME_PREFIX   4
+#define SCORE_KEYWORD_EXACT 2
+#define SCORE_KEYWORD_PREFIX 1
+
+typedef struct {
+  guint32 index;
+  guint   score;
+  gsize   name_len;
+} PosEmojiMatch;
+
+
+static GStrv
+split_query (const char *query)
+{
+  g_autofree char *down = g_utf8_strdown (query, -1);
+  g_autoptr (GStrvBuilder) builder = g_strv_builder_new ();
+  const char *start = NULL;
+
+  for (const char *p = down; ; p = g_utf8_next_char (p)) {
+    gunichar c = g_utf8_get_char (p);
+    gboolean is_word = c && g_unichar_isalnum (c);
+
+    if (is_word && start == NULL) {
+      start = p;
+    } else if (!is_word && start) {
+      g_strv_builder_take (builder, g_strndup (start, p - start));
+      start = NULL;
+    }
+
+    if (c == 0)
+      break;
+  }
+
+  return g_strv_builder_end (builder);
+}
+
+
+/* The first entry in the index that isn't sorted before @word */
+static gsize
+find_first (GVariant *index, const char *word)
+{
+  gsize lo = 0, hi = g_variant_n_children (index);
+
+  while (lo < hi) {
+    gsize mid = lo + (hi - lo) / 2;
+    g_autoptr (GVariant) entry = g_variant_get_child_value (index, mid);
+    const char *token;
+
+    g_variant_get_child (entry, 0, "&s", &token);
+    if (strcmp (token, word) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+
+static void
+add_scores (GHashTable *scores, GVariant *entry, guint member, guint score)
+{
+  g_autoptr (GVariant) indices = g_variant_get_child_value (entry, member);
+  const guint32 *values;
+  gsize n_values;
+
+  values = g_variant_get_fixed_array (indices, &n_values, sizeof (guint32));
+  for (gsize i = 0; i < n_values; i++) {
+    gpointer key = GUINT_TO_POINTER (values[i]);
+    guint old = GPOINTER_TO_UINT (g_hash_table_lookup (scores, key));
+
+    if (score > old)
+      g_hash_table_insert (scores, key, GUINT_TO_POINTER (score));
+  }
+}
+
+
+/* Scores of all emojis having a word starting with @word */
+static GHashTable *
+lookup_word (GVariant *index, const char *word)
+{
+  GHashTable *scores = g_hash_table_new (g_direct_hash, g_direct_equal);
+  gsize n_entries = g_variant_n_children (index);
+  gsize len = strlen (word);
+
+  for (gsize i = find_first (index, word); i < n_entries; i++) {
+    g_autoptr (GVariant) entry = g_variant_get_child_value (index, i);
+    const char *token;
+    gboolean exact;
+
+    g_variant_get_child (entry, 0, "&s", &token);
+    if (strncmp (token, word, len) != 0)
+      break;
+
+    exact = token[len] == '\0';
+    add_scores (scores, entry, 1, exact ? SCORE_NAME_EXACT : SCORE_NAME_PREFIX);
+    add_scores (scores, entry, 2, exact ? SCORE_KEYWORD_EXACT : SCORE_KEYWORD_PREFIX);
+  }
+
+  return scores;
+}
+
+
+static int
+compare_matches (gconstpointer a, gconstpointer b)
+{
+  const PosEmojiMatch *match_a = a;
+  const PosEmojiMatch *match_b = b;
+
+  if (match_a->score != match_b->score)
+    return match_a->score > match_b->score ? -1 : 1;
+
+  /* Shorter names are the better match for the same words */
+  if (match_a->name_len != match_b->name_len)
+    return match_a->name_len < match_b->name_len ? -1 : 1;
+
+  return (match_a->index > match_b->index) - (match_a->index < match_b->index);
+}
+
+/**
+ * pos_emoji_search:
+ * @index: The search index of type `a(sauau)`
+ * @data: The emoji data of type `a(ausasu)` the index was built from
+ * @query: The search query
+ * @max_results: The maximum number of results
+ *
+ * Looks up the emojis matching all words in @query. Best matches come
+ * first.
+ *
+ * Returns:(transfer full): The indices of the matching emojis in @data
+ */
+GArray *
+pos_emoji_search (GVariant *index, GVariant *data, const char *query, guint max_results)
+{
+  g_autoptr (GHashTable) scores = NULL;
+  g_autoptr (GArray) matches = NULL;
+  g_auto (GStrv) words = NULL;
+  GArray *results;
+  GHashTableIter iter;
+  gpointer key, value;
+
+  g_return_val_if_fail (g_variant_is_of_type (index, G_VARIANT_TYPE ("a(sauau)")), NULL);
+  g_return_val_if_fail (g_variant_is_of_type (data, G_VARIANT_TYPE ("a(ausasu)")), NULL);
+  g_return_val_if_fail (query, NULL);
+
+  results = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  words = split_query (query);
+  for (guint i = 0; words[i]; i++) {
+    g_autoptr (GHashTable) word_scores = lookup_word (index, words[i]);
+
+    if (scores == NULL) {
+      scores = g_steal_pointer (&word_scores);
+      continue;
+    }
+
+    /* Only keep emojis that match all words */
+    g_hash_table_iter_init (&iter, scores);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+      guint score = GPOINTER_TO_UINT (g_hash_table_lookup (word_scores, key));
+
+      if (score)
+        g_hash_table_iter_replace (&iter, GUINT_TO_POINTER (GPOINTER_TO_UINT (value) + score));
+      else
+        g_hash_table_iter_remove (&iter);
+    }
+  }
+
+  if (scores == NULL)
+    return results;
+
+  matches = g_array_sized_new (FALSE, FALSE, sizeof (PosEmojiMatch), g_hash_table_size (scores));
+  g_hash_table_iter_init (&iter, scores);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    g_autoptr (GVariant) item = NULL;
+    PosEmojiMatch match = {
+      .index = GPOINTER_TO_UINT (key),
+      .score = GPOINTER_TO_UINT (value),
+    };
+    const char *name;
+
+    if (match.index >= g_variant_n_children (data))
+      continue;
+
+    item = g_variant_get_child_value (data, match.index);
+    g_variant_get_child (item, 1, "&s", &name);
+    match.name_len = strlen (name);
+
+    g_array_append_val (matches, match);
+  }
+  g_array_sort (matches, compare_matches);
+
+  for (guint i = 0; i < matches->len && i < max_results; i++)
+    g_array_append_val (results, g_array_index (matches, PosEmojiMatch, i).index);
+
+  return results;
+}
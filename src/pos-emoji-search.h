@@ -0,0 +1,18 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+GArray *pos_emoji_search (GVariant   *index,
+                          GVariant   *data,
+                          const char *query,
+                          guint       max_results);
+
+G_END_DECLS
@@ -40,6 +40,22 @@ static guint signals[N_SIGNALS];
 static void pos_im_state_free (PosImState *state);
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (PosImState, pos_im_state_free);
 
+/* Commits are batched for at most one frame */
+#define BATCH_INTERVAL_MS 16
+
+/*
+ * The requests making up a single commit
+ */
+typedef struct {
+  gboolean  pending;
+  guint     before_length;
+  guint     after_length;
+  GString  *text;
+  char     *preedit;
+  guint     cstart;
+  guint     cend;
+} PosImRequests;
+
 /**
  * PosInputMethod:
  *
@@ -62,14 +78,51 @@ struct _PosInputMethod {
   PosImState *submitted;
 
   guint       serial;
+
+  /* Commit batching */
+  gboolean      batch_commits;
+  PosImRequests current;
+  PosImRequests batch;
+  guint         batch_id;
+  guint         n_commits_requested;
+  guint         n_commits_sent;
 };
 G_DEFINE_TYPE (PosInputMethod, pos_input_method, G_TYPE_OBJECT)
 
 
+static void
+pos_im_requests_init (PosImRequests *requests)
+{
+  requests->text = g_string_new (NULL);
+}
+
+
+static void
+pos_im_requests_reset (PosImRequests *requests)
+{
+  requests->pending = FALSE;
+  requests->before_length = 0;
+  requests->after_length = 0;
+  g_string_truncate (requests->text, 0);
+  g_clear_pointer (&requests->preedit, g_free);
+  requests->cstart = 0;
+  requests->cend = 0;
+}
+
+
+static void
+pos_im_requests_clear (PosImRequests *requests)
+{
+  pos_im_requests_reset (requests);
+  g_string_free (requests->text, TRUE);
+  requests->text = NULL;
+}
+
+
 static void
 pos_im_state_free (PosImState *state)
 {
-  g_clear_pointer (&state->surrounding_text, g_free);
+  g_clear_pointer (&state->surrounding_text, g_ref_string_release);
   g_free (state);
 }
 
@@ -79,7 +132,9 @@ pos_im_state_dup (PosImState *state)
 {
   PosImState *new = g_memdup2 (state, sizeof (PosImState));
 
-  new->surrounding_text = g_strdup (state->surrounding_text);
+  /* The text is shared, it's replaced rather than modified */
+  if (state->surrounding_text)
+    new->surrounding_text = g_ref_string_acquire (state->surrounding_text);
 
   return new;
 }
@@ -97,7 +152,7 @@ handle_activate (void                       *data,
     return;
 
   self->pending->active = TRUE;
-  g_clear_pointer (&self->pending->surrounding_text, g_free);
+  g_clear_pointer (&self->pending->surrounding_text, g_ref_string_release);
   self->pending->text_change_cause = POS_INPUT_METHOD_TEXT_CHANGE_CAUSE_IM;
   self->pending->purpose = POS_INPUT_METHOD_PURPOSE_NORMAL;
   self->pending->hint = POS_INPUT_METHOD_HINT_NONE;
@@ -136,8 +191,9 @@ handle_surrounding_text (void                       *data,
       self->pending->anchor == anchor)
     return;
 
-  g_free (self->pending->surrounding_text);
-  self->pending->surrounding_text = g_strdup (text);
+  g_clear_pointer (&self->pending->surrounding_text, g_ref_string_release);
+  if (text)
+    self->pending->surrounding_text = g_ref_string_new (text);
   self->pending->cursor = cursor;
   self->pending->anchor = anchor;
   g_signal_emit (self, signals[PENDING_CHANGED], 0, self->pending);
@@ -180,6 +236,8 @@ handle_content_type (void                       *data,
 }
 
 
+static void pos_input_method_flush_batch (PosInputMethod *self);
+
 static void
 handle_done (void                       *data,
              struct zwp_input_method_v2 *zwp_input_method_v2)
@@ -189,6 +247,18 @@ handle_done (void                       *data,
 
   g_debug ("%s", __func__);
 
+  /*
+   * Batched text was created against the old state so send it with the
+   * old serial before the new state applies.
+   */
+  pos_input_method_flush_batch (self);
+
+  if (current->active != self->pending->active) {
+    /* Focus changed: drop requests for the old text input that were never committed */
+    pos_im_requests_reset (&self->current);
+    g_debug ("Commits requested: %u, sent: %u", self->n_commits_requested, self->n_commits_sent);
+  }
+
   self->serial++;
   g_object_freeze_notify (G_OBJECT (self));
 
@@ -197,7 +267,9 @@ handle_done (void                       *data,
   if (current->active != self->submitted->active)
     g_object_notify_by_pspec (G_OBJECT (self), props[PROP_ACTIVE]);
 
-  if (g_strcmp0 (current->surrounding_text, self->submitted->surrounding_text) ||
+  /* Unchanged text is shared between states so most of the time comparing pointers suffices */
+  if ((current->surrounding_text != self->submitted->surrounding_text &&
+       g_strcmp0 (current->surrounding_text, self->submitted->surrounding_text)) ||
       current->cursor != self->submitted->cursor ||
       current->anchor != self->submitted->anchor)
     g_object_notify_by_pspec (G_OBJECT (self), props[PROP_SURROUNDING_TEXT]);
@@ -236,6 +308,87 @@ static const struct zwp_input_method_v2_listener input_method_listener = {
 };
 
 
+static void
+pos_input_method_send_requests (PosInputMethod *self, PosImRequests *requests)
+{
+  /* The compositor applies these in this order regardless of the order sent */
+  if (requests->before_length || requests->after_length) {
+    zwp_input_method_v2_delete_surrounding_text (self->input_method,
+                                                 requests->before_length,
+                                                 requests->after_length);
+  }
+  if (requests->text->len)
+    zwp_input_method_v2_commit_string (self->input_method, requests->text->str);
+  if (requests->preedit) {
+    zwp_input_method_v2_set_preedit_string (self->input_method,
+                                            requests->preedit,
+                                            requests->cstart,
+                                            requests->cend);
+  }
+}
+
+
+static void
+pos_input_method_flush_batch (PosInputMethod *self)
+{
+  PosImRequests *batch = &self->batch;
+
+  g_clear_handle_id (&self->batch_id, g_source_remove);
+
+  if (!batch->pending)
+    return;
+
+  pos_input_method_send_requests (self, batch);
+  zwp_input_method_v2_commit (self->input_method, self->serial);
+  self->n_commits_sent++;
+
+  pos_im_requests_reset (batch);
+}
+
+
+static void
+on_batch_timeout (gpointer data)
+{
+  PosInputMethod *self = POS_INPUT_METHOD (data);
+
+  self->batch_id = 0;
+  pos_input_method_flush_batch (self);
+}
+
+/*
+ * Merge the requests of the current commit into the batch. The result
+ * must match what the client would see after applying both commits in
+ * order: deletions and text accumulate and the preedit of the last
+ * commit wins since each commit resets the preedit.
+ */
+static void
+pos_input_method_batch_current (PosInputMethod *self)
+{
+  PosImRequests *current = &self->current;
+  PosImRequests *batch = &self->batch;
+
+  /* Deletions are applied before the text so we can't merge them after text */
+  if ((current->before_length || current->after_length) && batch->text->len)
+    pos_input_method_flush_batch (self);
+
+  batch->pending = TRUE;
+  batch->before_length += current->before_length;
+  batch->after_length += current->after_length;
+  g_string_append_len (batch->text, current->text->str, current->text->len);
+  g_free (batch->preedit);
+  batch->preedit = g_steal_pointer (&current->preedit);
+  batch->cstart = current->cstart;
+  batch->cend = current->cend;
+
+  pos_im_requests_reset (current);
+
+  if (self->batch_id == 0) {
+    self->batch_id = g_timeout_add_once (BATCH_INTERVAL_MS, on_batch_timeout, self);
+    g_source_set_name_by_id (self->batch_id, "[pos-input-method] batch");
+  }
+}
+
+
 static void
 pos_input_method_set_property (GObject      *object,
                                  guint         property_id,
@@ -310,6 +463,9 @@ pos_input_method_finalize (GObject *object)
 {
   PosInputMethod *self = POS_INPUT_METHOD(object);
 
+  g_clear_handle_id (&self->batch_id, g_source_remove);
+  pos_im_requests_clear (&self->current);
+  pos_im_requests_clear (&self->batch);
   g_clear_pointer (&self->submitted, pos_im_state_free);
   g_clear_pointer (&self->pending, pos_im_state_free);
   g_clear_pointer (&self->input_method, zwp_input_method_v2_destroy);
@@ -442,6 +598,9 @@ pos_input_method_init (PosInputMethod *self)
 {
   self->pending = g_new0 (PosImState, 1);
   self->submitted = g_new0 (PosImState, 1);
+
+  pos_im_requests_init (&self->current);
+  pos_im_requests_init (&self->batch);
 }
 
 
@@ -521,7 +680,11 @@ pos_input_method_get_serial (PosInputMethod *self)
 void
 pos_input_method_send_string (PosInputMethod *self, const char *string, gboolean commit)
 {
-  zwp_input_method_v2_commit_string (self->input_method, string);
+  if (self->batch_commits)
+    g_string_append (self->current.text, string);
+  else
+    zwp_input_method_v2_commit_string (self->input_method, string);
+
   if (commit)
     pos_input_method_commit (self);
 }
@@ -540,7 +703,15 @@ void
 pos_input_method_send_preedit (PosInputMethod *self, const char *preedit,
                                guint cstart, guint cend, gboolean commit)
 {
-  zwp_input_method_v2_set_preedit_string (self->input_method, preedit, cstart, cend);
+  if (self->batch_commits) {
+    g_free (self->current.preedit);
+    self->current.preedit = g_strdup (preedit);
+    self->current.cstart = cstart;
+    self->current.cend = cend;
+  } else {
+    zwp_input_method_v2_set_preedit_string (self->input_method, preedit, cstart, cend);
+  }
+
   if (commit)
     pos_input_method_commit (self);
 }
@@ -560,7 +731,13 @@ pos_input_method_delete_surrounding_text (PosInputMethod *self,
                                           guint after_length,
                                           gboolean commit)
 {
-  zwp_input_method_v2_delete_surrounding_text (self->input_method, before_length, after_length);
+  if (self->batch_commits) {
+    self->current.before_length += before_length;
+    self->current.after_length += after_length;
+  } else {
+    zwp_input_method_v2_delete_surrounding_text (self->input_method, before_length, after_length);
+  }
+
   if (commit)
     pos_input_method_commit (self);
 }
@@ -572,9 +749,68 @@ pos_input_method_delete_surrounding_text (PosInputMethod *self,
  * Sends a `commit` request to the compositor so that any pending
  * `commit_string`, `set_preedit_string` and `delete_surrounding_text`.
  * changes get applied.
+ *
+ * When batching commits the changes are merged with the ones of other
+ * commits in the same frame and sent later on.
  */
 void
 pos_input_method_commit (PosInputMethod *self)
 {
+  self->n_commits_requested++;
+
+  if (self->batch_commits) {
+    pos_input_method_batch_current (self);
+    return;
+  }
+
   zwp_input_method_v2_commit (self->input_method, self->serial);
+  self->n_commits_sent++;
+}
+
+/**
+ * pos_input_method_set_batch_commits:
+ * @self: The input method
+ * @batch_commits: Whether to batch commits
+ *
+ * When enabled commits issued within one frame are merged into a
+ * single commit. This reduces the number of round trips to the
+ * application when typing fast or on key repeat.
+ */
+void
+pos_input_method_set_batch_commits (PosInputMethod *self, gboolean batch_commits)
+{
+  g_return_if_fail (POS_IS_INPUT_METHOD (self));
+
+  if (self->batch_commits == batch_commits)
+    return;
+
+  g_debug ("Batching commits: %d", batch_commits);
+  if (!batch_commits) {
+    pos_input_method_flush_batch (self);
+    /* Requests not committed yet */
+    pos_input_method_send_requests (self, &self->current);
+    pos_im_requests_reset (&self->current);
+  }
+
+  self->batch_commits = batch_commits;
+}
+
+/**
+ * pos_input_method_get_commit_stats:
+ * @self: The input method
+ * @requested: (out) (optional): Number of commits requested
+ * @sent: (out) (optional): Number of commits sent to the compositor
+ *
+ * Get the number of commits requested by the OSK and the number
+ * actually sent. These only differ when batching commits.
+ */
+void
+pos_input_method_get_commit_stats (PosInputMethod *self, guint *requested, guint *sent)
+{
+  g_return_if_fail (POS_IS_INPUT_METHOD (self));
+
+  if (requested)
+    *requested = self->n_commits_requested;
+  if (sent)
+    *sent = self->n_commits_sent;
 }
@@ -49,4 +49,9 @@ void                          pos_input_method_delete_surrounding_text (PosInput
                                                                         guint after_length,
                                                                         gboolean commit);
 void                          pos_input_method_commit (PosInputMethod *self);
+void                          pos_input_method_set_batch_commits (PosInputMethod *self,
+                                                                  gboolean        batch_commits);
+void                          pos_input_method_get_commit_stats (PosInputMethod *self,
+                                                                 guint          *requested,
+                                                                 guint          *sent);
 G_END_DECLS
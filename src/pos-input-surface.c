@@ -112,14 +112,21 @@ struct _PosInputSurface {
 
   /* OSK */
   GHashTable              *osks;
+  GQueue                   osk_lru;
   HdyDeck                 *deck;
   GtkWidget               *osk_terminal;
   GtkWidget               *emoji_picker;
+  GtkWidget               *emoji_search_entry;
+  GString                 *emoji_query;
+  gboolean                 emoji_search;
   GtkWidget               *last_layout;
   GtkWidget               *keypad;
   PosShortcutsBar         *shortcuts_bar;
   PhoshOskFeatures         osk_features;
   GdkModifierType          latched_modifiers;
+  /* Input event times of the key that emits the next symbol */
+  guint32                  key_down_time;
+  guint32                  key_up_time;
 
   /* TODO: this should be an interface for different keyboard drivers */
   PosVkDriver             *keyboard_driver;
@@ -141,6 +148,7 @@ struct _PosInputSurface {
 
   /* Clipboard */
   PosClipboardManager    *clipboard_manager;
+  GCancellable           *clipboard_cancel;
 
   /* Swipe gesture */
   GtkGesture              *swipe_down;
@@ -159,6 +167,9 @@ G_DEFINE_TYPE_WITH_CODE (PosInputSurface, pos_input_surface, PHOSH_TYPE_LAYER_SU
   )
 
 #define MIN_Y_VELOCITY 1000
+/* Memory the keys of recently used layouts may use */
+#define OSK_KEYS_BUDGET (64 * 1024)
+#define MAX_EMOJI_SEARCH_RESULTS 24
 
 static void
 on_swipe (GtkGestureSwipe *swipe, double velocity_x, double velocity_y, gpointer data)
@@ -278,6 +289,100 @@ pos_input_surface_is_completion_mode (PosInputSurface *self)
 }
 
 
+/* Emoji search: The query is typed on the last used layout and shown in the search entry,
+ * results go to the completion bar */
+
+static void
+pos_input_surface_update_emoji_search (PosInputSurface *self)
+{
+  g_auto (GStrv) results = NULL;
+
+  if (self->emoji_query->len)
+    results = pos_emoji_picker_search (POS_EMOJI_PICKER (self->emoji_picker),
+                                       self->emoji_query->str,
+                                       MAX_EMOJI_SEARCH_RESULTS);
+
+  /* Let the user see what they typed */
+  gtk_entry_set_text (GTK_ENTRY (self->emoji_search_entry), self->emoji_query->str);
+  pos_completion_bar_set_completions (POS_COMPLETION_BAR (self->completion_bar), results);
+}
+
+
+static void
+pos_input_surface_stop_emoji_search (PosInputSurface *self)
+{
+  if (!self->emoji_search)
+    return;
+
+  g_debug ("Stopping emoji search");
+  self->emoji_search = FALSE;
+  g_string_truncate (self->emoji_query, 0);
+  gtk_entry_set_text (GTK_ENTRY (self->emoji_search_entry), "");
+  gtk_widget_set_visible (self->emoji_search_entry, FALSE);
+
+  /* Restore the completion bar's visibility */
+  pos_completion_bar_set_completions (POS_COMPLETION_BAR (self->completion_bar), NULL);
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_COMPLETER_ACTIVE]);
+}
+
+
+static void
+on_emoji_picker_search (PosInputSurface *self)
+{
+  if (self->last_layout == NULL)
+    return;
+
+  g_debug ("Starting emoji search");
+  hdy_deck_set_visible_child (self->deck, self->last_layout);
+
+  self->emoji_search = TRUE;
+  g_string_truncate (self->emoji_query, 0);
+  pos_input_surface_update_emoji_search (self);
+  gtk_widget_set_visible (self->emoji_search_entry, TRUE);
+  gtk_widget_set_visible (self->completion_bar, TRUE);
+}
+
+
+/* Returns %TRUE if the symbol was consumed by the emoji search */
+static gboolean
+pos_input_surface_feed_emoji_search (PosInputSurface *self, const char *symbol)
+{
+  if (g_str_equal (symbol, "KEY_BACKSPACE")) {
+    const char *last;
+
+    if (self->emoji_query->len == 0) {
+      pos_input_surface_stop_emoji_search (self);
+      return TRUE;
+    }
+
+    last = g_utf8_find_prev_char (self->emoji_query->str,
+                                  self->emoji_query->str + self->emoji_query->len);
+    g_string_truncate (self->emoji_query, last - self->emoji_query->str);
+  } else if (g_str_equal (symbol, "KEY_ENTER")) {
+    g_auto (GStrv) results = NULL;
+
+    /* Pick the best match */
+    if (self->emoji_query->len)
+      results = pos_emoji_picker_search (POS_EMOJI_PICKER (self->emoji_picker),
+                                         self->emoji_query->str, 1);
+    if (results && results[0])
+      pos_emoji_picker_pick_search_result (POS_EMOJI_PICKER (self->emoji_picker), results[0]);
+
+    pos_input_surface_stop_emoji_search (self);
+    return TRUE;
+  } else if (g_str_has_prefix (symbol, "KEY_")) {
+    pos_input_surface_stop_emoji_search (self);
+    return FALSE;
+  } else {
+    g_string_append (self->emoji_query, symbol);
+  }
+
+  g_debug ("Emoji search: '%s'", self->emoji_query->str);
+  pos_input_surface_update_emoji_search (self);
+  return TRUE;
+}
+
+
 static void
 on_completion_selected (PosInputSurface *self, const char *completion)
 {
@@ -286,6 +391,12 @@ on_completion_selected (PosInputSurface *self, const char *completion)
   g_return_if_fail (POS_IS_INPUT_SURFACE (self));
   g_return_if_fail (completion != NULL);
 
+  if (self->emoji_search) {
+    pos_emoji_picker_pick_search_result (POS_EMOJI_PICKER (self->emoji_picker), completion);
+    pos_input_surface_stop_emoji_search (self);
+    return;
+  }
+
   g_debug ("completion: %s", completion);
   send = g_strdup_printf ("%s ", completion);
 
@@ -319,13 +430,31 @@ on_completer_preedit_changed (PosInputSurface *self)
 static void
 on_completer_completions_changed (PosInputSurface *self)
 {
-  g_auto (GStrv) completions = pos_completer_get_completions (self->completer);
+  g_auto (GStrv) completions = NULL;
+
+  /* Keep the placeholder */
+  if (pos_completer_is_loading (self->completer))
+    return;
+
+  if (self->emoji_search)
+    return;
 
+  completions = pos_completer_get_completions (self->completer);
   pos_completion_bar_set_completions (POS_COMPLETION_BAR (self->completion_bar),
                                       completions);
 }
 
 
+static void
+on_completer_loading_changed (PosInputSurface *self)
+{
+  if (pos_completer_is_loading (self->completer))
+    pos_completion_bar_set_loading (POS_COMPLETION_BAR (self->completion_bar));
+  else
+    on_completer_completions_changed (self);
+}
+
+
 static void
 on_completer_commit_string (PosInputSurface *self, const char *text)
 {
@@ -368,38 +497,68 @@ pos_input_surface_submit_current_preedit (PosInputSurface *self)
 
 
 static void
-on_osk_key_down (PosInputSurface *self, const char *symbol, GtkWidget *osk_widget)
+on_osk_key_down (PosInputSurface *self, const char *symbol, guint time, GtkWidget *osk_widget)
 {
   g_return_if_fail (POS_IS_INPUT_SURFACE (self));
   g_return_if_fail (POS_IS_OSK_WIDGET (osk_widget));
 
+  self->key_down_time = time;
+  self->key_up_time = GDK_CURRENT_TIME;
   pos_input_surface_notify_key_press (self);
 }
 
 
+static void
+on_osk_key_up (PosInputSurface *self, const char *symbol, guint time)
+{
+  g_return_if_fail (POS_IS_INPUT_SURFACE (self));
+
+  self->key_up_time = time;
+}
+
+
+static void
+pos_input_surface_send_key (PosInputSurface    *self,
+                            const char         *symbol,
+                            PosKeycodeModifier  modifier,
+                            guint32             down_time,
+                            guint32             up_time)
+{
+  pos_vk_driver_key_down (self->keyboard_driver, symbol, modifier, down_time);
+  pos_vk_driver_key_up (self->keyboard_driver, symbol, up_time);
+}
+
+
 static void
 on_osk_key_symbol (PosInputSurface *self, const char *symbol)
 {
   gboolean handled;
+  guint32 down_time, up_time;
 
   g_return_if_fail (POS_IS_INPUT_SURFACE (self));
 
+  /* Symbols not preceded by a key press (e.g. from the keypad) have no event times */
+  down_time = self->key_down_time;
+  up_time = self->key_up_time;
+  self->key_down_time = self->key_up_time = GDK_CURRENT_TIME;
+
   g_debug ("Key: '%s' symbol", symbol);
 
+  if (self->emoji_search && pos_input_surface_feed_emoji_search (self, symbol))
+    return;
+
   /* Latched modifiers, send as virtual-keyboard */
   if (self->latched_modifiers) {
     PosKeycodeModifier modifier;
 
     modifier = pos_vk_driver_convert_modifiers (self->keyboard_driver, self->latched_modifiers);
-    pos_vk_driver_key_down (self->keyboard_driver, symbol, modifier);
-    pos_vk_driver_key_up (self->keyboard_driver, symbol);
+    pos_input_surface_send_key (self, symbol, modifier, down_time, up_time);
     pos_input_surface_unlatch_modifiers (self);
     return;
   }
   /* virtual-keyboard, no input method */
   if (!pos_input_method_get_active (self->input_method)) {
-    pos_vk_driver_key_down (self->keyboard_driver, symbol, POS_KEYCODE_MODIFIER_NONE);
-    pos_vk_driver_key_up (self->keyboard_driver, symbol);
+    pos_input_surface_send_key (self, symbol, POS_KEYCODE_MODIFIER_NONE, down_time, up_time);
     return;
   }
 
@@ -410,8 +569,7 @@ on_osk_key_symbol (PosInputSurface *self, const char *symbol)
   }
 
   if (g_str_has_prefix (symbol, "KEY_")) {
-    pos_vk_driver_key_down (self->keyboard_driver, symbol, POS_KEYCODE_MODIFIER_NONE);
-    pos_vk_driver_key_up (self->keyboard_driver, symbol);
+    pos_input_surface_send_key (self, symbol, POS_KEYCODE_MODIFIER_NONE, down_time, up_time);
   } else {
     pos_input_method_send_string (self->input_method, symbol, TRUE);
   }
@@ -442,7 +600,8 @@ set_keymap (PosInputSurface *self)
   } else {
     pos_vk_driver_set_keymap_symbols (self->keyboard_driver,
                                       pos_osk_widget_get_layout_id (osk),
-                                      pos_osk_widget_get_symbols (osk));
+                                      pos_osk_widget_get_symbols (osk),
+                                      pos_osk_widget_get_popover_symbols (osk));
   }
 }
 
@@ -450,6 +609,10 @@ set_keymap (PosInputSurface *self)
 static void
 set_keymap_delayed (PosInputSurface *self)
 {
+  /* Popover symbols are usually part of the layout's keymap */
+  if (!pos_vk_driver_get_overlay_active (self->keyboard_driver))
+    return;
+
   /*
    * Add a slight delay before switching back the keymap. Otherwise an
    * X11 client might apply the symbol sent to the popup to the new
@@ -493,14 +656,22 @@ on_osk_popover_hidden (PosInputSurface *self)
 
 
 static void
-clipboard_paste_activated (GSimpleAction *action,
-                           GVariant      *parameter,
-                           gpointer       data)
+on_clipboard_text_fetched (GObject      *source_object,
+                           GAsyncResult *res,
+                           gpointer      user_data)
 {
-  PosInputSurface *self = POS_INPUT_SURFACE (data);
-  const char *text;
+  PosInputSurface *self;
+  g_autofree char *text = NULL;
+  g_autoptr (GError) err = NULL;
+
+  text = pos_clipboard_manager_fetch_text_finish (POS_CLIPBOARD_MANAGER (source_object), res, &err);
+  if (text == NULL) {
+    if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      g_warning ("Failed to get clipboard text: %s", err->message);
+    return;
+  }
 
-  text = pos_clipboard_manager_get_text (self->clipboard_manager);
+  self = POS_INPUT_SURFACE (user_data);
   if (gm_str_is_null_or_empty (text))
     return;
 
@@ -511,6 +682,24 @@ clipboard_paste_activated (GSimpleAction *action,
     /* TODO */
     g_warning_once ("Pasting via vk-driver not yet supported");
   }
+}
+
+
+static void
+clipboard_paste_activated (GSimpleAction *action,
+                           GVariant      *parameter,
+                           gpointer       data)
+{
+  PosInputSurface *self = POS_INPUT_SURFACE (data);
+
+  g_cancellable_cancel (self->clipboard_cancel);
+  g_clear_object (&self->clipboard_cancel);
+  self->clipboard_cancel = g_cancellable_new ();
+
+  pos_clipboard_manager_fetch_text_async (self->clipboard_manager,
+                                          self->clipboard_cancel,
+                                          on_clipboard_text_fetched,
+                                          self);
 
   /* Close popover in case we pasted from there */
   gtk_popover_popdown (self->menu_popup);
@@ -554,8 +743,9 @@ send_emoji_via_vk (PosInputSurface *self, const char *emoji)
   for (int i = 0; syms_array->pdata[i]; i++) {
     const char *symbol = syms_array->pdata[i];
 
-    pos_vk_driver_key_down (self->keyboard_driver, symbol, POS_KEYCODE_MODIFIER_NONE);
-    pos_vk_driver_key_up (self->keyboard_driver, symbol);
+    pos_vk_driver_key_down (self->keyboard_driver, symbol, POS_KEYCODE_MODIFIER_NONE,
+                            GDK_CURRENT_TIME);
+    pos_vk_driver_key_up (self->keyboard_driver, symbol, GDK_CURRENT_TIME);
   }
 
   set_keymap_delayed (self);
@@ -605,8 +795,9 @@ on_keypad_symbol_pressed (PosInputSurface *self, const char *symbol, PosKeypad *
     pos_input_surface_submit_current_preedit (self);
     pos_input_method_send_string (self->input_method, symbol, TRUE);
   } else {
-    pos_vk_driver_key_down (self->keyboard_driver, symbol, POS_KEYCODE_MODIFIER_NONE);
-    pos_vk_driver_key_up (self->keyboard_driver, symbol);
+    pos_vk_driver_key_down (self->keyboard_driver, symbol, POS_KEYCODE_MODIFIER_NONE,
+                            GDK_CURRENT_TIME);
+    pos_vk_driver_key_up (self->keyboard_driver, symbol, GDK_CURRENT_TIME);
   }
 
   pos_input_surface_notify_key_press (self);
@@ -786,7 +977,53 @@ pos_input_surface_switch_completion (PosInputSurface *self, PosOskWidget *osk)
     }
   }
 
-  pos_completion_bar_set_completions (POS_COMPLETION_BAR (self->completion_bar), NULL);
+  if (self->completer && pos_completer_is_loading (self->completer))
+    pos_completion_bar_set_loading (POS_COMPLETION_BAR (self->completion_bar));
+  else
+    pos_completion_bar_set_completions (POS_COMPLETION_BAR (self->completion_bar), NULL);
+}
+
+
+/*
+ * Move the layout to the front of the recently used list and release
+ * the keys of the least recently used ones that exceed the budget.
+ * They're rebuilt once shown again.
+ */
+static void
+pos_input_surface_touch_osk (PosInputSurface *self, PosOskWidget *osk)
+{
+  const char *name = pos_osk_widget_get_name (osk);
+  GList *link;
+  gsize used = 0;
+
+  if (self->osks == NULL)
+    return;
+
+  link = g_queue_find_custom (&self->osk_lru, name, (GCompareFunc)g_strcmp0);
+  if (link) {
+    g_queue_unlink (&self->osk_lru, link);
+    g_queue_push_head_link (&self->osk_lru, link);
+  } else {
+    g_queue_push_head (&self->osk_lru, g_strdup (name));
+  }
+
+  link = self->osk_lru.head;
+  while (link) {
+    GList *next = link->next;
+    PosOskWidget *lru_osk = g_hash_table_lookup (self->osks, link->data);
+
+    if (lru_osk == NULL) {
+      /* Layout got removed */
+      g_free (link->data);
+      g_queue_delete_link (&self->osk_lru, link);
+    } else if (used + pos_osk_widget_get_keys_size (lru_osk) > OSK_KEYS_BUDGET &&
+               lru_osk != osk && pos_osk_widget_release_keys (lru_osk)) {
+      g_debug ("Released keys of layout '%s'", pos_osk_widget_get_name (lru_osk));
+    } else {
+      used += pos_osk_widget_get_keys_size (lru_osk);
+    }
+    link = next;
+  }
 }
 
 
@@ -800,6 +1037,9 @@ on_visible_child_changed (PosInputSurface *self)
 
   pos_input_surface_toggle_shortcuts_bar (self);
 
+  if (child != self->last_layout)
+    pos_input_surface_stop_emoji_search (self);
+
   if (!POS_IS_OSK_WIDGET (child))
     return;
 
@@ -807,6 +1047,9 @@ on_visible_child_changed (PosInputSurface *self)
   g_debug ("Switched to layout '%s'", pos_osk_widget_get_display_name (osk));
   pos_osk_widget_set_layer (osk, POS_OSK_WIDGET_LAYER_NORMAL);
 
+  if (POS_INPUT_SURFACE_IS_LANG_LAYOUT (osk))
+    pos_input_surface_touch_osk (self, osk);
+
   set_keymap (self);
 
   /* Remember last layout */
@@ -923,6 +1166,8 @@ pos_input_surface_set_completer (PosInputSurface *self, PosCompleter *completer)
                       G_CALLBACK (on_completer_commit_string), self,
                       "swapped-signal::update",
                       G_CALLBACK (on_completer_update), self,
+                      "swapped-signal::loading-changed",
+                      G_CALLBACK (on_completer_loading_changed), self,
                       NULL);
   } else {
     g_debug ("Removing completer");
@@ -1000,6 +1245,25 @@ update_osk_features (gpointer key, gpointer value, gpointer data)
 }
 
 
+static void
+flush_osk_render_caches (gpointer key, gpointer value, gpointer data)
+{
+  pos_osk_widget_flush_render_caches (POS_OSK_WIDGET (value));
+}
+
+
+static void
+on_theme_name_changed (PosInputSurface *self)
+{
+  /* Already destroyed */
+  if (self->osks == NULL)
+    return;
+
+  g_hash_table_foreach (self->osks, flush_osk_render_caches, self);
+  pos_osk_widget_flush_render_caches (POS_OSK_WIDGET (self->osk_terminal));
+}
+
+
 static void
 pos_input_surface_set_osk_features (PosInputSurface *self, PhoshOskFeatures osk_features)
 {
@@ -1008,6 +1272,10 @@ pos_input_surface_set_osk_features (PosInputSurface *self, PhoshOskFeatures osk_
 
   self->osk_features = osk_features;
   g_hash_table_foreach (self->osks, update_osk_features, self);
+  if (self->input_method) {
+    pos_input_method_set_batch_commits (self->input_method,
+                                        !!(osk_features & PHOSH_OSK_FEATURE_BATCH_COMMITS));
+  }
 
   g_object_notify_by_pspec (G_OBJECT (self), props[PROP_OSK_FEATURES]);
 }
@@ -1205,8 +1473,6 @@ on_im_surrounding_text_changed (PosInputSurface *self, GParamSpec *pspec, PosInp
 {
   const char *text;
   guint anchor, cursor;
-  g_autofree char *before = NULL;
-  g_autofree char *after = NULL;
 
   g_assert (POS_IS_INPUT_SURFACE (self));
   g_assert (POS_IS_INPUT_METHOD (im));
@@ -1216,12 +1482,8 @@ on_im_surrounding_text_changed (PosInputSurface *self, GParamSpec *pspec, PosInp
   if (!pos_input_surface_is_completion_mode (self))
     return;
 
-  before = g_strndup (text, cursor);
-
-  if (text)
-    after = g_strdup (&(text[cursor]));
-
-  pos_completer_set_surrounding_text (POS_COMPLETER (self->completer), before, after);
+  /* The text is only borrowed so completers can check for changes without copies */
+  pos_completer_update_surrounding_text (POS_COMPLETER (self->completer), text, cursor);
 }
 
 
@@ -1289,6 +1551,8 @@ pos_input_surface_constructed (GObject *object)
                     "swapped-object-signal::notify::surrounding-text",
                     on_im_surrounding_text_changed, self,
                     NULL);
+  pos_input_method_set_batch_commits (self->input_method,
+                                      !!(self->osk_features & PHOSH_OSK_FEATURE_BATCH_COMMITS));
 
   set_keymap (self);
 
@@ -1331,12 +1595,16 @@ pos_input_surface_finalize (GObject *object)
   g_clear_object (&self->input_settings);
   g_clear_object (&self->osk_settings);
   g_clear_object (&self->xkbinfo);
+  g_cancellable_cancel (self->clipboard_cancel);
+  g_clear_object (&self->clipboard_cancel);
   g_clear_object (&self->clipboard_manager);
   g_clear_object (&self->completer);
   g_clear_object (&self->completer_manager);
   g_clear_object (&self->swipe_down);
   g_clear_object (&self->style_manager);
   g_clear_pointer (&self->osks, g_hash_table_destroy);
+  g_queue_clear_full (&self->osk_lru, g_free);
+  g_string_free (self->emoji_query, TRUE);
 
   G_OBJECT_CLASS (pos_input_surface_parent_class)->finalize (object);
 }
@@ -1508,6 +1776,7 @@ pos_input_surface_class_init (PosInputSurfaceClass *klass)
   gtk_widget_class_bind_template_child (widget_class, PosInputSurface, completion_bar);
   gtk_widget_class_bind_template_child (widget_class, PosInputSurface, deck);
   gtk_widget_class_bind_template_child (widget_class, PosInputSurface, emoji_picker);
+  gtk_widget_class_bind_template_child (widget_class, PosInputSurface, emoji_search_entry);
   gtk_widget_class_bind_template_child (widget_class, PosInputSurface, keypad);
   gtk_widget_class_bind_template_child (widget_class, PosInputSurface, menu_box_layouts);
   gtk_widget_class_bind_template_child (widget_class, PosInputSurface, menu_popup);
@@ -1516,6 +1785,7 @@ pos_input_surface_class_init (PosInputSurfaceClass *klass)
   gtk_widget_class_bind_template_child (widget_class, PosInputSurface, word_completion_btn);
   gtk_widget_class_bind_template_callback (widget_class, on_completion_selected);
   gtk_widget_class_bind_template_callback (widget_class, on_emoji_picked);
+  gtk_widget_class_bind_template_callback (widget_class, on_emoji_picker_search);
   gtk_widget_class_bind_template_callback (widget_class, on_emoji_picker_done);
   gtk_widget_class_bind_template_callback (widget_class, on_emoji_picker_delete_last);
 
@@ -1526,6 +1796,7 @@ pos_input_surface_class_init (PosInputSurfaceClass *klass)
   gtk_widget_class_bind_template_callback (widget_class, on_num_shortcuts_changed);
   gtk_widget_class_bind_template_callback (widget_class, on_osk_key_down);
   gtk_widget_class_bind_template_callback (widget_class, on_osk_key_symbol);
+  gtk_widget_class_bind_template_callback (widget_class, on_osk_key_up);
   gtk_widget_class_bind_template_callback (widget_class, on_osk_mode_changed);
   gtk_widget_class_bind_template_callback (widget_class, on_osk_popover_shown);
   gtk_widget_class_bind_template_callback (widget_class, on_osk_popover_hidden);
@@ -1689,6 +1960,7 @@ insert_osk (PosInputSurface   *self,
   gtk_widget_set_visible (GTK_WIDGET (osk_widget), TRUE);
   g_object_connect (osk_widget,
                     "swapped-signal::key-down", G_CALLBACK (on_osk_key_down), self,
+                    "swapped-signal::key-up", G_CALLBACK (on_osk_key_up), self,
                     "swapped-signal::key-symbol", G_CALLBACK (on_osk_key_symbol), self,
                     "swapped-signal::notify::mode", G_CALLBACK (on_osk_mode_changed), self,
                     "swapped-signal::popover-shown", G_CALLBACK (on_osk_popover_shown), self,
@@ -1905,6 +2177,10 @@ pos_input_surface_init (PosInputSurface *self)
 
   self->osks = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
                                       (GDestroyNotify)gtk_widget_destroy);
+  self->emoji_query = g_string_new (NULL);
+  g_signal_connect_object (self->style_manager, "notify::theme-name",
+                           G_CALLBACK (on_theme_name_changed), self,
+                           G_CONNECT_SWAPPED);
   self->xkbinfo = gnome_xkb_info_new ();
   self->input_settings = g_settings_new ("org.gnome.desktop.input-sources");
   self->osk_settings = g_settings_new ("sm.puri.phosh.osk");
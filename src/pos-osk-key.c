@@ -31,24 +31,65 @@ static GParamSpec *props[PROP_LAST_PROP];
  * PosOskKey:
  *
  * A key on the osk widget
+ *
+ * Keys are created for every layer of every layout so they're kept
+ * small: All strings are interned and thus shared between keys and
+ * layouts. The same applies to the lists of additional symbols.
  */
 struct _PosOskKey {
-  GObject           parent;
-
-  PosOskKeyUse      use;
-  double            width;
-  char             *symbol;
-  GStrv             symbols;
-  char             *label;
-  char             *icon;
-  char             *style;
-  PosOskWidgetLayer layer;
-  GdkRectangle      box;
-  gboolean          expand;
-  gboolean          pressed;
+  GObject                   parent;
+
+  double                    width;
+  GdkRectangle              box;
+  const char               *symbol;
+  const char * const       *symbols;
+  const char               *label;
+  const char               *icon;
+  const char               *style;
+  guint                     use : 4;   /* PosOskKeyUse */
+  guint                     layer : 4; /* PosOskWidgetLayer */
+  guint                     expand : 1;
+  guint                     pressed : 1;
 };
 G_DEFINE_TYPE (PosOskKey, pos_osk_key, G_TYPE_OBJECT)
 
+G_LOCK_DEFINE_STATIC (interned_symbols);
+static GHashTable *interned_symbols;
+
+
+static const char * const *
+intern_symbols (const char * const *symbols)
+{
+  g_autofree char *joined = NULL;
+  const char **interned;
+
+  if (symbols == NULL || symbols[0] == NULL)
+    return NULL;
+
+  joined = g_strjoinv ("\x1f", (GStrv)symbols);
+
+  G_LOCK (interned_symbols);
+
+  if (interned_symbols == NULL)
+    interned_symbols = g_hash_table_new (g_str_hash, g_str_equal);
+
+  interned = g_hash_table_lookup (interned_symbols, joined);
+  if (interned == NULL) {
+    guint n = g_strv_length ((GStrv)symbols);
+
+    interned = g_new (const char *, n + 1);
+    for (guint i = 0; i < n; i++)
+      interned[i] = g_intern_string (symbols[i]);
+    interned[n] = NULL;
+
+    g_hash_table_insert (interned_symbols, (gpointer)g_intern_string (joined), interned);
+  }
+
+  G_UNLOCK (interned_symbols);
+
+  return interned;
+}
+
 
 static void
 pos_osk_key_set_property (GObject      *object,
@@ -66,19 +107,19 @@ pos_osk_key_set_property (GObject      *object,
     pos_osk_key_set_width (self, g_value_get_double (value));
     break;
   case PROP_SYMBOL:
-    self->symbol = g_value_dup_string (value);
+    self->symbol = g_intern_string (g_value_get_string (value));
     break;
   case PROP_SYMBOLS:
-    self->symbols = g_value_dup_boxed (value);
+    self->symbols = intern_symbols (g_value_get_boxed (value));
     break;
   case PROP_LABEL:
-    self->label = g_value_dup_string (value);
+    self->label = g_intern_string (g_value_get_string (value));
     break;
   case PROP_ICON:
-    self->icon = g_value_dup_string (value);
+    self->icon = g_intern_string (g_value_get_string (value));
     break;
   case PROP_STYLE:
-    self->style = g_value_dup_string (value);
+    self->style = g_intern_string (g_value_get_string (value));
     break;
   case PROP_LAYER:
     self->layer = g_value_get_enum (value);
@@ -106,7 +147,7 @@ pos_osk_key_get_property (GObject    *object,
 
   switch (property_id) {
   case PROP_USE:
-    g_value_set_boolean (value, self->use);
+    g_value_set_enum (value, self->use);
     break;
   case PROP_WIDTH:
     g_value_set_double (value, self->width);
@@ -141,20 +182,6 @@ pos_osk_key_get_property (GObject    *object,
   }
 }
 
-static void
-pos_osk_key_finalize (GObject *object)
-{
-  PosOskKey *self = POS_OSK_KEY (object);
-
-  g_clear_pointer (&self->symbols, g_strfreev);
-  g_clear_pointer (&self->symbol, g_free);
-  g_clear_pointer (&self->label, g_free);
-  g_clear_pointer (&self->icon, g_free);
-  g_clear_pointer (&self->style, g_free);
-
-  G_OBJECT_CLASS (pos_osk_key_parent_class)->finalize (object);
-}
-
 
 static void
 pos_osk_key_class_init (PosOskKeyClass *klass)
@@ -163,7 +190,6 @@ pos_osk_key_class_init (PosOskKeyClass *klass)
 
   object_class->get_property = pos_osk_key_get_property;
   object_class->set_property = pos_osk_key_set_property;
-  object_class->finalize = pos_osk_key_finalize;
 
   /**
    * PosOskKey:use
@@ -392,7 +418,25 @@ pos_osk_key_get_symbols (PosOskKey *self)
 {
   g_return_val_if_fail (POS_IS_OSK_KEY (self), NULL);
 
-  return self->symbols;
+  return (GStrv)self->symbols;
+}
+
+
+const char *
+pos_osk_key_get_icon (PosOskKey *self)
+{
+  g_return_val_if_fail (POS_IS_OSK_KEY (self), NULL);
+
+  return self->icon;
+}
+
+
+const char *
+pos_osk_key_get_style (PosOskKey *self)
+{
+  g_return_val_if_fail (POS_IS_OSK_KEY (self), NULL);
+
+  return self->style;
 }
 
 
@@ -22,6 +22,7 @@
 #include <json-glib/json-glib.h>
 #include <pango/pangocairo.h>
 
+#include <float.h>
 #include <math.h>
 
 #define KEY_HEIGHT 50
@@ -33,6 +34,12 @@
 
 #define MINIMUM_WIDTH 360
 
+/* See tools/compile-layout.py */
+#define COMPILED_LAYOUT_TYPE "(ssa(saa(sssas)))"
+
+/* Width in pixels of a hit test grid cell, must be smaller than any key */
+#define HIT_CELL_WIDTH 4
+
 #define KEY_REPEAT_DELAY 700
 #define KEY_REPEAT_INTERVAL 50
 
@@ -61,6 +68,9 @@ static GParamSpec *props[PROP_LAST_PROP];
  * PosOskWidgetRow:
  * @width: number in key units
  * @offset_x: offset from the right in key units
+ * @hit_cells: For each %HIT_CELL_WIDTH wide column of the layer the index
+ *   of the first key that ends right of the column's start
+ * @n_hit_cells: Number of elements in @hit_cells
  *
  * A key row on a #PosOskWidgetKeyboardLayer of the #PosOskWidget.
  * Renders the keys and reacts to touch and pointer events. Much
@@ -70,6 +80,8 @@ typedef struct {
   GPtrArray *keys;
   double     width;
   double     offset_x;
+  guint8    *hit_cells;
+  guint      n_hit_cells;
 } PosOskWidgetRow;
 
 /**
@@ -109,8 +121,33 @@ typedef struct {
   guint                     n_cols;
   guint                     n_rows;
   double                    width;
+  /* Symbols of all popovers, built on demand */
+  GPtrArray                *popover_symbols;
 } PosOskWidgetLayout;
 
+/*
+ * Shaped labels are cached per text, font, layout width and scale
+ * factor. A width of -1 means the layout isn't width constrained.
+ */
+typedef struct {
+  char                 *text;
+  PangoFontDescription *font;
+  int                   width;
+  int                   scale;
+} PosOskWidgetLabelKey;
+
+/*
+ * Symbolic icons are cached per name, size, scale factor and the
+ * style state and foreground color they got recolored with.
+ */
+typedef struct {
+  char                 *name;
+  int                   size;
+  int                   scale;
+  GtkStateFlags         state;
+  GdkRGBA               color;
+} PosOskWidgetIconKey;
+
 /**
  * PosOskWidget:
  * @name: The name of the layout, e.g. `de`, `us`, `de+ch`
@@ -126,10 +163,19 @@ struct _PosOskWidget {
   PhoshOskFeatures     features;
   int                  width, height;
   PosOskWidgetLayout   layout;
+  /* Compiled layout, keys are built from it on first use */
+  GBytes              *layout_data;
+  gboolean             keys_loaded;
 
   GtkStyleContext     *key_context;
   PosOskWidgetLayer    layer;
   PosOskWidgetMode     mode;
+  /* Unpressed rendering of each layer, rebuilt lazily on draw */
+  cairo_surface_t     *layer_surfaces[POS_OSK_WIDGET_LAST_LAYER + 1];
+  /* PosOskWidgetLabelKey -> PangoLayout */
+  GHashTable          *label_cache;
+  /* PosOskWidgetIconKey -> cairo_surface_t */
+  GHashTable          *icon_cache;
   /* Contains pointers to key symbols (keys have ownership) */
   GPtrArray           *symbols;
   gboolean             caps_lock;
@@ -274,22 +320,36 @@ pos_osk_widget_row_get_key (PosOskWidgetRow *row, guint n)
 
 
 static void
-pos_osk_widget_layout_free (PosOskWidgetLayout *layout)
+pos_osk_widget_layout_free_keys (PosOskWidgetLayout *layout)
 {
-  g_clear_pointer (&layout->name, g_free);
-  g_clear_pointer (&layout->locale, g_free);
+  g_clear_pointer (&layout->popover_symbols, g_ptr_array_unref);
 
-  for (int l = 0; l < layout->n_layers; l++) {
-    for (int r = 0; r < layout->n_rows; r++) {
+  /* Layers are indexed by type, not by their position in the layout file */
+  for (int l = 0; l <= POS_OSK_WIDGET_LAST_LAYER; l++) {
+    for (int r = 0; r < LAYOUT_MAX_ROWS; r++) {
       if (layout->layers[l].rows[r].keys) {
         g_ptr_array_free (layout->layers[l].rows[r].keys, TRUE);
         layout->layers[l].rows[r].keys = NULL;
       }
+      g_clear_pointer (&layout->layers[l].rows[r].hit_cells, g_free);
+      layout->layers[l].rows[r].n_hit_cells = 0;
     }
+    layout->layers[l].width = 0.0;
+    layout->layers[l].n_rows = 0;
   }
 }
 
 
+static void
+pos_osk_widget_layout_free (PosOskWidgetLayout *layout)
+{
+  g_clear_pointer (&layout->name, g_free);
+  g_clear_pointer (&layout->locale, g_free);
+
+  pos_osk_widget_layout_free_keys (layout);
+}
+
+
 static void
 add_common_keys_post (PosOskWidgetRow *row, PosOskWidgetLayer layer, gint rownum, guint max_rows)
 {
@@ -452,28 +512,15 @@ parse_row (PosOskWidget      *self,
 
 
 
-static gboolean
-parse_rows (PosOskWidget *self, PosOskWidgetKeyboardLayer *layer, JsonArray *rows, PosOskWidgetLayer l)
+/* Expand and center the rows once all of a layer's keys are known */
+static void
+finish_layer (PosOskWidget *self, PosOskWidgetKeyboardLayer *layer, PosOskWidgetLayer l)
 {
-  gsize num_rows;
-  gboolean ret = FALSE;
+  guint num_rows = layer->n_rows;
   gdouble max_width = 0.0;
 
-  num_rows = json_array_get_length (rows);
-  layer->n_rows = num_rows;
-
   for (int r = 0; r < num_rows; r++) {
-    PosOskWidgetRow *row;
-    JsonArray *arow;
-
-    row = pos_osk_widget_get_layer_row (self, l, r);
-    arow = json_array_get_array_element (rows, r);
-    if (arow == NULL) {
-      g_warning ("Failed to get row %d", r);
-      ret = FALSE;
-      continue;
-    }
-    parse_row (self, row, arow, l, r, layer->n_rows);
+    PosOskWidgetRow *row = pos_osk_widget_get_layer_row (self, l, r);
 
     max_width = MAX (row->width, max_width);
   }
@@ -486,7 +533,7 @@ parse_rows (PosOskWidget *self, PosOskWidgetKeyboardLayer *layer, JsonArray *row
     PosOskKey *expand_key = NULL;
 
     /* Find possible key to expand */
-    for (int k = 0; k < row->keys->len; k++) {
+    for (int k = 0; k < pos_osk_widget_row_get_num_keys (row); k++) {
       PosOskKey *key = g_ptr_array_index (row->keys, k);
 
       if (pos_osk_key_get_expand (key)) {
@@ -511,19 +558,85 @@ parse_rows (PosOskWidget *self, PosOskWidgetKeyboardLayer *layer, JsonArray *row
 
     row->offset_x = 0.5 * (layer->width - row->width);
   }
+}
+
+
+static gboolean
+parse_rows (PosOskWidget *self, PosOskWidgetKeyboardLayer *layer, JsonArray *rows, PosOskWidgetLayer l)
+{
+  gsize num_rows;
+  gboolean ret = FALSE;
+
+  num_rows = json_array_get_length (rows);
+  layer->n_rows = num_rows;
+
+  for (int r = 0; r < num_rows; r++) {
+    PosOskWidgetRow *row;
+    JsonArray *arow;
+
+    row = pos_osk_widget_get_layer_row (self, l, r);
+    arow = json_array_get_array_element (rows, r);
+    if (arow == NULL) {
+      g_warning ("Failed to get row %d", r);
+      ret = FALSE;
+      continue;
+    }
+    parse_row (self, row, arow, l, r, layer->n_rows);
+  }
+
+  finish_layer (self, layer, l);
 
   return ret;
 }
 
 
+static gboolean
+parse_level_name (const char *name, PosOskWidgetLayer *ltype)
+{
+  if (g_strcmp0 (name, "")  == 0) {
+    *ltype = POS_OSK_WIDGET_LAYER_NORMAL;
+  } else if (g_strcmp0 (name, "shift")  == 0) {
+    *ltype = POS_OSK_WIDGET_LAYER_CAPS;
+  } else if (g_strcmp0 (name, "opt")  == 0) {
+    *ltype = POS_OSK_WIDGET_LAYER_SYMBOLS;
+  } else if (g_strcmp0 (name, "opt+shift")  == 0) {
+    *ltype = POS_OSK_WIDGET_LAYER_SYMBOLS2;
+  } else {
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+
+/* Sum up the layout's dimensions once all layers are parsed */
+static void
+finish_layout (PosOskWidget *self, guint n_layers)
+{
+  double width = 0.0;
+  guint max_rows = 0;
+
+  for (int l = 0; l <= POS_OSK_WIDGET_LAST_LAYER; l++) {
+    PosOskWidgetKeyboardLayer *layer = pos_osk_widget_get_keyboard_layer (self, l);
+
+    width = MAX (layer->width, width);
+    max_rows = MAX (max_rows, layer->n_rows);
+  }
+
+  self->layout.n_layers = n_layers;
+  self->layout.n_cols = ceil (width);
+  self->layout.n_rows = max_rows;
+
+  g_debug ("Using %ux%u layout, %d layers", self->layout.n_cols, self->layout.n_rows, self->layout.n_layers);
+}
+
+
 static gboolean
 parse_layers (PosOskWidget *self, JsonArray *layers)
 {
   gsize len;
   JsonArray *rows;
   gboolean ret = FALSE;
-  double width = 0.0;
-  guint max_rows = 0;
 
   len = json_array_get_length (layers);
   for (int l = len-1; l >= 0; l--) {
@@ -552,15 +665,7 @@ parse_layers (PosOskWidget *self, JsonArray *layers)
     }
 
     name = json_object_get_string_member (alayer, "level");
-    if (g_strcmp0 (name, "")  == 0) {
-      ltype = POS_OSK_WIDGET_LAYER_NORMAL;
-    } else if (g_strcmp0 (name, "shift")  == 0) {
-      ltype = POS_OSK_WIDGET_LAYER_CAPS;
-    } else if (g_strcmp0 (name, "opt")  == 0) {
-      ltype = POS_OSK_WIDGET_LAYER_SYMBOLS;
-    } else if (g_strcmp0 (name, "opt+shift")  == 0) {
-      ltype = POS_OSK_WIDGET_LAYER_SYMBOLS2;
-    } else {
+    if (!parse_level_name (name, &ltype)) {
       g_warning ("Unknown layer '%s' at %d", name, l);
       ret = FALSE;
       continue;
@@ -568,16 +673,9 @@ parse_layers (PosOskWidget *self, JsonArray *layers)
 
     layer = pos_osk_widget_get_keyboard_layer (self, ltype);
     parse_rows (self, layer, rows, ltype);
-    width = MAX (layer->width, width);
-
-    max_rows = MAX (max_rows, layer->n_rows);
   }
 
-  self->layout.n_layers = len;
-  self->layout.n_cols = ceil (width);
-  self->layout.n_rows = max_rows;
-
-  g_debug ("Using %ux%u layout, %d layers", self->layout.n_cols, self->layout.n_rows, self->layout.n_layers);
+  finish_layout (self, len);
 
   return ret;
 }
@@ -629,6 +727,151 @@ parse_layout (PosOskWidget *self, const char *json, gsize size)
 }
 
 
+static void
+load_compiled_row (PosOskWidget      *self,
+                   PosOskWidgetRow   *row,
+                   GVariant          *vrow,
+                   PosOskWidgetLayer  l,
+                   guint              r,
+                   guint              max_rows)
+{
+  gsize num_keys;
+
+  num_keys = g_variant_n_children (vrow);
+  row->keys = g_ptr_array_sized_new (num_keys + 2);
+  g_ptr_array_set_free_func (row->keys, g_object_unref);
+
+  row->width = 0.0;
+  for (gsize i = 0; i < num_keys; i++) {
+    g_autoptr (GVariant) vkey = g_variant_get_child_value (vrow, i);
+    g_autofree const char **symbols = NULL;
+    const char *symbol, *label, *style;
+    PosOskKey *key;
+
+    /* Strings point into the mapped resource, keys copy what they need */
+    g_variant_get (vkey, "(&s&s&s^a&s)", &symbol, &label, &style, &symbols);
+    key = get_key (self,
+                   symbol,
+                   symbols[0] ? (GStrv)symbols : NULL,
+                   label[0] ? label : NULL,
+                   style[0] ? style : NULL,
+                   num_keys);
+
+    row->width += pos_osk_key_get_width (key);
+    g_ptr_array_add (self->symbols, (gpointer)pos_osk_key_get_symbol (key));
+    g_ptr_array_add (row->keys, key);
+  }
+
+  add_common_keys_pre (self, row, l, r, max_rows);
+  add_common_keys_post (row, l, r, max_rows);
+}
+
+/*
+ * load_compiled_header:
+ * @self: The osk widget
+ * @data: The layout as compiled by `tools/compile-layout.py`
+ *
+ * Reads name, locale and number of rows of a precompiled layout. See
+ * the compiler for a description of the format. The data is used in
+ * place so layouts stored uncompressed in the resource aren't copied.
+ * The keys are only built once needed by load_compiled_keys().
+ */
+static gboolean
+load_compiled_header (PosOskWidget *self, GBytes *data)
+{
+  g_autoptr (GVariant) layout = NULL;
+  g_autoptr (GVariant) levels = NULL;
+  const char *name, *locale;
+  guint n_rows = 0;
+
+  layout = g_variant_new_from_bytes (G_VARIANT_TYPE (COMPILED_LAYOUT_TYPE), data, FALSE);
+  g_variant_get (layout, "(&s&s@a(saa(sssas)))", &name, &locale, &levels);
+
+  if (STR_IS_NULL_OR_EMPTY (name)) {
+    g_critical ("Failed to load layout without name");
+    return FALSE;
+  }
+  self->layout.name = g_strdup (name);
+
+  if (!STR_IS_NULL_OR_EMPTY (locale))
+    self->layout.locale = g_strdup (locale);
+
+  for (gsize l = 0; l < g_variant_n_children (levels); l++) {
+    g_autoptr (GVariant) level = g_variant_get_child_value (levels, l);
+    g_autoptr (GVariant) rows = g_variant_get_child_value (level, 1);
+
+    n_rows = MAX (n_rows, g_variant_n_children (rows));
+  }
+  self->layout.n_rows = MIN (n_rows, LAYOUT_MAX_ROWS);
+
+  return TRUE;
+}
+
+
+static void
+load_compiled_keys (PosOskWidget *self, GBytes *data)
+{
+  g_autoptr (GVariant) layout = NULL;
+  g_autoptr (GVariant) levels = NULL;
+  gsize n_levels;
+
+  layout = g_variant_new_from_bytes (G_VARIANT_TYPE (COMPILED_LAYOUT_TYPE), data, FALSE);
+  levels = g_variant_get_child_value (layout, 2);
+
+  /* Like for JSON go backwards so the caps layer is known when adding shift keys */
+  n_levels = g_variant_n_children (levels);
+  for (int l = n_levels - 1; l >= 0; l--) {
+    g_autoptr (GVariant) level = NULL;
+    g_autoptr (GVariant) rows = NULL;
+    PosOskWidgetKeyboardLayer *layer;
+    PosOskWidgetLayer ltype;
+    const char *level_name;
+
+    if (l > POS_OSK_WIDGET_LAST_LAYER) {
+      g_warning ("Skipping layer %d", l);
+      continue;
+    }
+
+    level = g_variant_get_child_value (levels, l);
+    g_variant_get (level, "(&s@aa(sssas))", &level_name, &rows);
+    if (!parse_level_name (level_name, &ltype)) {
+      g_warning ("Unknown layer '%s' at %d", level_name, l);
+      continue;
+    }
+
+    layer = pos_osk_widget_get_keyboard_layer (self, ltype);
+    layer->n_rows = MIN (g_variant_n_children (rows), LAYOUT_MAX_ROWS);
+    for (int r = 0; r < layer->n_rows; r++) {
+      g_autoptr (GVariant) vrow = g_variant_get_child_value (rows, r);
+      PosOskWidgetRow *row = pos_osk_widget_get_layer_row (self, ltype, r);
+
+      load_compiled_row (self, row, vrow, ltype, r, layer->n_rows);
+    }
+
+    finish_layer (self, layer, ltype);
+  }
+
+  finish_layout (self, n_levels);
+
+  g_ptr_array_add (self->symbols, NULL);
+}
+
+
+/* Layouts the user dropped into the data dir take precedence */
+static char *
+get_user_layout_path (const char *layout, const char *variant)
+{
+  g_autofree char *filename = NULL;
+
+  if (!STR_IS_NULL_OR_EMPTY (variant))
+    filename = g_strdup_printf ("%s+%s.json", layout, variant);
+  else
+    filename = g_strdup_printf ("%s.json", layout);
+
+  return g_build_filename (g_get_user_data_dir (), "phosh-osk-stub", "layouts", filename, NULL);
+}
+
+
 static void
 pos_osk_widget_set_property (GObject      *object,
                              guint         property_id,
@@ -696,11 +939,35 @@ select_symbols2 (PosOskWidget *self, PosOskKey *key)
 static void
 pos_osk_widget_set_key_pressed (PosOskWidget *self, PosOskKey *key, gboolean pressed)
 {
+  PosOskWidgetKeyboardLayer *layer = pos_osk_widget_get_current_layer (self);
   const GdkRectangle *box;
 
+  if (pos_osk_key_get_pressed (key) == pressed)
+    return;
+
   pos_osk_key_set_pressed (key, pressed);
   box = pos_osk_key_get_box (key);
-  gtk_widget_queue_draw_area (GTK_WIDGET (self), box->x, box->y, box->width, box->height);
+  /* Key boxes are relative to the layer, only damage the key itself */
+  gtk_widget_queue_draw_area (GTK_WIDGET (self),
+                              box->x + layer->offset_x, box->y, box->width, box->height);
+}
+
+
+/**
+ * pos_osk_widget_invalidate_layers:
+ * @self: The osk widget
+ *
+ * Drop the cached layer renderings. Needs to be invoked whenever
+ * something affecting the unpressed look of the keys changes (size,
+ * scale, theme, layout or mode).
+ */
+static void
+pos_osk_widget_invalidate_layers (PosOskWidget *self)
+{
+  for (int l = 0; l <= POS_OSK_WIDGET_LAST_LAYER; l++)
+    g_clear_pointer (&self->layer_surfaces[l], cairo_surface_destroy);
+
+  gtk_widget_queue_draw (GTK_WIDGET (self));
 }
 
 
@@ -753,32 +1020,99 @@ set_caps_lock (PosOskWidget *self, gboolean caps_lock)
 }
 
 
+/* Build the hit test grid for a row whose key boxes are already set up */
+static void
+pos_osk_widget_row_build_hit_cells (PosOskWidgetRow *row, int width)
+{
+  guint n_keys = pos_osk_widget_row_get_num_keys (row);
+  guint k = 0;
+
+  g_clear_pointer (&row->hit_cells, g_free);
+  row->n_hit_cells = 0;
+
+  if (n_keys == 0 || width <= 0)
+    return;
+
+  g_return_if_fail (n_keys <= G_MAXUINT8 + 1);
+
+  row->n_hit_cells = width / HIT_CELL_WIDTH + 1;
+  row->hit_cells = g_new (guint8, row->n_hit_cells);
+
+  for (guint c = 0; c < row->n_hit_cells; c++) {
+    int x = c * HIT_CELL_WIDTH;
+
+    while (k < n_keys - 1) {
+      const GdkRectangle *box = pos_osk_key_get_box (g_ptr_array_index (row->keys, k));
+
+      if (box->x + box->width > x)
+        break;
+      k++;
+    }
+    row->hit_cells[c] = k;
+  }
+}
+
+/**
+ * pos_osk_widget_locate_key:
+ * @self: The osk widget
+ * @x: The x coordinate in widget coordinates
+ * @y: The y coordinate in widget coordinates
+ * @distance:(out)(nullable): The distance in pixels of the given point to the key
+ *
+ * Finds the key at the given position using the hit test grid set up
+ * in size allocate. If there's no key at the given position the nearest one is
+ * returned and @distance is set to the distance between the point and the
+ * key's box. @distance is `0.0` if the key contains the point.
+ *
+ * Returns:(transfer none)(nullable): The key
+ */
 static PosOskKey *
-pos_osk_widget_locate_key (PosOskWidget *self, double x, double y)
+pos_osk_widget_locate_key (PosOskWidget *self, double x, double y, double *distance)
 {
-  int row_num;
+  int row_num, n_rows, cell;
   PosOskWidgetRow *row;
-  PosOskKey *key = NULL;
-  double pos_x;
+  PosOskKey *key;
+  const GdkRectangle *box;
+  double pos_x, dx = 0.0, dy = 0.0;
+  guint k;
   PosOskWidgetKeyboardLayer *layer = pos_osk_widget_get_current_layer (self);
   guint off_y = self->height - (layer->n_rows * layer->key_height);
 
-  pos_x = x - layer->offset_x;
+  n_rows = MIN (layer->n_rows, self->layout.n_rows);
+  g_return_val_if_fail (n_rows > 0, NULL);
 
-  row_num = (int)((y - off_y) / layer->key_height);
-  g_return_val_if_fail (row_num < self->layout.n_rows, NULL);
+  row_num = (int)floor ((y - off_y) / layer->key_height);
+  row_num = CLAMP (row_num, 0, n_rows - 1);
 
   row = pos_osk_widget_get_row (self, row_num);
-  pos_x -= row->offset_x * layer->key_width;
-  for (int k = 0; k < pos_osk_widget_row_get_num_keys (row); k++) {
-    key = pos_osk_widget_row_get_key (row, k);
+  g_return_val_if_fail (row->n_hit_cells > 0, NULL);
+
+  pos_x = x - layer->offset_x;
+  cell = (int)floor (pos_x / HIT_CELL_WIDTH);
+  cell = CLAMP (cell, 0, (int)row->n_hit_cells - 1);
+  k = row->hit_cells[cell];
 
-    pos_x -= pos_osk_key_get_width (key) * layer->key_width;
-    if (pos_x <= 0)
-      break;
+  key = pos_osk_widget_row_get_key (row, k);
+  box = pos_osk_key_get_box (key);
+  /* The cell can span the boundary to the next key */
+  if (pos_x >= box->x + box->width && k + 1 < pos_osk_widget_row_get_num_keys (row)) {
+    key = pos_osk_widget_row_get_key (row, k + 1);
+    box = pos_osk_key_get_box (key);
   }
 
-  g_return_val_if_fail (key != NULL, NULL);
+  if (distance) {
+    if (pos_x < box->x)
+      dx = box->x - pos_x;
+    else if (pos_x > box->x + box->width)
+      dx = pos_x - (box->x + box->width);
+
+    if (y < box->y)
+      dy = box->y - y;
+    else if (y > box->y + box->height)
+      dy = y - (box->y + box->height);
+
+    *distance = sqrt (dx * dx + dy * dy);
+  }
 
   return key;
 }
@@ -791,8 +1125,10 @@ on_key_repeat (gpointer data)
 
   g_return_val_if_fail (self->current, G_SOURCE_REMOVE);
 
-  g_signal_emit (self, signals[OSK_KEY_DOWN], 0, pos_osk_key_get_symbol (self->current));
-  g_signal_emit (self, signals[OSK_KEY_UP], 0, pos_osk_key_get_symbol (self->current));
+  g_signal_emit (self, signals[OSK_KEY_DOWN], 0, pos_osk_key_get_symbol (self->current),
+                 (guint32)GDK_CURRENT_TIME);
+  g_signal_emit (self, signals[OSK_KEY_UP], 0, pos_osk_key_get_symbol (self->current),
+                 (guint32)GDK_CURRENT_TIME);
   g_signal_emit (self, signals[OSK_KEY_SYMBOL], 0, pos_osk_key_get_symbol (self->current));
 
   return G_SOURCE_CONTINUE;
@@ -819,28 +1155,28 @@ key_repeat_cancel (PosOskWidget *self)
 
 
 static void
-pos_osk_widget_key_press_action (PosOskWidget *self, PosOskKey *key)
+pos_osk_widget_key_press_action (PosOskWidget *self, PosOskKey *key, guint32 time)
 {
   self->current = key;
   pos_osk_widget_set_key_pressed (self, key, TRUE);
 
-  g_signal_emit (self, signals[OSK_KEY_DOWN], 0, pos_osk_key_get_symbol (key));
+  g_signal_emit (self, signals[OSK_KEY_DOWN], 0, pos_osk_key_get_symbol (key), time);
 }
 
 
 static gboolean
-pos_osk_widget_key_press (PosOskWidget *self, double x, double y)
+pos_osk_widget_key_press (PosOskWidget *self, double x, double y, guint32 time)
 {
   PosOskKey *key = NULL;
 
-  key = pos_osk_widget_locate_key (self, x, y);
+  key = pos_osk_widget_locate_key (self, x, y, NULL);
   g_return_val_if_fail (key != NULL, GDK_EVENT_PROPAGATE);
 
   if (self->current) {
     g_warning ("Got button press event for %s while another key %s is pressed",
                POS_OSK_KEY_DBG (key), POS_OSK_KEY_DBG (self->current));
   }
-  pos_osk_widget_key_press_action (self, key);
+  pos_osk_widget_key_press_action (self, key, time);
 
   if (pos_osk_key_get_use (key) == POS_OSK_KEY_USE_DELETE) {
     self->repeat_id = g_timeout_add (KEY_REPEAT_DELAY, on_repeat_timeout, self);
@@ -862,7 +1198,7 @@ pos_osk_widget_button_press_event (GtkWidget *widget, GdkEventButton *event)
   if (event->type != GDK_BUTTON_PRESS)
     return GDK_EVENT_PROPAGATE;
 
-  pos_osk_widget_key_press (self, event->x, event->y);
+  pos_osk_widget_key_press (self, event->x, event->y, event->time);
 
   return GDK_EVENT_STOP;
 }
@@ -890,12 +1226,12 @@ pos_osk_widget_show_menu (PosOskWidget *self, PosOskKey *key)
   g_variant_builder_add_value (&builder, g_variant_new ("i", rect.x));
   g_variant_builder_add_value (&builder, g_variant_new ("i", rect.y));
   g_action_group_activate_action (group, "menu", g_variant_builder_end (&builder));
-  pos_osk_key_set_pressed (key, FALSE);
+  pos_osk_widget_set_key_pressed (self, key, FALSE);
 }
 
 
 static void
-pos_osk_widget_key_release_action (PosOskWidget *self, PosOskKey *key)
+pos_osk_widget_key_release_action (PosOskWidget *self, PosOskKey *key, guint32 time)
 {
   switch (pos_osk_key_get_use (key)) {
   case POS_OSK_KEY_USE_TOGGLE:
@@ -905,7 +1241,7 @@ pos_osk_widget_key_release_action (PosOskWidget *self, PosOskKey *key)
   case POS_OSK_KEY_USE_DELETE:
   case POS_OSK_KEY_USE_KEY:
     pos_osk_widget_set_key_pressed (self, self->current, FALSE);
-    g_signal_emit (self, signals[OSK_KEY_UP], 0, pos_osk_key_get_symbol (key));
+    g_signal_emit (self, signals[OSK_KEY_UP], 0, pos_osk_key_get_symbol (key), time);
     g_signal_emit (self, signals[OSK_KEY_SYMBOL], 0, pos_osk_key_get_symbol (key));
     switch_layer (self, key);
     break;
@@ -940,10 +1276,10 @@ pos_osk_widget_button_release_event (GtkWidget *widget, GdkEventButton *event)
   if (self->current == NULL)
     return GDK_EVENT_PROPAGATE;
 
-  key = pos_osk_widget_locate_key (self, event->x, event->y);
+  key = pos_osk_widget_locate_key (self, event->x, event->y, NULL);
   g_return_val_if_fail (key != NULL, GDK_EVENT_PROPAGATE);
 
-  pos_osk_widget_key_release_action (self, key);
+  pos_osk_widget_key_release_action (self, key, event->time);
 
   return GDK_EVENT_STOP;
 }
@@ -978,11 +1314,11 @@ pos_osk_widget_touch_event (GtkWidget *widget, GdkEventTouch *event)
     if (self->current) {
       key_repeat_cancel (self);
       pos_osk_widget_set_mode (self, POS_OSK_WIDGET_MODE_KEYBOARD);
-      pos_osk_widget_key_release_action (self, self->current);
+      pos_osk_widget_key_release_action (self, self->current, event->time);
     }
 
     self->sequence = event->sequence;
-    pos_osk_widget_key_press (self, event->x, event->y);
+    pos_osk_widget_key_press (self, event->x, event->y, event->time);
     return GDK_EVENT_STOP;
   }
 
@@ -993,24 +1329,26 @@ pos_osk_widget_touch_event (GtkWidget *widget, GdkEventTouch *event)
     if (self->current) {
       key_repeat_cancel (self);
       pos_osk_widget_set_mode (self, POS_OSK_WIDGET_MODE_KEYBOARD);
-      pos_osk_widget_key_release_action (self, self->current);
+      pos_osk_widget_key_release_action (self, self->current, event->time);
     }
   } else if (event->type == GDK_TOUCH_UPDATE) {
     PosOskKey *key;
+    double distance;
 
     if (!self->current)
       return GDK_EVENT_PROPAGATE;
 
-    key = pos_osk_widget_locate_key (self, event->x, event->y);
-    if (self->current && key != self->current) {
+    key = pos_osk_widget_locate_key (self, event->x, event->y, &distance);
+    /* Moving off the keys (e.g. past the widget's border) keeps the current key */
+    if (self->current && key != self->current && G_APPROX_VALUE (distance, 0.0, DBL_EPSILON)) {
       gboolean accept = !!(self->features & PHOSH_OSK_FEATURE_KEY_DRAG);
 
       g_debug ("Crossed key boundary, %s", accept ? "accepting" : "canceling");
       if (accept) {
         /* Handle current key */
-        pos_osk_widget_key_release_action (self, self->current);
+        pos_osk_widget_key_release_action (self, self->current, event->time);
         /* Make the new key current */
-        pos_osk_widget_key_press_action (self, key);
+        pos_osk_widget_key_press_action (self, key, event->time);
         return GDK_EVENT_STOP;
       } else {
         pos_osk_widget_cancel_press (self);
@@ -1028,20 +1366,21 @@ pos_osk_widget_motion_notify_event (GtkWidget *widget, GdkEventMotion *event)
 {
   PosOskWidget *self = POS_OSK_WIDGET (widget);
   PosOskKey *key;
+  double distance;
 
   if ((event->state & GDK_BUTTON1_MASK) == 0)
     return GDK_EVENT_PROPAGATE;
 
-  key = pos_osk_widget_locate_key (self, event->x, event->y);
-  if (self->current && key != self->current) {
+  key = pos_osk_widget_locate_key (self, event->x, event->y, &distance);
+  if (self->current && key != self->current && G_APPROX_VALUE (distance, 0.0, DBL_EPSILON)) {
     gboolean accept = !!(self->features & PHOSH_OSK_FEATURE_KEY_DRAG);
 
     g_debug ("Crossed key boundary, %s", accept ? "accepting" : "canceling");
     if (accept) {
       /* Handle current key */
-      pos_osk_widget_key_release_action (self, self->current);
+      pos_osk_widget_key_release_action (self, self->current, event->time);
       /* Make the new key current */
-      pos_osk_widget_key_press_action (self, key);
+      pos_osk_widget_key_press_action (self, key, event->time);
       return GDK_EVENT_STOP;
     } else {
       pos_osk_widget_cancel_press (self);
@@ -1057,7 +1396,7 @@ on_symbol_selected (PosOskWidget *self, const char *symbol)
 {
   g_debug ("Selected '%s' from popover", symbol);
 
-  g_signal_emit (self, signals[OSK_KEY_DOWN], 0, symbol);
+  g_signal_emit (self, signals[OSK_KEY_DOWN], 0, symbol, (guint32)GDK_CURRENT_TIME);
   g_signal_emit (self, signals[OSK_KEY_SYMBOL], 0, symbol);
   g_clear_pointer (&self->char_popup, phosh_cp_widget_destroy);
 }
@@ -1075,7 +1414,7 @@ static void
 on_long_pressed (GtkGestureLongPress *gesture, double x, double y, gpointer user_data)
 {
   PosOskWidget *self = POS_OSK_WIDGET (user_data);
-  PosOskKey *key = pos_osk_widget_locate_key (self, x, y);
+  PosOskKey *key = pos_osk_widget_locate_key (self, x, y, NULL);
   GStrv symbols = NULL;
   GdkRectangle rect = { 0 };
 
@@ -1121,6 +1460,114 @@ on_long_pressed (GtkGestureLongPress *gesture, double x, double y, gpointer user
 }
 
 
+static guint
+label_key_hash (gconstpointer data)
+{
+  const PosOskWidgetLabelKey *key = data;
+
+  return g_str_hash (key->text) ^ pango_font_description_hash (key->font) ^
+    ((guint)key->width << 8) ^ (guint)key->scale;
+}
+
+
+static gboolean
+label_key_equal (gconstpointer a, gconstpointer b)
+{
+  const PosOskWidgetLabelKey *key_a = a;
+  const PosOskWidgetLabelKey *key_b = b;
+
+  return key_a->width == key_b->width &&
+    key_a->scale == key_b->scale &&
+    g_str_equal (key_a->text, key_b->text) &&
+    pango_font_description_equal (key_a->font, key_b->font);
+}
+
+
+static void
+label_key_free (gpointer data)
+{
+  PosOskWidgetLabelKey *key = data;
+
+  g_free (key->text);
+  pango_font_description_free (key->font);
+  g_free (key);
+}
+
+
+static guint
+icon_key_hash (gconstpointer data)
+{
+  const PosOskWidgetIconKey *key = data;
+
+  return g_str_hash (key->name) ^ gdk_rgba_hash (&key->color) ^
+    ((guint)key->size << 16) ^ ((guint)key->state << 4) ^ (guint)key->scale;
+}
+
+
+static gboolean
+icon_key_equal (gconstpointer a, gconstpointer b)
+{
+  const PosOskWidgetIconKey *key_a = a;
+  const PosOskWidgetIconKey *key_b = b;
+
+  return key_a->size == key_b->size &&
+    key_a->scale == key_b->scale &&
+    key_a->state == key_b->state &&
+    gdk_rgba_equal (&key_a->color, &key_b->color) &&
+    g_str_equal (key_a->name, key_b->name);
+}
+
+
+static void
+icon_key_free (gpointer data)
+{
+  PosOskWidgetIconKey *key = data;
+
+  g_free (key->name);
+  g_free (key);
+}
+
+
+/*
+ * Get a shaped layout for @text. The layout is owned by the widget
+ * and stays valid until the caches get flushed.
+ */
+static PangoLayout *
+pos_osk_widget_get_label_layout (PosOskWidget               *self,
+                                 const char                 *text,
+                                 const PangoFontDescription *font,
+                                 int                         width)
+{
+  PosOskWidgetLabelKey lookup = {
+    .text = (char *)text,
+    .font = (PangoFontDescription *)font,
+    .width = width,
+    .scale = gtk_widget_get_scale_factor (GTK_WIDGET (self)),
+  };
+  PosOskWidgetLabelKey *key;
+  PangoLayout *layout;
+
+  layout = g_hash_table_lookup (self->label_cache, &lookup);
+  if (layout)
+    return layout;
+
+  layout = gtk_widget_create_pango_layout (GTK_WIDGET (self), text);
+  pango_layout_set_font_description (layout, font);
+  pango_layout_set_alignment (layout, PANGO_ALIGN_CENTER);
+  if (width > 0)
+    pango_layout_set_width (layout, PANGO_SCALE * width);
+
+  key = g_new0 (PosOskWidgetLabelKey, 1);
+  key->text = g_strdup (text);
+  key->font = pango_font_description_copy (font);
+  key->width = lookup.width;
+  key->scale = lookup.scale;
+  g_hash_table_insert (self->label_cache, key, layout);
+
+  return layout;
+}
+
+
 static void
 render_outline (cairo_t *cr, GtkStyleContext *context, const GdkRectangle *box)
 {
@@ -1147,9 +1594,13 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC (PangoFontDescription, pango_font_description_free
 
 
 static void
-render_label (cairo_t *cr, GtkStyleContext *context, const char *label, const GdkRectangle *box)
+render_label (PosOskWidget       *self,
+              cairo_t            *cr,
+              GtkStyleContext    *context,
+              const char         *label,
+              const GdkRectangle *box)
 {
-  g_autoptr (PangoLayout) layout = pango_cairo_create_layout (cr);
+  PangoLayout *layout;
   g_autoptr (PangoFontDescription) font = NULL;
   PangoRectangle extents = { 0, };
   GdkRGBA color = {0};
@@ -1159,12 +1610,8 @@ render_label (cairo_t *cr, GtkStyleContext *context, const char *label, const Gd
 
   state = gtk_style_context_get_state (context);
   gtk_style_context_get (context, state, "font", &font, NULL);
-  pango_layout_set_font_description (layout, font);
-
-  pango_layout_set_text (layout, label, -1);
-  pango_layout_set_alignment (layout, PANGO_ALIGN_CENTER);
 
-  pango_layout_set_width (layout, PANGO_SCALE * box->width);
+  layout = pos_osk_widget_get_label_layout (self, label, font, box->width);
   pango_layout_get_extents (layout, NULL, &extents);
 
   cairo_move_to (cr,
@@ -1184,9 +1631,13 @@ render_label (cairo_t *cr, GtkStyleContext *context, const char *label, const Gd
 
 
 static void
-render_hint (cairo_t *cr, GtkStyleContext *context, const char *hint, const GdkRectangle *box)
+render_hint (PosOskWidget       *self,
+             cairo_t            *cr,
+             GtkStyleContext    *context,
+             const char         *hint,
+             const GdkRectangle *box)
 {
-  g_autoptr (PangoLayout) layout = pango_cairo_create_layout (cr);
+  PangoLayout *layout;
   g_autoptr (PangoFontDescription) font = NULL;
   PangoRectangle extents = { 0, };
   GdkRGBA color = {0};
@@ -1203,10 +1654,7 @@ render_hint (cairo_t *cr, GtkStyleContext *context, const char *hint, const GdkR
   gtk_style_context_get (context, state, "font", &font, NULL);
   size = pango_font_description_get_size (font);
   pango_font_description_set_size (font, hint_scale * size);
-  pango_layout_set_font_description (layout, font);
-
-  pango_layout_set_text (layout, hint, -1);
-  pango_layout_set_alignment (layout, PANGO_ALIGN_CENTER);
+  layout = pos_osk_widget_get_label_layout (self, hint, font, -1);
 
   gtk_style_context_get_margin (context, state, &margin);
   gtk_style_context_get_border (context, state, &border);
@@ -1233,52 +1681,64 @@ render_hint (cairo_t *cr, GtkStyleContext *context, const char *hint, const GdkR
 
 
 static void
-render_icon (cairo_t            *cr,
+render_icon (PosOskWidget       *self,
+             cairo_t            *cr,
              GtkStyleContext    *context,
-             GtkIconTheme       *icon_theme,
              const char         *icon,
-             const GdkRectangle *box,
-             int                 scale)
+             const GdkRectangle *box)
 {
-  int icon_size;
+  PosOskWidgetIconKey lookup = { 0, };
+  PosOskWidgetIconKey *key;
   cairo_surface_t *surface;
 
-  g_autoptr (GtkIconInfo) icon_info = NULL;
-  g_autoptr (GdkPixbuf) pixbuf = NULL;
+  lookup.name = (char *)icon;
+  lookup.size = MIN (KEY_ICON_SIZE, box->height / 2);
+  lookup.scale = gtk_widget_get_scale_factor (GTK_WIDGET (self));
+  lookup.state = gtk_style_context_get_state (context);
+  gtk_style_context_get_color (context, lookup.state, &lookup.color);
+
+  surface = g_hash_table_lookup (self->icon_cache, &lookup);
+  if (surface == NULL) {
+    GdkScreen *screen = gtk_widget_get_screen (GTK_WIDGET (self));
+    GtkIconTheme *icon_theme = gtk_icon_theme_get_for_screen (screen);
+    g_autoptr (GtkIconInfo) icon_info = NULL;
+    g_autoptr (GdkPixbuf) pixbuf = NULL;
+    g_autoptr (GError) err = NULL;
+
+    icon_info = gtk_icon_theme_lookup_icon_for_scale (icon_theme, icon, lookup.size,
+                                                      lookup.scale, 0);
+    if (icon_info == NULL) {
+      g_warning ("Icon %s not found", icon);
+      return;
+    }
+
+    pixbuf = gtk_icon_info_load_symbolic_for_context (icon_info, context, NULL, &err);
+    if (pixbuf == NULL) {
+      g_warning ("Failed to load icon %s: %s", icon, err->message);
+      return;
+    }
 
-  icon_size = MIN (KEY_ICON_SIZE, box->height / 2);
-  icon_info = gtk_icon_theme_lookup_icon_for_scale (icon_theme, icon, icon_size, scale, 0);
+    surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, lookup.scale, NULL);
 
-  pixbuf = gtk_icon_info_load_symbolic_for_context (icon_info, context, NULL, NULL);
+    key = g_memdup2 (&lookup, sizeof (lookup));
+    key->name = g_strdup (icon);
+    g_hash_table_insert (self->icon_cache, key, surface);
+  }
 
-  surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale, NULL);
   gtk_render_icon_surface (context, cr, surface,
-                           (box->width - icon_size) / 2,
-                           (box->height - icon_size) / 2);
-  cairo_surface_destroy (surface);
+                           (box->width - lookup.size) / 2,
+                           (box->height - lookup.size) / 2);
 }
 
 
 static void
-draw_key (PosOskWidget *self, PosOskKey *key, cairo_t *cr)
+draw_key (PosOskWidget *self, PosOskKey *key, gboolean pressed, cairo_t *cr)
 {
-  GdkRGBA fg_color;
-  GtkStateFlags state;
   const GdkRectangle *box;
-  g_autofree char *style = NULL;
-  g_autofree char *icon = NULL;
-  g_autofree char *label = NULL;
-  g_autofree char *symbol = NULL;
-  gboolean pressed;
-  double width;
-  int scale;
-
-  scale = gtk_widget_get_scale_factor (GTK_WIDGET (self));
-  state = gtk_style_context_get_state (self->key_context);
-  gtk_style_context_get_color (self->key_context, state, &fg_color);
-
-  g_object_get (key, "style", &style, "pressed", &pressed, "width", &width,
-                "symbol", &symbol, "label", &label, "icon", &icon, NULL);
+  const char *style = pos_osk_key_get_style (key);
+  const char *icon = pos_osk_key_get_icon (key);
+  const char *label = pos_osk_key_get_label (key);
+  const char *symbol = pos_osk_key_get_symbol (key);
 
   if (style)
     gtk_style_context_add_class (self->key_context, style);
@@ -1297,16 +1757,13 @@ draw_key (PosOskWidget *self, PosOskKey *key, cairo_t *cr)
 
   if (self->mode == POS_OSK_WIDGET_MODE_KEYBOARD) {
     if (icon) {
-      GdkScreen *screen = gtk_widget_get_screen (GTK_WIDGET (self));
-      GtkIconTheme *icon_theme = gtk_icon_theme_get_for_screen (screen);
-
-      render_icon (cr, self->key_context, icon_theme, icon, box, scale);
+      render_icon (self, cr, self->key_context, icon, box);
     } else {
       GStrv symbols = pos_osk_key_get_symbols (key);
 
-      render_label (cr, self->key_context, label ?: symbol, box);
+      render_label (self, cr, self->key_context, label ?: symbol, box);
       if (symbols)
-        render_hint (cr, self->key_context, symbols[0], box);
+        render_hint (self, cr, self->key_context, symbols[0], box);
     }
   }
 
@@ -1320,14 +1777,10 @@ draw_key (PosOskWidget *self, PosOskKey *key, cairo_t *cr)
 }
 
 
+/* Precalculate key positions and hit test grid for the current allocation */
 static void
-pos_osk_widget_size_allocate (GtkWidget *widget, GdkRectangle *allocation)
+pos_osk_widget_place_keys (PosOskWidget *self)
 {
-  PosOskWidget *self = POS_OSK_WIDGET (widget);
-
-  self->width = allocation->width;
-  self->height = allocation->height;
-
   for (int l = 0; l <= POS_OSK_WIDGET_LAST_LAYER; l++) {
     PosOskWidgetKeyboardLayer *layer = pos_osk_widget_get_keyboard_layer (self, l);
     guint off_y;
@@ -1354,23 +1807,96 @@ pos_osk_widget_size_allocate (GtkWidget *widget, GdkRectangle *allocation)
 
         c += pos_osk_key_get_width (key);
       }
+
+      pos_osk_widget_row_build_hit_cells (row, self->width);
     }
   }
+}
 
-  GTK_WIDGET_CLASS (pos_osk_widget_parent_class)->size_allocate (widget, allocation);
+
+/* Update toggle key state for rendering */
+static void
+update_toggle_keys (PosOskWidget *self)
+{
+  for (int r = 0; r < self->layout.n_rows; r++) {
+    PosOskWidgetRow *row = pos_osk_widget_get_row (self, r);
+
+    for (int k = 0; k < pos_osk_widget_row_get_num_keys (row); k++) {
+      PosOskKey *akey = g_ptr_array_index (row->keys, k);
+      gboolean pressed;
+
+      if (pos_osk_key_get_use (akey) != POS_OSK_KEY_USE_TOGGLE)
+        continue;
+
+      pressed = (self->layer == pos_osk_key_get_layer (akey)) ||
+        (pos_osk_widget_get_layer (self) == POS_OSK_WIDGET_LAYER_SYMBOLS2);
+
+      pos_osk_widget_set_key_pressed (self, akey, pressed);
+    }
+  }
 }
 
 
-static gboolean
-pos_osk_widget_draw (GtkWidget *widget, cairo_t *cr)
+static void
+pos_osk_widget_ensure_keys (PosOskWidget *self)
+{
+  if (self->keys_loaded || self->layout_data == NULL)
+    return;
+
+  g_debug ("Building keys for layout '%s'", self->name);
+
+  g_ptr_array_free (self->symbols, TRUE);
+  self->symbols = g_ptr_array_new ();
+  load_compiled_keys (self, self->layout_data);
+  self->keys_loaded = TRUE;
+
+  pos_osk_widget_place_keys (self);
+  update_toggle_keys (self);
+  pos_osk_widget_invalidate_layers (self);
+}
+
+
+static void
+pos_osk_widget_map (GtkWidget *widget)
+{
+  PosOskWidget *self = POS_OSK_WIDGET (widget);
+
+  pos_osk_widget_ensure_keys (self);
+
+  GTK_WIDGET_CLASS (pos_osk_widget_parent_class)->map (widget);
+}
+
+
+static void
+pos_osk_widget_size_allocate (GtkWidget *widget, GdkRectangle *allocation)
 {
   PosOskWidget *self = POS_OSK_WIDGET (widget);
+
+  if (self->width != allocation->width || self->height != allocation->height) {
+    /* Labels are shaped for the old key width */
+    g_hash_table_remove_all (self->label_cache);
+    pos_osk_widget_invalidate_layers (self);
+  }
+
+  self->width = allocation->width;
+  self->height = allocation->height;
+
+  pos_osk_widget_place_keys (self);
+
+  GTK_WIDGET_CLASS (pos_osk_widget_parent_class)->size_allocate (widget, allocation);
+}
+
+
+/* Renders the background and all keys of the current layer in unpressed state */
+static void
+draw_layer (PosOskWidget *self, cairo_t *cr)
+{
   GtkStyleContext *context;
   PosOskWidgetKeyboardLayer *layer = pos_osk_widget_get_current_layer (self);
 
   cairo_save (cr);
 
-  context = gtk_widget_get_style_context (widget);
+  context = gtk_widget_get_style_context (GTK_WIDGET (self));
   gtk_render_background (context, cr, 0, 0, self->width, self->height);
 
   cairo_translate (cr, layer->offset_x, 0);
@@ -1381,22 +1907,132 @@ pos_osk_widget_draw (GtkWidget *widget, cairo_t *cr)
     for (int k = 0; k < pos_osk_widget_row_get_num_keys (row); k++) {
       PosOskKey *key = pos_osk_widget_row_get_key (row, k);
 
-      draw_key (self, key, cr);
+      draw_key (self, key, FALSE, cr);
     }
   }
 
   cairo_restore (cr);
+}
+
+
+static cairo_surface_t *
+pos_osk_widget_get_layer_surface (PosOskWidget *self)
+{
+  cairo_surface_t *surface = self->layer_surfaces[self->layer];
+  GdkWindow *window;
+  cairo_t *cr;
+
+  if (surface)
+    return surface;
+
+  window = gtk_widget_get_window (GTK_WIDGET (self));
+  if (window == NULL || self->width <= 0 || self->height <= 0)
+    return NULL;
+
+  /* Honors the window's scale factor */
+  surface = gdk_window_create_similar_surface (window,
+                                               CAIRO_CONTENT_COLOR_ALPHA,
+                                               self->width,
+                                               self->height);
+  cr = cairo_create (surface);
+  draw_layer (self, cr);
+  cairo_destroy (cr);
+
+  self->layer_surfaces[self->layer] = surface;
+  return surface;
+}
+
+
+static gboolean
+pos_osk_widget_draw (GtkWidget *widget, cairo_t *cr)
+{
+  PosOskWidget *self = POS_OSK_WIDGET (widget);
+  GtkStyleContext *context;
+  PosOskWidgetKeyboardLayer *layer = pos_osk_widget_get_current_layer (self);
+  cairo_surface_t *surface;
+  GdkRectangle clip = { 0, 0, self->width, self->height };
+
+  surface = pos_osk_widget_get_layer_surface (self);
+  if (surface) {
+    cairo_set_source_surface (cr, surface, 0, 0);
+    cairo_paint (cr);
+  } else {
+    draw_layer (self, cr);
+  }
+
+  /* Only pressed keys within the damaged area need to be drawn on top of the cached layer */
+  gdk_cairo_get_clip_rectangle (cr, &clip);
+  context = gtk_widget_get_style_context (widget);
+
+  for (int r = 0; r < self->layout.n_rows; r++) {
+    PosOskWidgetRow *row = pos_osk_widget_get_row (self, r);
+
+    for (int k = 0; k < pos_osk_widget_row_get_num_keys (row); k++) {
+      PosOskKey *key = pos_osk_widget_row_get_key (row, k);
+      const GdkRectangle *box;
+      GdkRectangle area;
+
+      if (!pos_osk_key_get_pressed (key))
+        continue;
+
+      box = pos_osk_key_get_box (key);
+      area = *box;
+      area.x += layer->offset_x;
+      if (!gdk_rectangle_intersect (&clip, &area, NULL))
+        continue;
+
+      cairo_save (cr);
+      /* Cover the cached unpressed key */
+      gdk_cairo_rectangle (cr, &area);
+      cairo_clip (cr);
+      gtk_render_background (context, cr, 0, 0, self->width, self->height);
+
+      cairo_translate (cr, layer->offset_x, 0);
+      draw_key (self, key, TRUE, cr);
+      cairo_restore (cr);
+    }
+  }
+
   return FALSE;
 }
 
 
+static void
+pos_osk_widget_style_updated (GtkWidget *widget)
+{
+  PosOskWidget *self = POS_OSK_WIDGET (widget);
+
+  GTK_WIDGET_CLASS (pos_osk_widget_parent_class)->style_updated (widget);
+
+  pos_osk_widget_invalidate_layers (self);
+}
+
+
+static void
+pos_osk_widget_unmap (GtkWidget *widget)
+{
+  PosOskWidget *self = POS_OSK_WIDGET (widget);
+
+  /* Only keep layer renderings for visible widgets */
+  for (int l = 0; l <= POS_OSK_WIDGET_LAST_LAYER; l++)
+    g_clear_pointer (&self->layer_surfaces[l], cairo_surface_destroy);
+
+  GTK_WIDGET_CLASS (pos_osk_widget_parent_class)->unmap (widget);
+}
+
+
 static void
 pos_osk_widget_finalize (GObject *object)
 {
   PosOskWidget *self = POS_OSK_WIDGET (object);
 
   g_clear_handle_id (&self->repeat_id, g_source_remove);
+  for (int l = 0; l <= POS_OSK_WIDGET_LAST_LAYER; l++)
+    g_clear_pointer (&self->layer_surfaces[l], cairo_surface_destroy);
+  g_clear_pointer (&self->label_cache, g_hash_table_destroy);
+  g_clear_pointer (&self->icon_cache, g_hash_table_destroy);
   pos_osk_widget_layout_free (&self->layout);
+  g_clear_pointer (&self->layout_data, g_bytes_unref);
   g_clear_object (&self->long_press);
   g_clear_pointer (&self->name, g_free);
   g_clear_pointer (&self->display_name, g_free);
@@ -1441,6 +2077,9 @@ pos_osk_widget_class_init (PosOskWidgetClass *klass)
 
   widget_class->draw = pos_osk_widget_draw;
   widget_class->size_allocate = pos_osk_widget_size_allocate;
+  widget_class->style_updated = pos_osk_widget_style_updated;
+  widget_class->map = pos_osk_widget_map;
+  widget_class->unmap = pos_osk_widget_unmap;
   widget_class->button_press_event = pos_osk_widget_button_press_event;
   widget_class->button_release_event = pos_osk_widget_button_release_event;
   widget_class->motion_notify_event = pos_osk_widget_motion_notify_event;
@@ -1496,6 +2135,8 @@ pos_osk_widget_class_init (PosOskWidgetClass *klass)
    * PosOskWidget::key-down
    * @self: The osk emitting the symbol
    * @symbol: The key pressed
+   * @time: The time of the input event that pressed the key or
+   *   `GDK_CURRENT_TIME` if the press wasn't triggered by an event
    *
    * A key was pressed. This is mostly useful for haptic feedback
    * since it's not clear yet where the user will lift the finger.
@@ -1508,15 +2149,27 @@ pos_osk_widget_class_init (PosOskWidgetClass *klass)
                                         G_SIGNAL_RUN_LAST,
                                         0, NULL, NULL, NULL,
                                         G_TYPE_NONE,
-                                        1,
-                                        G_TYPE_STRING);
+                                        2,
+                                        G_TYPE_STRING,
+                                        G_TYPE_UINT);
+  /**
+   * PosOskWidget::key-up
+   * @self: The osk emitting the symbol
+   * @symbol: The key released
+   * @time: The time of the input event that released the key or
+   *   `GDK_CURRENT_TIME` if the release wasn't triggered by an event
+   *
+   * A key was released. The key's symbol is emitted via "key-symbol"
+   * right afterwards.
+   */
   signals[OSK_KEY_UP] = g_signal_new ("key-up",
                                       G_TYPE_FROM_CLASS (klass),
                                       G_SIGNAL_RUN_LAST,
                                       0, NULL, NULL, NULL,
                                       G_TYPE_NONE,
-                                      1,
-                                      G_TYPE_STRING);
+                                      2,
+                                      G_TYPE_STRING,
+                                      G_TYPE_UINT);
   signals[OSK_KEY_CANCELLED] = g_signal_new ("key-cancelled",
                                              G_TYPE_FROM_CLASS (klass),
                                              G_SIGNAL_RUN_LAST,
@@ -1599,6 +2252,11 @@ pos_osk_widget_init (PosOskWidget *self)
   self->mode = POS_OSK_WIDGET_MODE_KEYBOARD;
   self->layer = POS_OSK_WIDGET_LAYER_NORMAL;
   self->symbols = g_ptr_array_new ();
+  self->label_cache = g_hash_table_new_full (label_key_hash, label_key_equal,
+                                             label_key_free, g_object_unref);
+  self->icon_cache = g_hash_table_new_full (icon_key_hash, icon_key_equal,
+                                            icon_key_free,
+                                            (GDestroyNotify)cairo_surface_destroy);
 
   gtk_widget_add_events (GTK_WIDGET (self), GDK_BUTTON_PRESS_MASK |
                          GDK_BUTTON_RELEASE_MASK |
@@ -1628,6 +2286,9 @@ pos_osk_widget_init (PosOskWidget *self)
                                    NULL);
   g_signal_connect (self->long_press, "pressed", G_CALLBACK (on_long_pressed), self);
 
+  g_signal_connect_swapped (self, "notify::scale-factor",
+                            G_CALLBACK (pos_osk_widget_invalidate_layers), self);
+
   self->cursor_drag = g_object_new (GTK_TYPE_GESTURE_DRAG,
                                     "widget", self,
                                     "propagation-phase", GTK_PHASE_CAPTURE,
@@ -1676,23 +2337,7 @@ pos_osk_widget_set_layer (PosOskWidget *self, PosOskWidgetLayer layer)
   g_object_notify_by_pspec (G_OBJECT (self), props[PROP_LAYER]);
   gtk_widget_queue_draw (GTK_WIDGET (self));
 
-  /* Update key state for rendering */
-  for (int r = 0; r < self->layout.n_rows; r++) {
-    PosOskWidgetRow *row = pos_osk_widget_get_row (self, r);
-
-    for (int k = 0; k < pos_osk_widget_row_get_num_keys (row); k++) {
-      PosOskKey *akey = g_ptr_array_index (row->keys, k);
-      gboolean pressed;
-
-      if (pos_osk_key_get_use (akey) != POS_OSK_KEY_USE_TOGGLE)
-        continue;
-
-      pressed = (self->layer == pos_osk_key_get_layer (akey)) ||
-        (pos_osk_widget_get_layer (self) == POS_OSK_WIDGET_LAYER_SYMBOLS2);
-
-      pos_osk_widget_set_key_pressed (self, akey, pressed);
-    }
-  }
+  update_toggle_keys (self);
 }
 
 
@@ -1756,8 +2401,9 @@ pos_osk_widget_set_layout (PosOskWidget *self,
                            GError      **err)
 {
   g_autofree char *path = NULL;
+  g_autofree char *user_path = NULL;
+  g_autofree char *contents = NULL;
   g_autoptr (GBytes) data = NULL;
-  const char *json;
   gsize size;
   gboolean ret;
 
@@ -1773,23 +2419,43 @@ pos_osk_widget_set_layout (PosOskWidget *self,
   g_free (self->layout_id);
   self->layout_id = g_strdup (layout_id);
 
-  if (!STR_IS_NULL_OR_EMPTY (variant))
-    path = g_strdup_printf ("/mobi/phosh/osk-stub/layouts/%s+%s.json", layout, variant);
-  else
-    path = g_strdup_printf ("/mobi/phosh/osk-stub/layouts/%s.json", layout);
-
-  data = g_resources_lookup_data (path, 0, err);
-  if (data == NULL) {
-    return FALSE;
+  user_path = get_user_layout_path (layout, variant);
+  if (g_file_test (user_path, G_FILE_TEST_EXISTS)) {
+    g_debug ("Using user supplied layout %s", user_path);
+    if (!g_file_get_contents (user_path, &contents, &size, err))
+      return FALSE;
+  } else {
+    if (!STR_IS_NULL_OR_EMPTY (variant))
+      path = g_strdup_printf ("/mobi/phosh/osk-stub/layouts/%s+%s.layout", layout, variant);
+    else
+      path = g_strdup_printf ("/mobi/phosh/osk-stub/layouts/%s.layout", layout);
+
+    data = g_resources_lookup_data (path, 0, err);
+    if (data == NULL)
+      return FALSE;
   }
 
   g_ptr_array_free (self->symbols, TRUE);
   self->symbols = g_ptr_array_new ();
 
-  json = (char*) g_bytes_get_data (data, &size);
-  ret = parse_layout (self, json, size);
+  g_clear_pointer (&self->layout_data, g_bytes_unref);
+  self->keys_loaded = FALSE;
+
+  if (contents) {
+    ret = parse_layout (self, contents, size);
+    self->keys_loaded = TRUE;
+    pos_osk_widget_place_keys (self);
+  } else {
+    ret = load_compiled_header (self, data);
+    if (ret)
+      self->layout_data = g_bytes_ref (data);
+    /* Build keys right away when we're already shown */
+    if (gtk_widget_get_mapped (GTK_WIDGET (self)))
+      pos_osk_widget_ensure_keys (self);
+  }
 
   parse_lang (self, layout, variant);
+  pos_osk_widget_invalidate_layers (self);
 
   g_object_notify_by_pspec (G_OBJECT (self), props[PROP_NAME]);
 
@@ -1845,7 +2511,8 @@ pos_osk_widget_set_mode (PosOskWidget *self, PosOskWidgetMode mode)
 
   g_object_notify_by_pspec (G_OBJECT (self), props[PROP_MODE]);
   self->last_x = self->last_y = 0.0;
-  gtk_widget_queue_draw (GTK_WIDGET (self));
+  /* Labels aren't shown in cursor mode */
+  pos_osk_widget_invalidate_layers (self);
 }
 
 
@@ -1917,9 +2584,53 @@ pos_osk_widget_get_symbols (PosOskWidget *self)
 {
   g_return_val_if_fail (POS_IS_OSK_WIDGET (self), NULL);
 
+  pos_osk_widget_ensure_keys (self);
+
   return (const char * const *)self->symbols->pdata;
 }
 
+/**
+ * pos_osk_widget_get_popover_symbols:
+ * @self: The osk widget
+ *
+ * Get the symbols of all the popovers of this OSK without duplicates.
+ *
+ * Returns: The symbols
+ */
+const char * const *
+pos_osk_widget_get_popover_symbols (PosOskWidget *self)
+{
+  g_autoptr (GHashTable) seen = NULL;
+
+  g_return_val_if_fail (POS_IS_OSK_WIDGET (self), NULL);
+
+  pos_osk_widget_ensure_keys (self);
+
+  if (self->layout.popover_symbols)
+    return (const char * const *)self->layout.popover_symbols->pdata;
+
+  seen = g_hash_table_new (g_str_hash, g_str_equal);
+  self->layout.popover_symbols = g_ptr_array_new ();
+  for (int l = 0; l <= POS_OSK_WIDGET_LAST_LAYER; l++) {
+    for (int r = 0; r < LAYOUT_MAX_ROWS; r++) {
+      PosOskWidgetRow *row = pos_osk_widget_get_layer_row (self, l, r);
+
+      for (int k = 0; k < pos_osk_widget_row_get_num_keys (row); k++) {
+        GStrv symbols = pos_osk_key_get_symbols (pos_osk_widget_row_get_key (row, k));
+
+        for (int i = 0; symbols && symbols[i]; i++) {
+          if (!g_hash_table_add (seen, symbols[i]))
+            continue;
+          g_ptr_array_add (self->layout.popover_symbols, symbols[i]);
+        }
+      }
+    }
+  }
+  g_ptr_array_add (self->layout.popover_symbols, NULL);
+
+  return (const char * const *)self->layout.popover_symbols->pdata;
+}
+
 
 /**
  * pos_osk_widget_set_features:
@@ -1939,3 +2650,91 @@ pos_osk_widget_set_features (PosOskWidget *self, PhoshOskFeatures features)
   self->features = features;
   g_object_notify_by_pspec (G_OBJECT (self), props[PROP_FEATURES]);
 }
+
+/**
+ * pos_osk_widget_flush_render_caches:
+ * @self: The osk widget
+ *
+ * Drop all cached labels, icons and layer renderings. Should be
+ * invoked when the theme changes.
+ */
+void
+pos_osk_widget_flush_render_caches (PosOskWidget *self)
+{
+  g_return_if_fail (POS_IS_OSK_WIDGET (self));
+
+  g_hash_table_remove_all (self->label_cache);
+  g_hash_table_remove_all (self->icon_cache);
+  pos_osk_widget_invalidate_layers (self);
+}
+
+/**
+ * pos_osk_widget_get_keys_size:
+ * @self: The osk widget
+ *
+ * Get an estimate of the memory used by the widget's keys. Keys are
+ * built when the widget is first shown.
+ *
+ * Returns: The size in bytes, `0` if the keys aren't built yet
+ */
+gsize
+pos_osk_widget_get_keys_size (PosOskWidget *self)
+{
+  GTypeQuery query;
+  gsize size = 0;
+
+  g_return_val_if_fail (POS_IS_OSK_WIDGET (self), 0);
+
+  if (!self->keys_loaded)
+    return 0;
+
+  g_type_query (POS_TYPE_OSK_KEY, &query);
+
+  for (int l = 0; l <= POS_OSK_WIDGET_LAST_LAYER; l++) {
+    for (int r = 0; r < LAYOUT_MAX_ROWS; r++) {
+      PosOskWidgetRow *row = pos_osk_widget_get_layer_row (self, l, r);
+
+      size += pos_osk_widget_row_get_num_keys (row) * (query.instance_size + sizeof (gpointer));
+      size += row->n_hit_cells;
+    }
+  }
+
+  return size;
+}
+
+/**
+ * pos_osk_widget_release_keys:
+ * @self: The osk widget
+ *
+ * Release the keys of a widget that isn't shown. They're rebuilt
+ * once the widget is shown again.
+ *
+ * Returns: %TRUE if the keys were released
+ */
+gboolean
+pos_osk_widget_release_keys (PosOskWidget *self)
+{
+  g_return_val_if_fail (POS_IS_OSK_WIDGET (self), FALSE);
+
+  /* User supplied layouts can't be rebuilt */
+  if (!self->keys_loaded || self->layout_data == NULL)
+    return FALSE;
+
+  if (gtk_widget_get_mapped (GTK_WIDGET (self)))
+    return FALSE;
+
+  g_debug ("Releasing keys of layout '%s'", self->name);
+
+  key_repeat_cancel (self);
+  self->current = NULL;
+  self->space = NULL;
+  g_clear_pointer (&self->char_popup, phosh_cp_widget_destroy);
+
+  pos_osk_widget_layout_free_keys (&self->layout);
+  g_ptr_array_set_size (self->symbols, 0);
+  g_hash_table_remove_all (self->label_cache);
+  g_hash_table_remove_all (self->icon_cache);
+  self->keys_loaded = FALSE;
+
+  return TRUE;
+}
@@ -36,5 +36,9 @@ const char       *pos_osk_widget_get_lang   (PosOskWidget *self);
 const char       *pos_osk_widget_get_region (PosOskWidget *self);
 void              pos_osk_widget_set_features (PosOskWidget *self, PhoshOskFeatures features);
 const char *const *pos_osk_widget_get_symbols (PosOskWidget *self);
+const char *const *pos_osk_widget_get_popover_symbols (PosOskWidget *self);
+void              pos_osk_widget_flush_render_caches (PosOskWidget *self);
+gsize             pos_osk_widget_get_keys_size (PosOskWidget *self);
+gboolean          pos_osk_widget_release_keys (PosOskWidget *self);
 
 G_END_DECLS
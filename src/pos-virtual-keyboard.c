@@ -7,14 +7,17 @@
  */
 
 #define G_LOG_DOMAIN "pos-virtual-keyboard"
+#define _GNU_SOURCE
 
 #include "pos-config.h"
 #include "util.h"
 
 #include "pos-virtual-keyboard.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <unistd.h>
 
 
 enum {
@@ -38,7 +41,11 @@ struct _PosVirtualKeyboard {
   struct zwp_virtual_keyboard_manager_v1 *virtual_keyboard_manager;
   struct zwp_virtual_keyboard_v1         *virtual_keyboard;
 
-  GTimer                                 *timer;
+  /* The modifiers last sent to the compositor */
+  gboolean                                modifiers_sent;
+  PosVirtualKeyboardModifierFlags         depressed;
+  PosVirtualKeyboardModifierFlags         latched;
+  PosVirtualKeyboardModifierFlags         locked;
 };
 G_DEFINE_TYPE (PosVirtualKeyboard, pos_virtual_keyboard, G_TYPE_OBJECT)
 
@@ -83,7 +90,6 @@ pos_virtual_keyboard_finalize (GObject *object)
   PosVirtualKeyboard *self = POS_VIRTUAL_KEYBOARD (object);
 
   g_clear_pointer (&self->virtual_keyboard, zwp_virtual_keyboard_v1_destroy);
-  g_clear_pointer (&self->timer, g_timer_destroy);
 
   G_OBJECT_CLASS (pos_virtual_keyboard_parent_class)->finalize (object);
 }
@@ -117,7 +123,6 @@ pos_virtual_keyboard_class_init (PosVirtualKeyboardClass *klass)
 static void
 pos_virtual_keyboard_init (PosVirtualKeyboard *self)
 {
-  self->timer = g_timer_new ();
 }
 
 
@@ -135,27 +140,37 @@ pos_virtual_keyboard_new (struct zwp_virtual_keyboard_manager_v1 *virtual_keyboa
 
 
 
-void
-pos_virtual_keyboard_press (PosVirtualKeyboard *self, guint keycode)
+/*
+ * Keys not triggered by an input event (e.g. key repeat) use the
+ * monotonic clock which is what compositors use for their event times
+ * too.
+ */
+static guint32
+get_event_time (guint32 time)
 {
-  guint millis;
+  if (time == GDK_CURRENT_TIME)
+    time = (guint32)(g_get_monotonic_time () / 1000);
+
+  return time;
+}
+
 
+void
+pos_virtual_keyboard_press (PosVirtualKeyboard *self, guint keycode, guint32 time)
+{
   g_return_if_fail (POS_IS_VIRTUAL_KEYBOARD (self));
 
-  millis = (guint)g_timer_elapsed (self->timer, NULL) * 1000;
-  zwp_virtual_keyboard_v1_key (self->virtual_keyboard, millis, keycode,
+  zwp_virtual_keyboard_v1_key (self->virtual_keyboard, get_event_time (time), keycode,
                                WL_KEYBOARD_KEY_STATE_PRESSED);
 }
 
 
 void
-pos_virtual_keyboard_release (PosVirtualKeyboard *self, guint keycode)
+pos_virtual_keyboard_release (PosVirtualKeyboard *self, guint keycode, guint32 time)
 {
-  guint millis;
-
   g_return_if_fail (POS_IS_VIRTUAL_KEYBOARD (self));
-  millis = (guint)g_timer_elapsed (self->timer, NULL) * 1000;
-  zwp_virtual_keyboard_v1_key (self->virtual_keyboard, millis, keycode,
+
+  zwp_virtual_keyboard_v1_key (self->virtual_keyboard, get_event_time (time), keycode,
                                WL_KEYBOARD_KEY_STATE_RELEASED);
 }
 
@@ -168,8 +183,97 @@ pos_virtual_keyboard_set_modifiers (PosVirtualKeyboard             *self,
 {
   g_return_if_fail (POS_IS_VIRTUAL_KEYBOARD (self));
 
+  if (self->modifiers_sent && self->depressed == depressed &&
+      self->latched == latched && self->locked == locked) {
+    return;
+  }
+
   zwp_virtual_keyboard_v1_modifiers (self->virtual_keyboard,
                                      depressed, locked, latched, 0 /* TBD */);
+  self->depressed = depressed;
+  self->latched = latched;
+  self->locked = locked;
+  self->modifiers_sent = TRUE;
+}
+
+/**
+ * pos_virtual_keyboard_create_keymap_fd:
+ * @keymap: The keymap in xkb text format
+ * @size: (out): The size of the keymap
+ *
+ * Creates a read only file holding the given keymap that can be sent
+ * to the compositor any number of times via
+ * [method@VirtualKeyboard.set_keymap_fd]. Where supported the file is
+ * a sealed memfd so the compositor can map it without copying.
+ *
+ * Returns: The file descriptor or `-1` on error
+ */
+int
+pos_virtual_keyboard_create_keymap_fd (const char *keymap, gsize *size)
+{
+  gsize len, written = 0;
+  gboolean sealable = TRUE;
+  int fd;
+
+  g_return_val_if_fail (keymap, -1);
+  g_return_val_if_fail (size, -1);
+
+  len = strlen (keymap);
+
+  fd = memfd_create ("pos-keymap", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0) {
+    g_debug ("Failed to create memfd: %s", g_strerror (errno));
+    sealable = FALSE;
+    fd = phosh_create_shm_file (0);
+    if (fd < 0) {
+      g_warning ("Failed to create keymap file: %s", g_strerror (errno));
+      return -1;
+    }
+  }
+
+  while (written < len) {
+    gssize ret = write (fd, keymap + written, len - written);
+
+    if (ret < 0) {
+      if (errno == EINTR)
+        continue;
+      g_warning ("Failed to write keymap: %s", g_strerror (errno));
+      close (fd);
+      return -1;
+    }
+    written += ret;
+  }
+
+  if (sealable &&
+      fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0) {
+    g_warning ("Failed to seal keymap: %s", g_strerror (errno));
+  }
+
+  *size = len;
+  return fd;
+}
+
+/**
+ * pos_virtual_keyboard_set_keymap_fd:
+ * @self: The virtual keyboard driver
+ * @fd: The file holding the keymap
+ * @size: The size of the keymap
+ *
+ * Sets the keymap held in the given file. The file descriptor is not
+ * closed so it can be reused.
+ */
+void
+pos_virtual_keyboard_set_keymap_fd (PosVirtualKeyboard *self, int fd, gsize size)
+{
+  g_return_if_fail (POS_IS_VIRTUAL_KEYBOARD (self));
+  g_return_if_fail (fd >= 0);
+
+  zwp_virtual_keyboard_v1_keymap (self->virtual_keyboard,
+                                  WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1,
+                                  fd, size);
+  /* A new keymap resets the modifier state */
+  self->modifiers_sent = FALSE;
+  g_debug ("Loaded keymap of %" G_GSIZE_FORMAT " bytes", size);
 }
 
 /**
@@ -183,19 +287,15 @@ void
 pos_virtual_keyboard_set_keymap (PosVirtualKeyboard *self, const char *keymap)
 {
   int fd;
-  gpointer ptr;
   gsize size;
 
   g_return_if_fail (POS_IS_VIRTUAL_KEYBOARD (self));
   g_return_if_fail (keymap);
 
-  size = strlen (keymap);
-  fd = phosh_create_shm_file (size);
-  ptr = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-  memmove (ptr, keymap, size);
-  zwp_virtual_keyboard_v1_keymap (self->virtual_keyboard,
-                                  WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1,
-                                  fd, size);
+  fd = pos_virtual_keyboard_create_keymap_fd (keymap, &size);
+  if (fd < 0)
+    return;
+
+  pos_virtual_keyboard_set_keymap_fd (self, fd, size);
   close (fd);
-  g_debug ("Loaded keymap of %zd bytes", size);
 }
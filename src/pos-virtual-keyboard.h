@@ -34,12 +34,14 @@ G_DECLARE_FINAL_TYPE (PosVirtualKeyboard, pos_virtual_keyboard, POS, VIRTUAL_KEY
 PosVirtualKeyboard *pos_virtual_keyboard_new (
   struct zwp_virtual_keyboard_manager_v1 *virtual_keyboard_manager,
   struct wl_seat *_seat);
-void pos_virtual_keyboard_press (PosVirtualKeyboard *self, guint keycode);
-void pos_virtual_keyboard_release (PosVirtualKeyboard *self, guint keycode);
+void pos_virtual_keyboard_press (PosVirtualKeyboard *self, guint keycode, guint32 time);
+void pos_virtual_keyboard_release (PosVirtualKeyboard *self, guint keycode, guint32 time);
 void pos_virtual_keyboard_set_modifiers (PosVirtualKeyboard             *self,
                                          PosVirtualKeyboardModifierFlags depressed,
                                          PosVirtualKeyboardModifierFlags latched,
                                          PosVirtualKeyboardModifierFlags locked);
 void pos_virtual_keyboard_set_keymap (PosVirtualKeyboard *self, const char *keymap);
+void pos_virtual_keyboard_set_keymap_fd (PosVirtualKeyboard *self, int fd, gsize size);
+int  pos_virtual_keyboard_create_keymap_fd (const char *keymap, gsize *size);
 
 G_END_DECLS
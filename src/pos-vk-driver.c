@@ -17,6 +17,13 @@
 
 #include <linux/input-event-codes.h>
 
+#include <unistd.h>
+
+/* Number of keymaps to keep around for fast layout switching */
+#define KEYMAP_CACHE_MAX 8
+/* Highest usable kernel keycode given xkb's maximum of 255 */
+#define KEYCODE_MAX (255 - 8)
+
 enum {
   PROP_0,
   PROP_VIRTUAL_KEYBOARD,
@@ -40,9 +47,40 @@ struct _PosVkDriver {
   PosVirtualKeyboard *virtual_keyboard;
 
   char               *layout_id;
+
+  /* layout_id → PosVkKeymap */
+  GHashTable         *keymap_cache;
+  /* The cached layout_ids, most recently used first */
+  GQueue              keymap_lru;
+  guint               keymap_cache_hits;
+  gboolean            overlay_active;
+
+  /* Modifiers to send with the next key event or flush */
+  PosVirtualKeyboardModifierFlags modifiers;
+  guint               flush_id;
 };
 G_DEFINE_TYPE (PosVkDriver, pos_vk_driver, G_TYPE_OBJECT)
 
+/*
+ * A keymap sent to the compositor. We keep the file around so
+ * switching back to a layout only needs to resend it.
+ */
+typedef struct {
+  GHashTable *keycodes;
+  int         fd;
+  gsize       size;
+} PosVkKeymap;
+
+
+static void
+pos_vk_keymap_free (PosVkKeymap *keymap)
+{
+  g_hash_table_unref (keymap->keycodes);
+  if (keymap->fd >= 0)
+    close (keymap->fd);
+  g_free (keymap);
+}
+
 typedef struct {
   char *key;
   guint keycode;
@@ -458,7 +496,7 @@ pos_vk_driver_update_keycodes (PosVkDriver *self, const char *layout_id)
 {
   const PosKeycode *keycodes = keycodes_terminal;
 
-  g_clear_pointer (&self->keycodes, g_hash_table_destroy);
+  g_clear_pointer (&self->keycodes, g_hash_table_unref);
 
   self->keycodes = g_hash_table_new (g_str_hash, g_str_equal);
   for (int i = 0; i < G_N_ELEMENTS (keycodes_common); i++)
@@ -472,6 +510,118 @@ pos_vk_driver_update_keycodes (PosVkDriver *self, const char *layout_id)
 }
 
 
+/*
+ * Sends the keymap and makes its keycodes the current ones. The
+ * keymap is cached under @layout_id if it isn't already.
+ */
+static void
+pos_vk_driver_use_keymap (PosVkDriver *self, const char *layout_id, PosVkKeymap *keymap)
+{
+  GList *link;
+
+  if (keymap->fd >= 0)
+    pos_virtual_keyboard_set_keymap_fd (self->virtual_keyboard, keymap->fd, keymap->size);
+
+  g_clear_pointer (&self->keycodes, g_hash_table_unref);
+  self->keycodes = g_hash_table_ref (keymap->keycodes);
+
+  g_clear_pointer (&self->layout_id, g_free);
+  self->layout_id = g_strdup (layout_id);
+  self->overlay_active = FALSE;
+
+  link = g_queue_find_custom (&self->keymap_lru, layout_id, (GCompareFunc)g_strcmp0);
+  if (link) {
+    g_queue_unlink (&self->keymap_lru, link);
+    g_queue_push_head_link (&self->keymap_lru, link);
+  } else {
+    g_queue_push_head (&self->keymap_lru, g_strdup (layout_id));
+  }
+
+  if (g_hash_table_lookup (self->keymap_cache, layout_id) == keymap)
+    return;
+
+  if (!g_hash_table_contains (self->keymap_cache, layout_id) &&
+      g_hash_table_size (self->keymap_cache) >= KEYMAP_CACHE_MAX) {
+    g_autofree char *lru_id = g_queue_pop_tail (&self->keymap_lru);
+
+    g_debug ("Evicting keymap for %s", lru_id);
+    g_hash_table_remove (self->keymap_cache, lru_id);
+  }
+  g_hash_table_insert (self->keymap_cache, g_strdup (layout_id), keymap);
+}
+
+
+/*
+ * Looks up a cached keymap and uses it. Returns %TRUE on success.
+ */
+static gboolean
+pos_vk_driver_use_cached_keymap (PosVkDriver *self, const char *layout_id)
+{
+  PosVkKeymap *keymap = g_hash_table_lookup (self->keymap_cache, layout_id);
+
+  if (keymap == NULL)
+    return FALSE;
+
+  self->keymap_cache_hits++;
+  g_debug ("Using cached keymap for %s, %u hits", layout_id, self->keymap_cache_hits);
+  pos_vk_driver_use_keymap (self, layout_id, keymap);
+
+  return TRUE;
+}
+
+
+static PosVkKeymap *
+pos_vk_keymap_new (GHashTable *keycodes, const char *keymap_str)
+{
+  PosVkKeymap *keymap = g_new0 (PosVkKeymap, 1);
+
+  keymap->keycodes = g_hash_table_ref (keycodes);
+  keymap->fd = pos_virtual_keyboard_create_keymap_fd (keymap_str, &keymap->size);
+
+  return keymap;
+}
+
+
+static void
+pos_vk_driver_flush_modifiers (PosVkDriver *self)
+{
+  g_clear_handle_id (&self->flush_id, g_source_remove);
+
+  /* The virtual keyboard only sends changed modifiers */
+  pos_virtual_keyboard_set_modifiers (self->virtual_keyboard,
+                                      self->modifiers,
+                                      POS_VIRTUAL_KEYBOARD_MODIFIERS_NONE,
+                                      POS_VIRTUAL_KEYBOARD_MODIFIERS_NONE);
+}
+
+
+static void
+on_flush_idle (gpointer data)
+{
+  PosVkDriver *self = POS_VK_DRIVER (data);
+
+  self->flush_id = 0;
+  pos_vk_driver_flush_modifiers (self);
+}
+
+/*
+ * Resetting the modifiers after a key release is deferred to the end
+ * of the current main loop iteration so key sequences (e.g. emoji or
+ * repeated keys) don't toggle modifiers in between.
+ */
+static void
+pos_vk_driver_queue_modifiers (PosVkDriver *self, PosVirtualKeyboardModifierFlags modifiers)
+{
+  self->modifiers = modifiers;
+
+  if (self->flush_id)
+    return;
+
+  self->flush_id = g_idle_add_once (on_flush_idle, self);
+  g_source_set_name_by_id (self->flush_id, "[pos-vk-driver] flush modifiers");
+}
+
+
 static void
 pos_vk_driver_set_property (GObject      *object,
                             guint         property_id,
@@ -496,7 +646,10 @@ pos_vk_driver_finalize (GObject *object)
 {
   PosVkDriver *self = POS_VK_DRIVER (object);
 
-  g_hash_table_destroy (self->keycodes);
+  g_clear_handle_id (&self->flush_id, g_source_remove);
+  g_clear_pointer (&self->keycodes, g_hash_table_unref);
+  g_clear_pointer (&self->keymap_cache, g_hash_table_destroy);
+  g_queue_clear_full (&self->keymap_lru, g_free);
   g_clear_pointer (&self->layout_id, g_free);
   g_clear_object (&self->virtual_keyboard);
 
@@ -524,6 +677,9 @@ pos_vk_driver_class_init (PosVkDriverClass *klass)
 static void
 pos_vk_driver_init (PosVkDriver *self)
 {
+  self->keymap_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                              (GDestroyNotify)pos_vk_keymap_free);
+
   self->gdk_keycodes = g_hash_table_new (g_direct_hash, g_direct_equal);
   for (int i = 0; i < G_N_ELEMENTS (keycodes_gdk_us); i++)
     g_hash_table_insert (self->gdk_keycodes, GUINT_TO_POINTER (keycodes_gdk_us[i].gdk_keycode),
@@ -546,6 +702,7 @@ pos_vk_driver_new (PosVirtualKeyboard *virtual_keyboard)
  * @self: The virtual keyboard driver
  * @key: The key to press
  * @modifiers: Additional modifiers
+ * @time: The time of the input event that pressed the key or `GDK_CURRENT_TIME`
  *
  * Submits a key via the virtual keyboard protocol. This handles
  * capital letters implicitly by adding the correctmodifier. Same is true for several
@@ -554,7 +711,10 @@ pos_vk_driver_new (PosVirtualKeyboard *virtual_keyboard)
  * One can pass additional modifiers to trigger e.g. <ctrl>+<character> compbos.
  */
 void
-pos_vk_driver_key_down (PosVkDriver *self, const char *key, PosKeycodeModifier modifiers)
+pos_vk_driver_key_down (PosVkDriver        *self,
+                        const char         *key,
+                        PosKeycodeModifier  modifiers,
+                        guint32             time)
 {
   PosKeycode *keycode;
   guint vk_modifiers = 0;
@@ -575,16 +735,14 @@ pos_vk_driver_key_down (PosVkDriver *self, const char *key, PosKeycodeModifier m
     vk_modifiers |= POS_VIRTUAL_KEYBOARD_MODIFIERS_ALTGR;
 
   /* FIXME: preserve current modifiers */
-  pos_virtual_keyboard_set_modifiers (self->virtual_keyboard,
-                                      vk_modifiers,
-                                      POS_VIRTUAL_KEYBOARD_MODIFIERS_NONE,
-                                      POS_VIRTUAL_KEYBOARD_MODIFIERS_NONE);
+  self->modifiers = vk_modifiers;
+  pos_vk_driver_flush_modifiers (self);
 
-  pos_virtual_keyboard_press (self->virtual_keyboard, keycode->keycode);
+  pos_virtual_keyboard_press (self->virtual_keyboard, keycode->keycode, time);
 }
 
 void
-pos_vk_driver_key_up (PosVkDriver *self, const char *key)
+pos_vk_driver_key_up (PosVkDriver *self, const char *key, guint32 time)
 {
   PosKeycode *keycode;
 
@@ -593,11 +751,8 @@ pos_vk_driver_key_up (PosVkDriver *self, const char *key)
   keycode = g_hash_table_lookup (self->keycodes, key);
   g_return_if_fail (keycode);
 
-  pos_virtual_keyboard_release (self->virtual_keyboard, keycode->keycode);
-  pos_virtual_keyboard_set_modifiers (self->virtual_keyboard,
-                                      POS_VIRTUAL_KEYBOARD_MODIFIERS_NONE,
-                                      POS_VIRTUAL_KEYBOARD_MODIFIERS_NONE,
-                                      POS_VIRTUAL_KEYBOARD_MODIFIERS_NONE);
+  pos_virtual_keyboard_release (self->virtual_keyboard, keycode->keycode, time);
+  pos_vk_driver_queue_modifiers (self, POS_VIRTUAL_KEYBOARD_MODIFIERS_NONE);
 }
 
 /**
@@ -643,18 +798,13 @@ pos_vk_driver_key_press_gdk (PosVkDriver *self, guint gdk_keycode, GdkModifierTy
   }
 
   /* FIXME: preserve current modifiers */
-  pos_virtual_keyboard_set_modifiers (self->virtual_keyboard,
-                                      flags,
-                                      POS_VIRTUAL_KEYBOARD_MODIFIERS_NONE,
-                                      POS_VIRTUAL_KEYBOARD_MODIFIERS_NONE);
+  self->modifiers = flags;
+  pos_vk_driver_flush_modifiers (self);
 
-  pos_virtual_keyboard_press (self->virtual_keyboard, key);
-  pos_virtual_keyboard_release (self->virtual_keyboard, key);
+  pos_virtual_keyboard_press (self->virtual_keyboard, key, GDK_CURRENT_TIME);
+  pos_virtual_keyboard_release (self->virtual_keyboard, key, GDK_CURRENT_TIME);
 
-  pos_virtual_keyboard_set_modifiers (self->virtual_keyboard,
-                                      POS_VIRTUAL_KEYBOARD_MODIFIERS_NONE,
-                                      POS_VIRTUAL_KEYBOARD_MODIFIERS_NONE,
-                                      POS_VIRTUAL_KEYBOARD_MODIFIERS_NONE);
+  pos_vk_driver_queue_modifiers (self, POS_VIRTUAL_KEYBOARD_MODIFIERS_NONE);
 }
 
 /**
@@ -668,25 +818,24 @@ void
 pos_vk_driver_set_terminal_keymap (PosVkDriver *self)
 {
   const char *layout_id = "terminal";
-  const char *keymap;
   g_autoptr (GBytes) data = NULL;
-  gsize size;
+  PosVkKeymap *keymap;
 
   g_return_if_fail (POS_IS_VK_DRIVER (self));
 
   if (g_strcmp0 (layout_id, self->layout_id) == 0)
     return;
 
+  if (pos_vk_driver_use_cached_keymap (self, layout_id))
+    return;
+
   g_debug ("Setting terminal keymap");
-  g_clear_pointer (&self->layout_id, g_free);
-  self->layout_id = g_strdup (layout_id);
   data = g_resources_lookup_data ("/mobi/phosh/osk-stub/keymap.txt", 0, NULL);
   g_assert (data);
-  keymap = (char*) g_bytes_get_data (data, &size);
-
-  pos_virtual_keyboard_set_keymap (self->virtual_keyboard, keymap);
 
   pos_vk_driver_update_keycodes (self, layout_id);
+  keymap = pos_vk_keymap_new (self->keycodes, g_bytes_get_data (data, NULL));
+  pos_vk_driver_use_keymap (self, layout_id, keymap);
 }
 
 /**
@@ -694,13 +843,24 @@ pos_vk_driver_set_terminal_keymap (PosVkDriver *self)
  * @self: The vk driver
  * @layout_id: The layout_id that identifies this keymap
  * @symbols: The symbols for the keymap
+ * @overlay_symbols: (nullable): Symbols that would otherwise need an overlay keymap
+ *
+ * Generates and installs a keymap based on the given symbols. Keymaps
+ * are cached by @layout_id so switching back to a recently used layout
+ * doesn't need to regenerate it.
  *
- * Generates and installs a keymap based on the given symbols.
+ * The remaining keycodes are used for @overlay_symbols (e.g. the
+ * symbols of the layout's popovers) so these can be typed without
+ * installing an overlay keymap.
  */
 void
-pos_vk_driver_set_keymap_symbols (PosVkDriver *self, const char *layout_id, const char * const *symbols)
+pos_vk_driver_set_keymap_symbols (PosVkDriver        *self,
+                                  const char         *layout_id,
+                                  const char * const *symbols,
+                                  const char * const *overlay_symbols)
 {
   g_autofree char *keymap_str = NULL;
+  PosVkKeymap *keymap;
   int keycode = KEY_1;
   /* Extra keysyms to add to each keymap */
   /* TODO: make dynamic */
@@ -720,8 +880,11 @@ pos_vk_driver_set_keymap_symbols (PosVkDriver *self, const char *layout_id, cons
   if (g_strcmp0 (layout_id, self->layout_id) == 0)
     return;
 
+  if (pos_vk_driver_use_cached_keymap (self, layout_id))
+    return;
+
   g_debug ("Switching to %s", layout_id);
-  g_clear_pointer (&self->keycodes, g_hash_table_destroy);
+  g_clear_pointer (&self->keycodes, g_hash_table_unref);
   self->keycodes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
   for (int n = 0; symbols[n]; n++, keycode++) {
@@ -743,11 +906,27 @@ pos_vk_driver_set_keymap_symbols (PosVkDriver *self, const char *layout_id, cons
     g_hash_table_insert (self->keycodes, g_strdup (extra_keysyms[n].key), pos_keycode);
   }
 
-  keymap_str = pos_vk_driver_build_keymap (self, extra_keysyms);
-  pos_virtual_keyboard_set_keymap (self->virtual_keyboard, keymap_str);
+  for (int n = 0; overlay_symbols && overlay_symbols[n]; n++) {
+    PosKeycode *pos_keycode;
+    const char *symbol = overlay_symbols[n];
 
-  g_clear_pointer (&self->layout_id, g_free);
-  self->layout_id = g_strdup (layout_id);
+    if (g_hash_table_contains (self->keycodes, symbol))
+      continue;
+
+    keycode = get_next_valid_keycode (keycode);
+    if (keycode > KEYCODE_MAX) {
+      g_debug ("No keycodes left for overlay symbols, %s will need an overlay keymap", symbol);
+      break;
+    }
+
+    pos_keycode = g_new0 (PosKeycode, 1);
+    pos_keycode->keycode = keycode++;
+    g_hash_table_insert (self->keycodes, g_strdup (symbol), pos_keycode);
+  }
+
+  keymap_str = pos_vk_driver_build_keymap (self, extra_keysyms);
+  keymap = pos_vk_keymap_new (self->keycodes, keymap_str);
+  pos_vk_driver_use_keymap (self, layout_id, keymap);
 }
 
 /**
@@ -760,17 +939,33 @@ pos_vk_driver_set_keymap_symbols (PosVkDriver *self, const char *layout_id, cons
  *
  * This is very similar to `pos_vk_driver_set_keymap_symbols` but does not require
  * a layout-id nor does it add any extra keys.
+ *
+ * If the current keymap already has all the symbols nothing is
+ * changed. Use [method@VkDriver.get_overlay_active] to check whether an
+ * overlay keymap got installed.
  */
 void
 pos_vk_driver_set_overlay_keymap (PosVkDriver *self, const char *const *symbols)
 {
   g_autofree char *keymap_str = NULL;
   int keycode = KEY_1;
+  gboolean found = TRUE;
 
   g_return_if_fail (POS_IS_VK_DRIVER (self));
   g_return_if_fail (symbols);
 
-  g_clear_pointer (&self->keycodes, g_hash_table_destroy);
+  for (int n = 0; self->keycodes && symbols[n]; n++) {
+    if (!g_hash_table_contains (self->keycodes, symbols[n])) {
+      found = FALSE;
+      break;
+    }
+  }
+  if (self->keycodes && found) {
+    g_debug ("All overlay symbols in current keymap");
+    return;
+  }
+
+  g_clear_pointer (&self->keycodes, g_hash_table_unref);
   self->keycodes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
   for (int n = 0; symbols[n]; n++, keycode++) {
@@ -786,6 +981,23 @@ pos_vk_driver_set_overlay_keymap (PosVkDriver *self, const char *const *symbols)
 
   g_clear_pointer (&self->layout_id, g_free);
   pos_virtual_keyboard_set_keymap (self->virtual_keyboard, keymap_str);
+  self->overlay_active = TRUE;
+}
+
+/**
+ * pos_vk_driver_get_overlay_active:
+ * @self: The virtual keyboard driver
+ *
+ * Whether an overlay keymap is currently installed.
+ *
+ * Returns: %TRUE if an overlay keymap is installed
+ */
+gboolean
+pos_vk_driver_get_overlay_active (PosVkDriver *self)
+{
+  g_return_val_if_fail (POS_IS_VK_DRIVER (self), FALSE);
+
+  return self->overlay_active;
 }
 
 
@@ -802,3 +1014,19 @@ pos_vk_driver_convert_modifiers (PosVkDriver *self, GdkModifierType gdk_modifier
 
   return modifier;
 }
+
+/**
+ * pos_vk_driver_get_keymap_cache_hits:
+ * @self: The vk driver
+ *
+ * Get the number of layout switches that could use a cached keymap.
+ *
+ * Returns: The number of cache hits
+ */
+guint
+pos_vk_driver_get_keymap_cache_hits (PosVkDriver *self)
+{
+  g_return_val_if_fail (POS_IS_VK_DRIVER (self), 0);
+
+  return self->keymap_cache_hits;
+}
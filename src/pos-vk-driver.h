@@ -27,16 +27,20 @@ typedef enum {
 PosVkDriver *pos_vk_driver_new (PosVirtualKeyboard *virtual_keyboard);
 void         pos_vk_driver_key_down (PosVkDriver        *virtual_keyboard,
                                      const char         *key,
-                                     PosKeycodeModifier  modifier);
-void        pos_vk_driver_key_up (PosVkDriver *virtual_keyboard, const char *key);
+                                     PosKeycodeModifier  modifier,
+                                     guint32             time);
+void        pos_vk_driver_key_up (PosVkDriver *virtual_keyboard, const char *key, guint32 time);
 void        pos_vk_driver_key_press_gdk (PosVkDriver    *self,
                                          guint           gdk_keycode,
                                          GdkModifierType modifiers);
 void        pos_vk_driver_set_terminal_keymap (PosVkDriver       *self);
 void        pos_vk_driver_set_keymap_symbols (PosVkDriver        *self,
                                               const char         *layout_id,
-                                              const char * const *symbols);
+                                              const char * const *symbols,
+                                              const char * const *overlay_symbols);
 void        pos_vk_driver_set_overlay_keymap (PosVkDriver *self, const char * const *symbols);
+gboolean    pos_vk_driver_get_overlay_active (PosVkDriver *self);
+guint       pos_vk_driver_get_keymap_cache_hits (PosVkDriver *self);
 PosKeycodeModifier
             pos_vk_driver_convert_modifiers (PosVkDriver *self, GdkModifierType modifier);
 
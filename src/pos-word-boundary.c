@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "pos-word-boundary"
+
+#include "pos-config.h"
+
+#include "pos-word-boundary.h"
+
+/**
+ * PosWordBoundary:
+ *
+ * Finds word boundaries in UTF-8 text.
+ *
+ * Words are separated by whitespace and punctuation. All separators
+ * are ASCII and UTF-8 never uses ASCII bytes within multi byte
+ * sequences so text can be scanned byte wise in either direction
+ * without decoding it.
+ */
+
+typedef enum {
+  POS_CHAR_CLASS_WORD = 0,
+  POS_CHAR_CLASS_SEPARATOR,
+  POS_CHAR_CLASS_WHITESPACE,
+} PosCharClass;
+
+/* TODO: all the brackets, also language dependent */
+static const guint8 char_classes[128] = {
+  [' ']  = POS_CHAR_CLASS_WHITESPACE,
+  ['\t'] = POS_CHAR_CLASS_WHITESPACE,
+  ['\n'] = POS_CHAR_CLASS_WHITESPACE,
+  ['.']  = POS_CHAR_CLASS_SEPARATOR,
+  [',']  = POS_CHAR_CLASS_SEPARATOR,
+  [';']  = POS_CHAR_CLASS_SEPARATOR,
+  [':']  = POS_CHAR_CLASS_SEPARATOR,
+  ['?']  = POS_CHAR_CLASS_SEPARATOR,
+  ['!']  = POS_CHAR_CLASS_SEPARATOR,
+  ['(']  = POS_CHAR_CLASS_SEPARATOR,
+  [')']  = POS_CHAR_CLASS_SEPARATOR,
+  ['{']  = POS_CHAR_CLASS_SEPARATOR,
+  ['}']  = POS_CHAR_CLASS_SEPARATOR,
+  ['[']  = POS_CHAR_CLASS_SEPARATOR,
+  [']']  = POS_CHAR_CLASS_SEPARATOR,
+};
+
+
+static inline PosCharClass
+get_char_class (gunichar c)
+{
+  if (c >= G_N_ELEMENTS (char_classes))
+    return POS_CHAR_CLASS_WORD;
+
+  return char_classes[c];
+}
+
+/**
+ * pos_word_boundary_is_separator:
+ * @c: The character to check
+ * @is_ws:(out) (nullable): whether @c is whitespace
+ *
+ * Checks if the given character separates words.
+ *
+ * Returns: %TRUE if @c is a word separator
+ */
+gboolean
+pos_word_boundary_is_separator (gunichar c, gboolean *is_ws)
+{
+  PosCharClass class = get_char_class (c);
+
+  if (is_ws)
+    *is_ws = class == POS_CHAR_CLASS_WHITESPACE;
+
+  return class != POS_CHAR_CLASS_WORD;
+}
+
+/**
+ * pos_word_boundary_find_start:
+ * @text: The text to scan
+ * @len: The length of @text in bytes
+ *
+ * Finds the start of the word at the end of @text, e.g. the word
+ * before the cursor when passing the text before the cursor.
+ *
+ * Returns: The byte offset of the word's start. This is @len if @text
+ *   ends in a separator.
+ */
+gsize
+pos_word_boundary_find_start (const char *text, gsize len)
+{
+  gsize pos = len;
+
+  while (pos > 0 && get_char_class ((guchar)text[pos - 1]) == POS_CHAR_CLASS_WORD)
+    pos--;
+
+  return pos;
+}
+
+/**
+ * pos_word_boundary_find_end:
+ * @text: The text to scan
+ * @len: The length of @text in bytes
+ *
+ * Finds the end of the word at the start of @text, e.g. the rest of
+ * the word after the cursor when passing the text after the cursor.
+ *
+ * Returns: The byte offset of the word's end. This is `0` if @text
+ *   starts with a separator.
+ */
+gsize
+pos_word_boundary_find_end (const char *text, gsize len)
+{
+  gsize pos = 0;
+
+  while (pos < len && get_char_class ((guchar)text[pos]) == POS_CHAR_CLASS_WORD)
+    pos++;
+
+  return pos;
+}
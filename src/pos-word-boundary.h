@@ -0,0 +1,20 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gboolean pos_word_boundary_is_separator   (gunichar    c,
+                                           gboolean   *is_ws);
+gsize    pos_word_boundary_find_start     (const char *text,
+                                           gsize       len);
+gsize    pos_word_boundary_find_end       (const char *text,
+                                           gsize       len);
+
+G_END_DECLS
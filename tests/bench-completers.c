@@ -0,0 +1,392 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Replays a typing corpus character by character through the
+ * completers and reports per keystroke latency, allocations and
+ * memory usage as JSON on stdout.
+ */
+
+#define G_LOG_DOMAIN "pos-bench-completers"
+
+#include "pos-config.h"
+
+#include "pos-completer.h"
+#include "pos-completer-manager.h"
+
+#include <json-glib/json-glib.h>
+
+#include <unistd.h>
+
+#ifdef POS_HAVE_MALLINFO2
+# include <malloc.h>
+#endif
+
+#define TIMEOUT_MS 2000
+
+static const char * const all_engines[] = {
+  "fzf",
+  "wordlist",
+  "hunspell",
+  "presage",
+  "varnam",
+  "pipe",
+  NULL
+};
+
+typedef struct {
+  gboolean  completions_changed;
+  gboolean  timed_out;
+} BenchState;
+
+
+#ifdef POS_HAVE_LIBC_MALLOC
+/*
+ * Count allocations by interposing glibc's allocator. The counters
+ * are updated atomically as completers allocate in worker threads too.
+ */
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+static guint n_allocs;
+
+
+void *
+malloc (size_t size)
+{
+  g_atomic_int_inc (&n_allocs);
+  return __libc_malloc (size);
+}
+
+
+void *
+calloc (size_t nmemb, size_t size)
+{
+  g_atomic_int_inc (&n_allocs);
+  return __libc_calloc (nmemb, size);
+}
+
+
+void *
+realloc (void *ptr, size_t size)
+{
+  g_atomic_int_inc (&n_allocs);
+  return __libc_realloc (ptr, size);
+}
+
+
+static guint
+get_n_allocs (void)
+{
+  return g_atomic_int_get (&n_allocs);
+}
+#else
+static guint
+get_n_allocs (void)
+{
+  return 0;
+}
+#endif
+
+
+static void
+on_completions_changed (BenchState *state)
+{
+  state->completions_changed = TRUE;
+}
+
+
+static gsize
+get_heap_bytes (void)
+{
+#ifdef POS_HAVE_MALLINFO2
+  struct mallinfo2 info = mallinfo2 ();
+
+  return info.uordblks + info.hblkhd;
+#else
+  return 0;
+#endif
+}
+
+
+static gsize
+get_rss_kb (void)
+{
+  g_autofree char *statm = NULL;
+  g_auto (GStrv) fields = NULL;
+  guint64 pages;
+
+  if (!g_file_get_contents ("/proc/self/statm", &statm, NULL, NULL))
+    return 0;
+
+  fields = g_strsplit (statm, " ", -1);
+  if (g_strv_length (fields) < 2 || !g_ascii_string_to_unsigned (fields[1], 10, 0, G_MAXUINT64,
+                                                                  &pages, NULL)) {
+    return 0;
+  }
+
+  return pages * sysconf (_SC_PAGESIZE) / 1024;
+}
+
+
+static int
+compare_latency (gconstpointer a, gconstpointer b)
+{
+  gint64 la = *(const gint64 *)a;
+  gint64 lb = *(const gint64 *)b;
+
+  return (la > lb) - (la < lb);
+}
+
+
+static gint64
+percentile (GArray *latencies, double p)
+{
+  guint idx;
+
+  if (latencies->len == 0)
+    return 0;
+
+  idx = MIN ((guint)(p * latencies->len), latencies->len - 1);
+  return g_array_index (latencies, gint64, idx);
+}
+
+
+static void
+on_timeout (gpointer data)
+{
+  BenchState *state = data;
+
+  state->timed_out = TRUE;
+}
+
+
+static gboolean
+wait_for (BenchState *state, PosCompleter *completer, gboolean loading)
+{
+  guint timeout_id;
+  gboolean done = FALSE;
+
+  state->timed_out = FALSE;
+  timeout_id = g_timeout_add_once (TIMEOUT_MS, on_timeout, state);
+
+  while (!state->timed_out) {
+    if (loading)
+      done = !pos_completer_is_loading (completer);
+    else
+      done = state->completions_changed;
+
+    if (done)
+      break;
+
+    /* Completers report back via the main loop so block until they do */
+    g_main_context_iteration (NULL, TRUE);
+  }
+
+  if (!state->timed_out)
+    g_source_remove (timeout_id);
+
+  return done;
+}
+
+
+static const char *
+char_to_symbol (gunichar c, char *buf)
+{
+  if (c == '\n')
+    return "KEY_ENTER";
+
+  buf[g_unichar_to_utf8 (c, buf)] = '\0';
+  return buf;
+}
+
+
+static JsonNode *
+bench_engine (PosCompleterManager *manager,
+              const char          *engine,
+              const char          *lang,
+              const char          *region,
+              const char          *corpus,
+              gboolean             use_cache)
+{
+  g_autoptr (JsonBuilder) builder = json_builder_new ();
+  g_autoptr (GArray) latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+  g_autoptr (GError) err = NULL;
+  PosCompletionInfo *info;
+  PosCompletionCache *cache;
+  BenchState state = { 0 };
+  gsize heap_before, rss_before;
+  guint allocs_before, allocs;
+  guint timeouts = 0, hits, misses;
+  gint64 total = 0;
+
+  heap_before = get_heap_bytes ();
+  rss_before = get_rss_kb ();
+  allocs_before = get_n_allocs ();
+
+  info = pos_completer_manager_get_info (manager, engine, lang, region, &err);
+  if (info == NULL) {
+    g_message ("Skipping '%s': %s", engine, err->message);
+    return NULL;
+  }
+
+  cache = pos_completer_manager_get_cache (manager);
+  pos_completion_cache_clear (cache);
+  if (!use_cache)
+    pos_completer_set_cache (info->completer, NULL);
+  hits = pos_completion_cache_get_hits (cache);
+  misses = pos_completion_cache_get_misses (cache);
+
+  if (!wait_for (&state, info->completer, TRUE))
+    g_warning ("'%s' didn't finish loading", engine);
+
+  g_signal_connect_swapped (info->completer, "notify::completions",
+                            G_CALLBACK (on_completions_changed), &state);
+
+  for (const char *p = corpus; *p; p = g_utf8_next_char (p)) {
+    char buf[8];
+    const char *symbol = char_to_symbol (g_utf8_get_char (p), buf);
+    gint64 start, latency;
+
+    state.completions_changed = FALSE;
+    start = g_get_monotonic_time ();
+    if (!pos_completer_feed_symbol (info->completer, symbol)) {
+      /* Not handled, nothing to wait for */
+      pos_completer_set_preedit (info->completer, NULL);
+      continue;
+    }
+
+    if (!wait_for (&state, info->completer, FALSE)) {
+      timeouts++;
+      continue;
+    }
+
+    latency = g_get_monotonic_time () - start;
+    total += latency;
+    g_array_append_val (latencies, latency);
+  }
+
+  allocs = get_n_allocs () - allocs_before;
+  g_signal_handlers_disconnect_by_data (info->completer, &state);
+  pos_completer_set_preedit (info->completer, NULL);
+  pos_completer_set_cache (info->completer, cache);
+  g_array_sort (latencies, compare_latency);
+
+  json_builder_begin_object (builder);
+  json_builder_set_member_name (builder, "engine");
+  json_builder_add_string_value (builder, engine);
+  json_builder_set_member_name (builder, "keystrokes");
+  json_builder_add_int_value (builder, latencies->len);
+  json_builder_set_member_name (builder, "timeouts");
+  json_builder_add_int_value (builder, timeouts);
+  json_builder_set_member_name (builder, "p50_us");
+  json_builder_add_int_value (builder, percentile (latencies, 0.50));
+  json_builder_set_member_name (builder, "p95_us");
+  json_builder_add_int_value (builder, percentile (latencies, 0.95));
+  json_builder_set_member_name (builder, "p99_us");
+  json_builder_add_int_value (builder, percentile (latencies, 0.99));
+  json_builder_set_member_name (builder, "max_us");
+  json_builder_add_int_value (builder, percentile (latencies, 1.0));
+  json_builder_set_member_name (builder, "mean_us");
+  json_builder_add_int_value (builder, latencies->len ? total / latencies->len : 0);
+  json_builder_set_member_name (builder, "allocations");
+  json_builder_add_int_value (builder, allocs);
+  json_builder_set_member_name (builder, "heap_growth_bytes");
+  json_builder_add_int_value (builder, (gint64)get_heap_bytes () - (gint64)heap_before);
+  json_builder_set_member_name (builder, "rss_growth_kb");
+  json_builder_add_int_value (builder, (gint64)get_rss_kb () - (gint64)rss_before);
+  json_builder_set_member_name (builder, "cache_hits");
+  json_builder_add_int_value (builder, pos_completion_cache_get_hits (cache) - hits);
+  json_builder_set_member_name (builder, "cache_misses");
+  json_builder_add_int_value (builder, pos_completion_cache_get_misses (cache) - misses);
+  json_builder_end_object (builder);
+
+  pos_completion_info_free (info);
+
+  return json_builder_get_root (builder);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  g_autoptr (GOptionContext) opt_context = NULL;
+  g_autoptr (GError) err = NULL;
+  g_autoptr (PosCompleterManager) manager = NULL;
+  g_autoptr (JsonBuilder) builder = NULL;
+  g_autoptr (JsonGenerator) generator = NULL;
+  g_autoptr (JsonNode) root = NULL;
+  g_autofree char *corpus = NULL;
+  g_autofree char *json = NULL;
+  g_auto (GStrv) engines = NULL;
+  g_autofree char *lang = g_strdup (POS_COMPLETER_DEFAULT_LANG);
+  g_autofree char *region = g_strdup (POS_COMPLETER_DEFAULT_REGION);
+  gboolean no_cache = FALSE;
+  const GOptionEntry options [] = {
+    {"engine", 'e', 0, G_OPTION_ARG_STRING_ARRAY, &engines,
+     "Engine to benchmark (can be given multiple times)", "ENGINE"},
+    {"lang", 'l', 0, G_OPTION_ARG_STRING, &lang, "Language to use", "LANG"},
+    {"region", 'r', 0, G_OPTION_ARG_STRING, &region, "Region to use", "REGION"},
+    {"no-cache", 0, 0, G_OPTION_ARG_NONE, &no_cache, "Bypass the completion cache", NULL},
+    { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL }
+  };
+
+  opt_context = g_option_context_new ("CORPUS - benchmark completers");
+  g_option_context_add_main_entries (opt_context, options, NULL);
+  if (!g_option_context_parse (opt_context, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    return EXIT_FAILURE;
+  }
+
+  if (argc != 2) {
+    g_printerr ("Usage: %s [OPTION…] CORPUS\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (!g_file_get_contents (argv[1], &corpus, NULL, &err)) {
+    g_printerr ("Failed to read corpus: %s\n", err->message);
+    return EXIT_FAILURE;
+  }
+
+  if (!g_utf8_validate (corpus, -1, NULL)) {
+    g_printerr ("Corpus '%s' is not valid UTF-8\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  manager = pos_completer_manager_new ();
+
+  builder = json_builder_new ();
+  json_builder_begin_object (builder);
+  json_builder_set_member_name (builder, "corpus");
+  json_builder_add_string_value (builder, argv[1]);
+  json_builder_set_member_name (builder, "chars");
+  json_builder_add_int_value (builder, g_utf8_strlen (corpus, -1));
+  json_builder_set_member_name (builder, "cache");
+  json_builder_add_boolean_value (builder, !no_cache);
+  json_builder_set_member_name (builder, "results");
+  json_builder_begin_array (builder);
+
+  for (int i = 0; engines ? engines[i] != NULL : all_engines[i] != NULL; i++) {
+    const char *engine = engines ? engines[i] : all_engines[i];
+    JsonNode *result = bench_engine (manager, engine, lang, region, corpus, !no_cache);
+
+    if (result)
+      json_builder_add_value (builder, result);
+  }
+
+  json_builder_end_array (builder);
+  json_builder_end_object (builder);
+
+  root = json_builder_get_root (builder);
+  generator = json_generator_new ();
+  json_generator_set_pretty (generator, TRUE);
+  json_generator_set_root (generator, root);
+  json = json_generator_to_data (generator, NULL);
+  g_print ("%s\n", json);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "pos-clipboard-manager-priv.h"
+
+#include <gio/gio.h>
+
+typedef struct {
+  char    *text;
+  GError  *err;
+  gboolean done;
+} ReadResult;
+
+
+static void
+on_text_read (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  ReadResult *result = user_data;
+
+  result->text = pos_clipboard_manager_read_text_finish (G_INPUT_STREAM (source_object), res,
+                                                         &result->err);
+  result->done = TRUE;
+}
+
+
+static char *
+read_text (const char *data, gssize len, gsize max_size, GError **err)
+{
+  g_autoptr (GInputStream) stream = NULL;
+  ReadResult result = { 0 };
+
+  if (len < 0)
+    len = strlen (data);
+
+  stream = g_memory_input_stream_new_from_data (g_memdup2 (data, len), len, g_free);
+  pos_clipboard_manager_read_text_async (stream, max_size, NULL, on_text_read, &result);
+  while (!result.done)
+    g_main_context_iteration (NULL, TRUE);
+
+  if (result.err)
+    g_propagate_error (err, result.err);
+
+  return result.text;
+}
+
+
+static void
+test_clipboard_manager_read_text_simple (void)
+{
+  g_autoptr (GError) err = NULL;
+  g_autofree char *text = NULL;
+
+  text = read_text ("Hello wörld", -1, 0, &err);
+  g_assert_no_error (err);
+  g_assert_cmpstr (text, ==, "Hello wörld");
+  g_clear_pointer (&text, g_free);
+
+  text = read_text ("", -1, 0, &err);
+  g_assert_no_error (err);
+  g_assert_cmpstr (text, ==, "");
+}
+
+
+static void
+test_clipboard_manager_read_text_split (void)
+{
+  g_autoptr (GString) data = g_string_new (NULL);
+  g_autoptr (GError) err = NULL;
+  g_autofree char *text = NULL;
+
+  /* Multibyte sequences of different length so some get split between chunks */
+  while (data->len < 100000)
+    g_string_append (data, "aä€😀");
+
+  text = read_text (data->str, data->len, 0, &err);
+  g_assert_no_error (err);
+  g_assert_cmpstr (text, ==, data->str);
+}
+
+
+static void
+test_clipboard_manager_read_text_invalid (void)
+{
+  g_autoptr (GError) err = NULL;
+  g_autofree char *text = NULL;
+
+  text = read_text ("abc\xff" "def", -1, 0, &err);
+  g_assert_error (err, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_assert_null (text);
+  g_clear_error (&err);
+
+  /* Incomplete sequence at the end of the stream */
+  text = read_text ("abc\xe2\x82", -1, 0, &err);
+  g_assert_error (err, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_assert_null (text);
+  g_clear_error (&err);
+
+  text = read_text ("abc\0def", 7, 0, &err);
+  g_assert_error (err, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_assert_null (text);
+}
+
+
+static void
+test_clipboard_manager_read_text_max_size (void)
+{
+  g_autoptr (GError) err = NULL;
+  g_autofree char *text = NULL;
+
+  text = read_text ("0123456789", -1, 10, &err);
+  g_assert_no_error (err);
+  g_assert_cmpstr (text, ==, "0123456789");
+  g_clear_pointer (&text, g_free);
+
+  text = read_text ("0123456789a", -1, 10, &err);
+  g_assert_error (err, G_IO_ERROR, G_IO_ERROR_MESSAGE_TOO_LARGE);
+  g_assert_null (text);
+  g_clear_error (&err);
+
+  /* The limit is in bytes, not characters */
+  text = read_text ("ääääää", -1, 10, &err);
+  g_assert_error (err, G_IO_ERROR, G_IO_ERROR_MESSAGE_TOO_LARGE);
+  g_assert_null (text);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/pos/clipboard_manager/read_text/simple",
+                   test_clipboard_manager_read_text_simple);
+  g_test_add_func ("/pos/clipboard_manager/read_text/split",
+                   test_clipboard_manager_read_text_split);
+  g_test_add_func ("/pos/clipboard_manager/read_text/invalid",
+                   test_clipboard_manager_read_text_invalid);
+  g_test_add_func ("/pos/clipboard_manager/read_text/max_size",
+                   test_clipboard_manager_read_text_max_size);
+
+  return g_test_run ();
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "pos-completer-priv.h"
+#include "pos-fuzzy-matcher.h"
+
+#include <glib.h>
+
+#define WORDS "abcx\nxabc\nabc\naxbxc\nabdc\nab\nacb\nzabc\naxxbc\nbca\n"
+
+static int
+prefix_match (const char *query, const char *candidate, gpointer user_data)
+{
+  return g_str_has_prefix (candidate, query) ? 0 : -1;
+}
+
+
+static int
+length_match (const char *query, const char *candidate, gpointer user_data)
+{
+  if (!g_str_has_prefix (candidate, query))
+    return -1;
+
+  /* Prefer short words */
+  return 100 - (int) strlen (candidate);
+}
+
+
+static int
+fuzzy_match (const char *query, const char *candidate, gpointer user_data)
+{
+  return pos_fuzzy_matcher_score (query, candidate, -1);
+}
+
+
+static void
+test_completer_refiner_refine (void)
+{
+  g_autoptr (PosCompleterRefiner) refiner = pos_completer_refiner_new ();
+  g_auto (GStrv) completions = NULL;
+
+  /* Nothing to refine yet */
+  g_assert_false (pos_completer_refiner_refine (refiner, "w", prefix_match, NULL));
+  g_assert_null (pos_completer_refiner_get_completions (refiner, 3));
+
+  pos_completer_refiner_set_candidates (refiner, "w",
+                                        g_strdupv ((char *[]){ "words", "with", "wombat", "word", NULL }),
+                                        TRUE);
+  completions = pos_completer_refiner_get_completions (refiner, 3);
+  g_assert_cmpstrv (completions, ((const char *[]){ "words", "with", "wombat", NULL }));
+  g_clear_pointer (&completions, g_strfreev);
+
+  /* Appending keeps the order of equally scored candidates */
+  g_assert_true (pos_completer_refiner_refine (refiner, "wo", prefix_match, NULL));
+  completions = pos_completer_refiner_get_completions (refiner, 3);
+  g_assert_cmpstrv (completions, ((const char *[]){ "words", "wombat", "word", NULL }));
+  g_clear_pointer (&completions, g_strfreev);
+
+  g_assert_true (pos_completer_refiner_refine (refiner, "wor", length_match, NULL));
+  completions = pos_completer_refiner_get_completions (refiner, 3);
+  g_assert_cmpstrv (completions, ((const char *[]){ "word", "words", NULL }));
+  g_clear_pointer (&completions, g_strfreev);
+
+  /* Backspace and unrelated input need a full query */
+  g_assert_false (pos_completer_refiner_refine (refiner, "wo", prefix_match, NULL));
+  g_assert_false (pos_completer_refiner_refine (refiner, "wor", prefix_match, NULL));
+  g_assert_false (pos_completer_refiner_refine (refiner, "xor", prefix_match, NULL));
+
+  pos_completer_refiner_reset (refiner);
+  g_assert_false (pos_completer_refiner_refine (refiner, "word", prefix_match, NULL));
+  g_assert_null (pos_completer_refiner_get_completions (refiner, 3));
+}
+
+
+static void
+test_completer_refiner_incomplete (void)
+{
+  g_autoptr (PosCompleterRefiner) refiner = pos_completer_refiner_new ();
+
+  /* Truncated candidates might miss matches for the longer query */
+  pos_completer_refiner_set_candidates (refiner, "w",
+                                        g_strdupv ((char *[]){ "words", "with", NULL }),
+                                        FALSE);
+  g_assert_false (pos_completer_refiner_refine (refiner, "wo", prefix_match, NULL));
+}
+
+
+static void
+test_completer_refiner_order (void)
+{
+  g_autoptr (GBytes) words = g_bytes_new_static (WORDS, strlen (WORDS));
+  g_autoptr (PosFuzzyMatcher) matcher = pos_fuzzy_matcher_new_from_bytes (words);
+  g_autoptr (PosCompleterRefiner) refiner = pos_completer_refiner_new ();
+  g_autofree guint *indices = NULL;
+  GStrv candidates;
+  guint n_total;
+
+  pos_completer_refiner_set_compare_func (refiner, pos_fuzzy_matcher_compare_candidates);
+  candidates = pos_fuzzy_matcher_match_full (matcher, "a", 100, &indices, &n_total);
+  g_assert_cmpuint (n_total, ==, 10);
+  pos_completer_refiner_set_candidates_full (refiner, "a", candidates, indices, TRUE);
+
+  /* Refined candidates are ordered like a full match, ties included */
+  for (guint i = 0; i < 2; i++) {
+    const char *query = (const char *[]){ "ab", "abc" }[i];
+    g_auto (GStrv) expected = pos_fuzzy_matcher_match (matcher, query, 100);
+    g_auto (GStrv) completions = NULL;
+
+    g_assert_true (pos_completer_refiner_refine (refiner, query, fuzzy_match, NULL));
+    completions = pos_completer_refiner_get_completions (refiner, 100);
+    g_assert_cmpstrv (completions, expected);
+  }
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/pos/completer/refiner/refine", test_completer_refiner_refine);
+  g_test_add_func ("/pos/completer/refiner/incomplete", test_completer_refiner_incomplete);
+  g_test_add_func ("/pos/completer/refiner/order", test_completer_refiner_order);
+
+  return g_test_run ();
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "pos-completion-cache.h"
+
+#include <glib.h>
+
+static void
+test_completion_cache_lookup (void)
+{
+  g_autoptr (PosCompletionCache) cache = pos_completion_cache_new (4096);
+  g_auto (GStrv) completions = NULL;
+
+  g_assert_false (pos_completion_cache_lookup (cache, "fzf\x1f" "en-us\x1f\x1fwo", &completions));
+  g_assert_null (completions);
+  g_assert_cmpuint (pos_completion_cache_get_misses (cache), ==, 1);
+
+  pos_completion_cache_insert (cache, "fzf\x1f" "en-us\x1f\x1fwo",
+                               (const char *[]){ "word", "wombat", NULL });
+  g_assert_true (pos_completion_cache_lookup (cache, "fzf\x1f" "en-us\x1f\x1fwo", &completions));
+  g_assert_cmpstrv (completions, ((const char *[]){ "word", "wombat", NULL }));
+  g_clear_pointer (&completions, g_strfreev);
+  g_assert_cmpuint (pos_completion_cache_get_hits (cache), ==, 1);
+
+  /* Empty results are cached too */
+  pos_completion_cache_insert (cache, "fzf\x1f" "en-us\x1f\x1fxq", NULL);
+  g_assert_true (pos_completion_cache_lookup (cache, "fzf\x1f" "en-us\x1f\x1fxq", &completions));
+  g_assert_null (completions);
+
+  pos_completion_cache_insert (cache, "hunspell\x1f" "en-us\x1f\x1fwo",
+                               (const char *[]){ "wo", "two", NULL });
+  pos_completion_cache_invalidate (cache, "fzf\x1f");
+  g_assert_false (pos_completion_cache_lookup (cache, "fzf\x1f" "en-us\x1f\x1fwo", &completions));
+  g_assert_true (pos_completion_cache_lookup (cache, "hunspell\x1f" "en-us\x1f\x1fwo", &completions));
+  g_clear_pointer (&completions, g_strfreev);
+
+  pos_completion_cache_clear (cache);
+  g_assert_cmpuint (pos_completion_cache_get_size (cache), ==, 0);
+  g_assert_false (pos_completion_cache_lookup (cache, "hunspell\x1f" "en-us\x1f\x1fwo", &completions));
+}
+
+
+static void
+test_completion_cache_evict (void)
+{
+  g_autoptr (PosCompletionCache) cache = pos_completion_cache_new (1024);
+  g_auto (GStrv) completions = NULL;
+
+  for (int i = 0; i < 100; i++) {
+    g_autofree char *key = g_strdup_printf ("key%d", i);
+
+    pos_completion_cache_insert (cache, key, (const char *[]){ "a", "b", "c", NULL });
+    /* Keep the first entry in use */
+    g_assert_true (pos_completion_cache_lookup (cache, "key0", &completions));
+    g_clear_pointer (&completions, g_strfreev);
+  }
+
+  g_assert_cmpuint (pos_completion_cache_get_size (cache), <=, 1024);
+  g_assert_true (pos_completion_cache_lookup (cache, "key99", &completions));
+  g_clear_pointer (&completions, g_strfreev);
+  g_assert_false (pos_completion_cache_lookup (cache, "key1", &completions));
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/pos/completion_cache/lookup", test_completion_cache_lookup);
+  g_test_add_func ("/pos/completion_cache/evict", test_completion_cache_evict);
+
+  return g_test_run ();
+}
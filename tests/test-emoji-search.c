@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "pos-emoji-search.h"
+#include "pos-main.h"
+
+#include <glib.h>
+
+static GVariant *
+load_variant (const char *path, const char *type)
+{
+  g_autoptr (GBytes) bytes = NULL;
+  g_autoptr (GError) err = NULL;
+
+  bytes = g_resources_lookup_data (path, G_RESOURCE_LOOKUP_FLAGS_NONE, &err);
+  g_assert_no_error (err);
+
+  return g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (type), bytes, TRUE));
+}
+
+
+static char *
+get_name (GVariant *data, GArray *results, guint n)
+{
+  g_autoptr (GVariant) item = NULL;
+  char *name;
+
+  g_assert_cmpuint (n, <, results->len);
+  item = g_variant_get_child_value (data, g_array_index (results, guint32, n));
+  g_variant_get_child (item, 1, "s", &name);
+
+  return name;
+}
+
+
+static void
+test_emoji_search (void)
+{
+  g_autoptr (GVariant) data = NULL;
+  g_autoptr (GVariant) index = NULL;
+  g_autoptr (GArray) results = NULL;
+  g_autofree char *name = NULL;
+
+  pos_init ();
+  data = load_variant ("/mobi/phosh/osk-stub/emoji/en.data", "a(ausasu)");
+  index = load_variant ("/mobi/phosh/osk-stub/emoji/en.index", "a(sauau)");
+
+  /* Exact name match ranks first */
+  results = pos_emoji_search (index, data, "Cat", 10);
+  g_assert_cmpuint (results->len, ==, 10);
+  name = get_name (data, results, 0);
+  g_assert_cmpstr (name, ==, "cat");
+  g_clear_pointer (&name, g_free);
+  g_clear_pointer (&results, g_array_unref);
+
+  /* All words need to match */
+  results = pos_emoji_search (index, data, "heart red", 10);
+  g_assert_cmpuint (results->len, >=, 1);
+  name = get_name (data, results, 0);
+  g_assert_cmpstr (name, ==, "red heart");
+  g_clear_pointer (&name, g_free);
+  g_clear_pointer (&results, g_array_unref);
+
+  /* Prefixes match */
+  results = pos_emoji_search (index, data, "firew", 10);
+  g_assert_cmpuint (results->len, >=, 1);
+  name = get_name (data, results, 0);
+  g_assert_cmpstr (name, ==, "fireworks");
+  g_clear_pointer (&name, g_free);
+  g_clear_pointer (&results, g_array_unref);
+
+  results = pos_emoji_search (index, data, "doesnotexist", 10);
+  g_assert_cmpuint (results->len, ==, 0);
+  g_clear_pointer (&results, g_array_unref);
+
+  results = pos_emoji_search (index, data, " ,", 10);
+  g_assert_cmpuint (results->len, ==, 0);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/pos/emoji_search/search", test_emoji_search);
+
+  return g_test_run ();
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "pos-fuzzy-matcher.h"
+
+#include <glib.h>
+
+#define WORDS "apple\nApplesauce\napply\nmaple\nbanana\npineapple\r\nzebra\n\nnaïve\n"
+
+static void
+test_fuzzy_matcher_score (void)
+{
+  g_assert_cmpint (pos_fuzzy_matcher_score ("", "apple", -1), ==, -1);
+  g_assert_cmpint (pos_fuzzy_matcher_score ("xyz", "apple", -1), ==, -1);
+  g_assert_cmpint (pos_fuzzy_matcher_score ("ple", "apple", -1), >, 0);
+
+  /* Prefix matches beat matches inside a word */
+  g_assert_cmpint (pos_fuzzy_matcher_score ("ap", "apple", -1), >,
+                   pos_fuzzy_matcher_score ("ap", "maple", -1));
+  /* Consecutive matches beat gaps */
+  g_assert_cmpint (pos_fuzzy_matcher_score ("app", "apple", -1), >,
+                   pos_fuzzy_matcher_score ("app", "a-p-p", -1));
+
+  /* Smart case */
+  g_assert_cmpint (pos_fuzzy_matcher_score ("apple", "APPLE", -1), >, 0);
+  g_assert_cmpint (pos_fuzzy_matcher_score ("Apple", "apple", -1), ==, -1);
+
+  g_assert_cmpint (pos_fuzzy_matcher_score ("naï", "naïve", -1), >, 0);
+  g_assert_cmpint (pos_fuzzy_matcher_score ("NAÏ", "naïve", -1), ==, -1);
+}
+
+
+static void
+test_fuzzy_matcher_match (void)
+{
+  g_autoptr (GBytes) bytes = g_bytes_new_static (WORDS, strlen (WORDS));
+  g_autoptr (PosFuzzyMatcher) matcher = pos_fuzzy_matcher_new_from_bytes (bytes);
+  g_auto (GStrv) matches = NULL;
+
+  /* Empty lines are skipped */
+  g_assert_cmpint (pos_fuzzy_matcher_get_n_words (matcher), ==, 8);
+
+  g_assert_null (pos_fuzzy_matcher_match (matcher, "", 3));
+  g_assert_null (pos_fuzzy_matcher_match (matcher, "qqq", 3));
+
+  matches = pos_fuzzy_matcher_match (matcher, "appl", 3);
+  g_assert_cmpstrv (matches, ((const char *[]){ "apple", "apply", "Applesauce", NULL }));
+  g_clear_pointer (&matches, g_strfreev);
+
+  /* Trailing \r is not part of the word */
+  matches = pos_fuzzy_matcher_match (matcher, "pinea", 1);
+  g_assert_cmpstrv (matches, ((const char *[]){ "pineapple", NULL }));
+  g_clear_pointer (&matches, g_strfreev);
+
+  matches = pos_fuzzy_matcher_match (matcher, "naï", 5);
+  g_assert_cmpstrv (matches, ((const char *[]){ "naïve", NULL }));
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/pos/fuzzy-matcher/score", test_fuzzy_matcher_score);
+  g_test_add_func ("/pos/fuzzy-matcher/match", test_fuzzy_matcher_match);
+
+  return g_test_run ();
+}
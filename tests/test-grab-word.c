@@ -6,6 +6,7 @@
  */
 
 #include "pos-completer-priv.h"
+#include "pos-word-boundary.h"
 
 #include <glib.h>
 
@@ -35,6 +36,38 @@ test_grab_last_word(void)
   g_assert_true (pos_completer_grab_last_word ("ends with word", &new_before, &word));
   g_assert_cmpstr (new_before, ==, "ends with ");
   g_assert_cmpstr (word, ==, "word");
+  g_clear_pointer (&new_before, g_free);
+  g_clear_pointer (&word, g_free);
+
+  g_assert_true (pos_completer_grab_last_word ("Grüße, schöne", &new_before, &word));
+  g_assert_cmpstr (new_before, ==, "Grüße, ");
+  g_assert_cmpstr (word, ==, "schöne");
+  g_clear_pointer (&new_before, g_free);
+  g_clear_pointer (&word, g_free);
+}
+
+
+static void
+test_word_boundary (void)
+{
+  const char *text = "über (alles";
+  gboolean is_ws;
+
+  g_assert_true (pos_word_boundary_is_separator (' ', &is_ws));
+  g_assert_true (is_ws);
+  g_assert_true (pos_word_boundary_is_separator ('!', &is_ws));
+  g_assert_false (is_ws);
+  g_assert_false (pos_word_boundary_is_separator (g_utf8_get_char ("ü"), &is_ws));
+  g_assert_false (is_ws);
+
+  g_assert_cmpuint (pos_word_boundary_find_start (text, strlen (text)), ==, strlen ("über ("));
+  g_assert_cmpuint (pos_word_boundary_find_start (text, strlen ("über")), ==, 0);
+  g_assert_cmpuint (pos_word_boundary_find_start (text, strlen ("über ")), ==, strlen ("über "));
+  g_assert_cmpuint (pos_word_boundary_find_start ("", 0), ==, 0);
+
+  g_assert_cmpuint (pos_word_boundary_find_end (text, strlen (text)), ==, strlen ("über"));
+  g_assert_cmpuint (pos_word_boundary_find_end (" alles", strlen (" alles")), ==, 0);
+  g_assert_cmpuint (pos_word_boundary_find_end ("alles", strlen ("alles")), ==, strlen ("alles"));
 }
 
 
@@ -44,6 +77,7 @@ main (int argc, char *argv[])
   g_test_init (&argc, &argv, NULL);
 
   g_test_add_func ("/pos/completer/grab_last_word", test_grab_last_word);
+  g_test_add_func ("/pos/completer/word_boundary", test_word_boundary);
 
   return g_test_run ();
 }
@@ -0,0 +1,383 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "pos-input-method.h"
+
+#include "input-method-unstable-v2-client-protocol.h"
+
+#include <glib-unix.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <wayland-client.h>
+
+/* zwp_input_method_v2 event opcodes */
+#define EVENT_ACTIVATE   0
+#define EVENT_DEACTIVATE 1
+#define EVENT_DONE       5
+
+/* zwp_input_method_v2 request opcodes */
+#define REQUEST_COMMIT_STRING             0
+#define REQUEST_SET_PREEDIT_STRING        1
+#define REQUEST_DELETE_SURROUNDING_TEXT   2
+#define REQUEST_COMMIT                    3
+
+/* A request as sent on the wire */
+typedef struct {
+  guint32  id;
+  guint    opcode;
+  guint32 *args;
+  gsize    n_args;
+} Request;
+
+
+static void
+request_free (Request *request)
+{
+  g_free (request->args);
+  g_free (request);
+}
+
+
+static const char *
+request_get_string (Request *request)
+{
+  g_assert_cmpuint (request->n_args, >=, 2);
+  return (const char *)&request->args[1];
+}
+
+
+/* The n-th integer argument following the leading string argument */
+static guint32
+request_get_uint_after_string (Request *request, guint n)
+{
+  gsize idx = 1 + (request->args[0] + 3) / 4 + n;
+
+  g_assert_cmpuint (request->n_args, >, idx);
+  return request->args[idx];
+}
+
+
+static void
+assert_request (Request *request, guint32 id, guint opcode)
+{
+  g_assert_cmpuint (request->id, ==, id);
+  g_assert_cmpuint (request->opcode, ==, opcode);
+}
+
+/*
+ * Plays the compositor's part of the protocol on the other end of a
+ * socket pair so no compositor is needed.
+ */
+typedef struct {
+  struct wl_display *display;
+  struct wl_proxy   *manager;
+  struct wl_proxy   *seat;
+  int                server_fd;
+  guint32            im_id;
+  PosInputMethod    *im;
+} Fixture;
+
+
+static GPtrArray *
+read_requests (Fixture *fixture)
+{
+  g_autoptr (GByteArray) buf = g_byte_array_new ();
+  GPtrArray *requests = g_ptr_array_new_with_free_func ((GDestroyNotify)request_free);
+  guint8 chunk[4096];
+  gssize n;
+  gsize offset = 0;
+
+  g_assert_cmpint (wl_display_flush (fixture->display), >=, 0);
+  while ((n = read (fixture->server_fd, chunk, sizeof (chunk))) > 0)
+    g_byte_array_append (buf, chunk, n);
+  /* The client must not have hung up */
+  g_assert_cmpint (n, ==, -1);
+  g_assert_cmpint (errno, ==, EAGAIN);
+
+  while (offset < buf->len) {
+    guint32 *header = (guint32 *)(buf->data + offset);
+    gsize size = header[1] >> 16;
+    Request *request = g_new0 (Request, 1);
+
+    g_assert_cmpuint (size, >=, 8);
+    request->id = header[0];
+    request->opcode = header[1] & 0xffff;
+    request->n_args = (size - 8) / sizeof (guint32);
+    request->args = g_memdup2 (header + 2, size - 8);
+    g_ptr_array_add (requests, request);
+
+    offset += size;
+  }
+
+  return requests;
+}
+
+
+static void
+send_events (Fixture *fixture, const guint32 *opcodes, guint n_opcodes)
+{
+  for (guint i = 0; i < n_opcodes; i++) {
+    guint32 msg[2] = { fixture->im_id, (8 << 16) | opcodes[i] };
+
+    g_assert_cmpint (write (fixture->server_fd, msg, sizeof (msg)), ==, sizeof (msg));
+  }
+
+  g_assert_cmpint (wl_display_dispatch (fixture->display), ==, n_opcodes);
+}
+
+
+static void
+on_timeout (gpointer data)
+{
+  gboolean *done = data;
+
+  *done = TRUE;
+}
+
+
+static void
+wait_ms (guint ms)
+{
+  gboolean done = FALSE;
+
+  g_timeout_add_once (ms, on_timeout, &done);
+  while (!done)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+
+static void
+fixture_setup (Fixture *fixture, gconstpointer unused)
+{
+  g_autoptr (GPtrArray) requests = NULL;
+  int fds[2];
+
+  g_assert_cmpint (socketpair (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds), ==, 0);
+  g_assert_true (g_unix_set_fd_nonblocking (fds[1], TRUE, NULL));
+  fixture->server_fd = fds[1];
+
+  fixture->display = wl_display_connect_to_fd (fds[0]);
+  g_assert_nonnull (fixture->display);
+  fixture->manager = wl_proxy_create ((struct wl_proxy *)fixture->display,
+                                      &zwp_input_method_manager_v2_interface);
+  fixture->seat = wl_proxy_create ((struct wl_proxy *)fixture->display, &wl_seat_interface);
+
+  fixture->im = pos_input_method_new (fixture->manager, fixture->seat);
+
+  /* Pick up the id of the input method created by get_input_method */
+  requests = read_requests (fixture);
+  g_assert_cmpuint (requests->len, ==, 1);
+  g_assert_cmpuint (((Request *)requests->pdata[0])->id, ==, wl_proxy_get_id (fixture->manager));
+  g_assert_cmpuint (((Request *)requests->pdata[0])->n_args, ==, 2);
+  fixture->im_id = ((Request *)requests->pdata[0])->args[1];
+}
+
+
+static void
+fixture_teardown (Fixture *fixture, gconstpointer unused)
+{
+  g_clear_object (&fixture->im);
+  wl_proxy_destroy (fixture->seat);
+  wl_proxy_destroy (fixture->manager);
+  wl_display_disconnect (fixture->display);
+  close (fixture->server_fd);
+}
+
+
+static void
+test_input_method_batch_deactivate (Fixture *fixture, gconstpointer unused)
+{
+  g_autoptr (GPtrArray) requests = NULL;
+  Request *request;
+  guint requested, sent;
+
+  send_events (fixture, (guint32[]){ EVENT_ACTIVATE, EVENT_DONE }, 2);
+  g_assert_true (pos_input_method_get_active (fixture->im));
+  g_assert_cmpuint (pos_input_method_get_serial (fixture->im), ==, 1);
+
+  pos_input_method_set_batch_commits (fixture->im, TRUE);
+  pos_input_method_send_string (fixture->im, "foo", TRUE);
+  /* Never committed */
+  pos_input_method_send_string (fixture->im, "bar", FALSE);
+
+  requests = read_requests (fixture);
+  g_assert_cmpuint (requests->len, ==, 0);
+  g_clear_pointer (&requests, g_ptr_array_unref);
+
+  /* The batch goes to the old text input with the old serial */
+  send_events (fixture, (guint32[]){ EVENT_DEACTIVATE, EVENT_DONE }, 2);
+  g_assert_false (pos_input_method_get_active (fixture->im));
+  g_assert_cmpuint (pos_input_method_get_serial (fixture->im), ==, 2);
+
+  requests = read_requests (fixture);
+  g_assert_cmpuint (requests->len, ==, 2);
+  request = requests->pdata[0];
+  g_assert_cmpuint (request->id, ==, fixture->im_id);
+  g_assert_cmpuint (request->opcode, ==, REQUEST_COMMIT_STRING);
+  g_assert_cmpstr (request_get_string (request), ==, "foo");
+  request = requests->pdata[1];
+  g_assert_cmpuint (request->opcode, ==, REQUEST_COMMIT);
+  g_assert_cmpuint (request->args[0], ==, 1);
+  g_clear_pointer (&requests, g_ptr_array_unref);
+
+  /* Nothing is left over for the next text input */
+  wait_ms (50);
+  requests = read_requests (fixture);
+  g_assert_cmpuint (requests->len, ==, 0);
+  g_clear_pointer (&requests, g_ptr_array_unref);
+
+  send_events (fixture, (guint32[]){ EVENT_ACTIVATE, EVENT_DONE }, 2);
+  pos_input_method_send_string (fixture->im, "baz", TRUE);
+  wait_ms (50);
+
+  requests = read_requests (fixture);
+  g_assert_cmpuint (requests->len, ==, 2);
+  request = requests->pdata[0];
+  g_assert_cmpuint (request->opcode, ==, REQUEST_COMMIT_STRING);
+  g_assert_cmpstr (request_get_string (request), ==, "baz");
+  request = requests->pdata[1];
+  g_assert_cmpuint (request->opcode, ==, REQUEST_COMMIT);
+  g_assert_cmpuint (request->args[0], ==, 3);
+
+  pos_input_method_get_commit_stats (fixture->im, &requested, &sent);
+  g_assert_cmpuint (requested, ==, 2);
+  g_assert_cmpuint (sent, ==, 2);
+}
+
+
+static void
+activate (Fixture *fixture)
+{
+  send_events (fixture, (guint32[]){ EVENT_ACTIVATE, EVENT_DONE }, 2);
+  g_assert_true (pos_input_method_get_active (fixture->im));
+  pos_input_method_set_batch_commits (fixture->im, TRUE);
+}
+
+
+static void
+test_input_method_batch_delete_after_text (Fixture *fixture, gconstpointer unused)
+{
+  g_autoptr (GPtrArray) requests = NULL;
+
+  activate (fixture);
+
+  pos_input_method_send_string (fixture->im, "foo", TRUE);
+  /* Deletions apply before text so this can't be merged into the batch */
+  pos_input_method_delete_surrounding_text (fixture->im, 1, 0, TRUE);
+
+  requests = read_requests (fixture);
+  g_assert_cmpuint (requests->len, ==, 2);
+  assert_request (requests->pdata[0], fixture->im_id, REQUEST_COMMIT_STRING);
+  g_assert_cmpstr (request_get_string (requests->pdata[0]), ==, "foo");
+  assert_request (requests->pdata[1], fixture->im_id, REQUEST_COMMIT);
+  g_assert_cmpuint (((Request *)requests->pdata[1])->args[0], ==, 1);
+  g_clear_pointer (&requests, g_ptr_array_unref);
+
+  wait_ms (50);
+  requests = read_requests (fixture);
+  g_assert_cmpuint (requests->len, ==, 2);
+  assert_request (requests->pdata[0], fixture->im_id, REQUEST_DELETE_SURROUNDING_TEXT);
+  g_assert_cmpuint (((Request *)requests->pdata[0])->args[0], ==, 1);
+  g_assert_cmpuint (((Request *)requests->pdata[0])->args[1], ==, 0);
+  assert_request (requests->pdata[1], fixture->im_id, REQUEST_COMMIT);
+}
+
+
+static void
+test_input_method_batch_preedit_and_text (Fixture *fixture, gconstpointer unused)
+{
+  g_autoptr (GPtrArray) requests = NULL;
+  Request *request;
+  guint requested, sent;
+
+  activate (fixture);
+
+  /* Deletions before text merge, text accumulates and the last preedit wins */
+  pos_input_method_delete_surrounding_text (fixture->im, 2, 0, TRUE);
+  pos_input_method_send_string (fixture->im, "foo", TRUE);
+  pos_input_method_send_preedit (fixture->im, "b", 1, 1, TRUE);
+  pos_input_method_send_string (fixture->im, "bar", FALSE);
+  pos_input_method_send_preedit (fixture->im, "ba", 2, 2, TRUE);
+
+  requests = read_requests (fixture);
+  g_assert_cmpuint (requests->len, ==, 0);
+  g_clear_pointer (&requests, g_ptr_array_unref);
+
+  wait_ms (50);
+  requests = read_requests (fixture);
+  g_assert_cmpuint (requests->len, ==, 4);
+  request = requests->pdata[0];
+  assert_request (request, fixture->im_id, REQUEST_DELETE_SURROUNDING_TEXT);
+  g_assert_cmpuint (request->args[0], ==, 2);
+  request = requests->pdata[1];
+  assert_request (request, fixture->im_id, REQUEST_COMMIT_STRING);
+  g_assert_cmpstr (request_get_string (request), ==, "foobar");
+  request = requests->pdata[2];
+  assert_request (request, fixture->im_id, REQUEST_SET_PREEDIT_STRING);
+  g_assert_cmpstr (request_get_string (request), ==, "ba");
+  g_assert_cmpuint (request_get_uint_after_string (request, 0), ==, 2);
+  g_assert_cmpuint (request_get_uint_after_string (request, 1), ==, 2);
+  request = requests->pdata[3];
+  assert_request (request, fixture->im_id, REQUEST_COMMIT);
+  g_assert_cmpuint (request->args[0], ==, 1);
+
+  pos_input_method_get_commit_stats (fixture->im, &requested, &sent);
+  g_assert_cmpuint (requested, ==, 4);
+  g_assert_cmpuint (sent, ==, 1);
+}
+
+
+static void
+test_input_method_batch_done (Fixture *fixture, gconstpointer unused)
+{
+  g_autoptr (GPtrArray) requests = NULL;
+
+  activate (fixture);
+  g_assert_cmpuint (pos_input_method_get_serial (fixture->im), ==, 1);
+
+  pos_input_method_send_string (fixture->im, "foo", TRUE);
+
+  /* A state update without focus change flushes with the serial the text was made for */
+  send_events (fixture, (guint32[]){ EVENT_DONE }, 1);
+  g_assert_true (pos_input_method_get_active (fixture->im));
+  g_assert_cmpuint (pos_input_method_get_serial (fixture->im), ==, 2);
+
+  requests = read_requests (fixture);
+  g_assert_cmpuint (requests->len, ==, 2);
+  assert_request (requests->pdata[0], fixture->im_id, REQUEST_COMMIT_STRING);
+  g_assert_cmpstr (request_get_string (requests->pdata[0]), ==, "foo");
+  assert_request (requests->pdata[1], fixture->im_id, REQUEST_COMMIT);
+  g_assert_cmpuint (((Request *)requests->pdata[1])->args[0], ==, 1);
+  g_clear_pointer (&requests, g_ptr_array_unref);
+
+  /* Later commits use the new serial */
+  pos_input_method_send_string (fixture->im, "bar", TRUE);
+  wait_ms (50);
+  requests = read_requests (fixture);
+  g_assert_cmpuint (requests->len, ==, 2);
+  assert_request (requests->pdata[1], fixture->im_id, REQUEST_COMMIT);
+  g_assert_cmpuint (((Request *)requests->pdata[1])->args[0], ==, 2);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/pos/input_method/batch_deactivate", Fixture, NULL,
+              fixture_setup, test_input_method_batch_deactivate, fixture_teardown);
+  g_test_add ("/pos/input_method/batch_delete_after_text", Fixture, NULL,
+              fixture_setup, test_input_method_batch_delete_after_text, fixture_teardown);
+  g_test_add ("/pos/input_method/batch_preedit_and_text", Fixture, NULL,
+              fixture_setup, test_input_method_batch_preedit_and_text, fixture_teardown);
+  g_test_add ("/pos/input_method/batch_done", Fixture, NULL,
+              fixture_setup, test_input_method_batch_done, fixture_teardown);
+
+  return g_test_run ();
+}
@@ -46,11 +46,11 @@ test_load_layouts (void)
     const char *layout, *variant;
 
     osk_widget = g_object_ref_sink (pos_osk_widget_new (PHOSH_OSK_FEATURE_DEFAULT));
-    g_assert (g_str_has_suffix (names[i], ".json"));
-    layout_id = g_strndup (names[i], strlen (names[i]) - strlen (".json"));
+    g_assert (g_str_has_suffix (names[i], ".layout"));
+    layout_id = g_strndup (names[i], strlen (names[i]) - strlen (".layout"));
     g_test_message ("Loading layout %s", layout_id);
 
-    if (g_strcmp0 (names[i], "terminal.json")) {
+    if (g_strcmp0 (names[i], "terminal.layout")) {
       g_assert_true (gnome_xkb_info_get_layout_info (xkbinfo, layout_id, NULL, NULL, &layout, &variant));
       pos_osk_widget_set_layout (osk_widget, "doesnotmatter", layout_id, "Test", layout, variant, &err);
       g_assert_nonnull (pos_osk_widget_get_lang (osk_widget));
@@ -61,6 +61,13 @@ test_load_layouts (void)
       g_assert_true (g_regex_match (region_re, pos_osk_widget_get_region (osk_widget),
                                     G_REGEX_MATCH_DEFAULT,
                                     NULL));
+
+      /* Keys are built on first use */
+      g_assert_cmpuint (pos_osk_widget_get_keys_size (osk_widget), ==, 0);
+      g_assert_nonnull (pos_osk_widget_get_symbols (osk_widget)[0]);
+      g_assert_cmpuint (pos_osk_widget_get_keys_size (osk_widget), >, 0);
+      g_assert_true (pos_osk_widget_release_keys (osk_widget));
+      g_assert_cmpuint (pos_osk_widget_get_keys_size (osk_widget), ==, 0);
     }
 
     g_assert_no_error (err);
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2026 The Phosh Developers
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "pos-word-index.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#define WORDS "the 500\nthere 40\nthey 90\ntheir 60\nThem 60\nthem 10\ntea\nzebra 3\n"
+#define DIC   "4\nHaus/SP\nHäuser/N\nhaushalt/S po:noun\nhausen\n"
+
+typedef struct {
+  char *dir;
+} Fixture;
+
+
+static void
+remove_recursive (const char *path)
+{
+  if (g_file_test (path, G_FILE_TEST_IS_DIR)) {
+    g_autoptr (GDir) dir = g_dir_open (path, 0, NULL);
+    const char *name;
+
+    while (dir && (name = g_dir_read_name (dir))) {
+      g_autofree char *child = g_build_filename (path, name, NULL);
+
+      remove_recursive (child);
+    }
+  }
+
+  g_assert_cmpint (g_remove (path), ==, 0);
+}
+
+
+static void
+fixture_setup (Fixture *fixture, gconstpointer unused)
+{
+  g_autoptr (GError) err = NULL;
+
+  fixture->dir = g_dir_make_tmp ("pos-word-index-XXXXXX", &err);
+  g_assert_no_error (err);
+}
+
+
+static void
+fixture_teardown (Fixture *fixture, gconstpointer unused)
+{
+  remove_recursive (fixture->dir);
+  g_free (fixture->dir);
+}
+
+
+static void
+test_word_index_lookup (Fixture *fixture, gconstpointer unused)
+{
+  g_autoptr (GError) err = NULL;
+  g_autoptr (PosWordIndex) index = NULL;
+  g_autofree char *words = g_build_filename (fixture->dir, "words", NULL);
+  g_autofree char *cache = g_build_filename (fixture->dir, "cache", NULL);
+  g_auto (GStrv) completions = NULL;
+
+  g_file_set_contents (words, WORDS, -1, &err);
+  g_assert_no_error (err);
+
+  index = pos_word_index_new_for_source (words, cache, &err);
+  g_assert_no_error (err);
+  g_assert_nonnull (index);
+
+  /* Most frequent first, case is folded and counts get merged */
+  completions = pos_word_index_lookup (index, "the", 4);
+  g_assert_cmpstrv (completions, ((const char *[]){ "the", "they", "them", "their", NULL }));
+  g_clear_pointer (&completions, g_strfreev);
+
+  completions = pos_word_index_lookup (index, "TE", 3);
+  g_assert_cmpstrv (completions, ((const char *[]){ "tea", NULL }));
+  g_clear_pointer (&completions, g_strfreev);
+
+  g_assert_null (pos_word_index_lookup (index, "x", 3));
+  g_assert_null (pos_word_index_lookup (index, "zebras", 3));
+
+  /* Second load uses the cached index */
+  g_clear_pointer (&index, pos_word_index_free);
+  index = pos_word_index_new_for_source (words, cache, &err);
+  g_assert_no_error (err);
+  completions = pos_word_index_lookup (index, "z", 3);
+  g_assert_cmpstrv (completions, ((const char *[]){ "zebra", NULL }));
+}
+
+
+static void
+test_word_index_dic (Fixture *fixture, gconstpointer unused)
+{
+  g_autoptr (GError) err = NULL;
+  g_autoptr (PosWordIndex) index = NULL;
+  g_autofree char *dic = g_build_filename (fixture->dir, "de_DE.dic", NULL);
+  g_autofree char *cache = g_build_filename (fixture->dir, "cache", NULL);
+  g_auto (GStrv) completions = NULL;
+
+  g_file_set_contents (dic, DIC, -1, &err);
+  g_assert_no_error (err);
+
+  index = pos_word_index_new_for_source (dic, cache, &err);
+  g_assert_no_error (err);
+
+  completions = pos_word_index_lookup (index, "hau", 5);
+  g_assert_cmpstrv (completions, ((const char *[]){ "haus", "hausen", "haushalt", NULL }));
+  g_clear_pointer (&completions, g_strfreev);
+
+  completions = pos_word_index_lookup (index, "Häu", 5);
+  g_assert_cmpstrv (completions, ((const char *[]){ "häuser", NULL }));
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/pos/word-index/lookup", Fixture, NULL,
+              fixture_setup, test_word_index_lookup, fixture_teardown);
+  g_test_add ("/pos/word-index/dic", Fixture, NULL,
+              fixture_setup, test_word_index_dic, fixture_teardown);
+
+  return g_test_run ();
+}
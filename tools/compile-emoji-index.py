@@ -0,0 +1,161 @@
+#!/usr/bin/python3
+#
+# Copyright (C) 2026 The Phosh Developers
+#
+# SPDX-License-Identifier: GPL-3.0-or-later
+#
+# Build a search index for the emoji data. The emoji data is a
+# serialized GVariant of type
+#
+#   a(ausasu)
+#
+# that is: codepoints, name, keywords and group of each emoji. The
+# index is a serialized GVariant of type
+#
+#   a(sauau)
+#
+# that is: a list of words sorted by their UTF-8 bytes. Each word has
+# the (sorted) indices of the emojis that have it in their name and
+# the indices of the emojis that have it in their keywords only. A
+# word is a lower case run of letters and digits.
+
+import argparse
+import re
+import sys
+
+
+WORD_RE = re.compile(r"[^\W_]+")
+
+
+def align(n, alignment):
+    return (n + alignment - 1) & ~(alignment - 1)
+
+
+def offset_size(container_len):
+    for size in (1, 2, 4, 8):
+        if container_len < 1 << (8 * size):
+            return size
+    raise ValueError("Container too large")
+
+
+def read_offset(data, pos, size):
+    return int.from_bytes(data[pos:pos + size], "little")
+
+
+def parse_string(data):
+    return data[:-1].decode("utf-8")
+
+
+def parse_array(data, alignment):
+    """An array of variable sized elements"""
+    if not data:
+        return []
+    size = offset_size(len(data))
+    last_end = read_offset(data, len(data) - size, size)
+    n = (len(data) - last_end) // size
+    elements = []
+    start = 0
+    for i in range(n):
+        end = read_offset(data, last_end + i * size, size)
+        start = align(start, alignment)
+        elements.append(data[start:end])
+        start = end
+    return elements
+
+
+def parse_emoji(data):
+    """A (ausasu) tuple"""
+    # Three variable sized members precede the trailing 'u'
+    size = offset_size(len(data))
+    ends = [read_offset(data, len(data) - (i + 1) * size, size) for i in range(3)]
+    codes = data[0:ends[0]]
+    name = parse_string(data[ends[0]:ends[1]])
+    keywords = [parse_string(k) for k in parse_array(data[ends[1]:ends[2]], 1)]
+    group = int.from_bytes(data[align(ends[2], 4):align(ends[2], 4) + 4], "little")
+    return [int.from_bytes(codes[i:i + 4], "little") for i in range(0, len(codes), 4)], name, keywords, group
+
+
+def frame(body, ends):
+    size = 0
+    if ends:
+        for size in (1, 2, 4, 8):
+            if len(body) + len(ends) * size < 1 << (8 * size):
+                break
+    return body + b"".join(end.to_bytes(size, "little") for end in ends)
+
+
+def serialize_array(elements, alignment):
+    """An array of variable sized elements"""
+    body = b""
+    ends = []
+    for element in elements:
+        body += b"\0" * (align(len(body), alignment) - len(body))
+        body += element
+        ends.append(len(body))
+    return frame(body, ends)
+
+
+def serialize_au(values):
+    return b"".join(v.to_bytes(4, "little") for v in values)
+
+
+def serialize_entry(word, names, keywords):
+    """A (sauau) tuple"""
+    body = word.encode("utf-8") + b"\0"
+    ends = [len(body)]
+    body += b"\0" * (align(len(body), 4) - len(body))
+    body += serialize_au(names)
+    ends.append(len(body))
+    body += b"\0" * (align(len(body), 4) - len(body))
+    body += serialize_au(keywords)
+    # The last member doesn't need a framing offset, the others are
+    # stored in reverse order
+    return frame(body, list(reversed(ends)))
+
+
+def words(text):
+    return WORD_RE.findall(text.lower())
+
+
+def build_index(emojis):
+    names = {}
+    keywords = {}
+    for index, (_, name, kws, _) in enumerate(emojis):
+        for word in words(name):
+            names.setdefault(word, set()).add(index)
+        for kw in kws:
+            for word in words(kw):
+                keywords.setdefault(word, set()).add(index)
+
+    entries = []
+    for word in sorted(set(names) | set(keywords), key=lambda w: w.encode("utf-8")):
+        in_name = names.get(word, set())
+        in_keywords = keywords.get(word, set()) - in_name
+        entries.append(serialize_entry(word, sorted(in_name), sorted(in_keywords)))
+
+    return serialize_array(entries, 4)
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="Build the emoji search index")
+    parser.add_argument("--out", action="store", required=True)
+    parser.add_argument("data", action="store")
+    args = parser.parse_args(argv[1:])
+
+    with open(args.data, "rb") as f:
+        data = f.read()
+
+    try:
+        emojis = [parse_emoji(e) for e in parse_array(data, 4)]
+    except (IndexError, UnicodeDecodeError) as e:
+        print(f"{args.data}: {e}", file=sys.stderr)
+        return 1
+
+    with open(args.out, "wb") as f:
+        f.write(build_index(emojis))
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,120 @@
+#!/usr/bin/python3
+#
+# Copyright (C) 2026 The Phosh Developers
+#
+# SPDX-License-Identifier: GPL-3.0-or-later
+#
+# Compile a JSON keyboard layout into a serialized GVariant of type
+#
+#   (ssa(saa(sssas)))
+#
+# that is: name, locale and a list of levels. Each level has a name
+# and a list of rows, each row is a list of keys made up of symbol,
+# label, style and the additional symbols shown in the popover. Unset
+# strings are serialized as empty strings.
+#
+# Since all members are strings there's no alignment padding and
+# serializing only needs to care about framing offsets.
+
+import argparse
+import json
+import sys
+
+
+KEY_MEMBERS = ("symbol", "label", "style")
+
+
+def offset_size(body_len, n_offsets):
+    if n_offsets == 0:
+        return 0
+    for size in (1, 2, 4, 8):
+        if body_len + n_offsets * size < 1 << (8 * size):
+            return size
+    raise ValueError("Container too large")
+
+
+def frame(body, ends, n_offsets):
+    size = offset_size(len(body), n_offsets)
+    return body + b"".join(end.to_bytes(size, "little") for end in ends)
+
+
+def string(s):
+    return s.encode("utf-8") + b"\0"
+
+
+def array(elements):
+    """An array of variable sized elements"""
+    body = b""
+    ends = []
+    for element in elements:
+        body += element
+        ends.append(len(body))
+    return frame(body, ends, len(ends))
+
+
+def tuple_(members):
+    """A tuple made up of variable sized members only"""
+    body = b""
+    ends = []
+    for member in members:
+        body += member
+        ends.append(len(body))
+    # The last member doesn't need a framing offset, the others are
+    # stored in reverse order
+    ends = list(reversed(ends[:-1]))
+    return frame(body, ends, len(ends))
+
+
+def compile_key(key, where):
+    if isinstance(key, list):
+        if len(key) < 1:
+            raise ValueError(f"Empty key at {where}")
+        symbol, label, style, symbols = key[0], "", "", key[1:]
+    elif isinstance(key, dict):
+        unknown = set(key.keys()) - set(KEY_MEMBERS)
+        if unknown:
+            raise ValueError(f"Unsupported key members {unknown} at {where}")
+        symbol, label, style = (key.get(m, "") for m in KEY_MEMBERS)
+        symbols = []
+    else:
+        raise ValueError(f"Unparsable key at {where}")
+
+    return tuple_([string(symbol), string(label), string(style),
+                   array([string(s) for s in symbols])])
+
+
+def compile_layout(j):
+    levels = []
+    for l, level in enumerate(j["levels"]):
+        rows = []
+        for r, row in enumerate(level["rows"]):
+            keys = [compile_key(key, f"level {l} row {r} pos {k}") for k, key in enumerate(row)]
+            rows.append(array(keys))
+        levels.append(tuple_([string(level["level"]), array(rows)]))
+
+    return tuple_([string(j["name"]), string(j.get("locale", "")), array(levels)])
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="Compile a JSON OSK layout")
+    parser.add_argument("--out", action="store", required=True)
+    parser.add_argument("layout", action="store")
+    args = parser.parse_args(argv[1:])
+
+    with open(args.layout, encoding="utf-8") as f:
+        j = json.load(f)
+
+    try:
+        data = compile_layout(j)
+    except (KeyError, ValueError) as e:
+        print(f"{args.layout}: {e}", file=sys.stderr)
+        return 1
+
+    with open(args.out, "wb") as f:
+        f.write(data)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))